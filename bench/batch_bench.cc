@@ -0,0 +1,74 @@
+// Compares per-row Interpreter::evaluate with Batch::evaluate on one
+// expression over numeric columns. Configure with -DCMAKE_BUILD_TYPE=Release
+// for meaningful numbers.
+//
+// Usage: BatchBench [rows]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+
+static const char *SOURCE = "(x * 0.5 + y / 3 - x * y) * (x - 1) >= y + 2;";
+
+static ExprValue number(double value) {
+  ExprValue val;
+  val.type = VALNUMBER;
+  val.number = value;
+  return val;
+}
+
+int main(int argc, char *argv[]) {
+  size_t rows = argc > 1 ? atol(argv[1]) : 1000000;
+
+  std::vector<double> x(rows), y(rows);
+  for (size_t i = 0; i < rows; i++) {
+    x[i] = i % 1000 * 0.25;
+    y[i] = (i % 37) + 1;
+  }
+
+  Scanner scanner(SOURCE);
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> program = parser.parse();
+  Expr *expr = static_cast<Expression *>(program[0])->expression;
+
+  Interpreter interpreter;
+  size_t per_row_true = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < rows; i++) {
+    interpreter.set_global("x", number(x[i]));
+    interpreter.set_global("y", number(y[i]));
+    per_row_true += interpreter.evaluate(expr).boolean;
+  }
+  auto per_row = std::chrono::steady_clock::now() - start;
+
+  Batch batch;
+  batch.bind("x", x.data());
+  batch.bind("y", y.data());
+  start = std::chrono::steady_clock::now();
+  BatchResult result = batch.evaluate(expr, rows);
+  auto batched = std::chrono::steady_clock::now() - start;
+
+  size_t batch_true = 0;
+  for (double value : result.values)
+    batch_true += value != 0;
+
+  double per_row_ns = std::chrono::duration<double, std::nano>(per_row).count();
+  double batch_ns = std::chrono::duration<double, std::nano>(batched).count();
+  std::cout << rows << " rows, " << SOURCE << std::endl;
+  std::cout << "per-row: " << per_row_ns / rows << " ns/row" << std::endl;
+  std::cout << "batch:   " << batch_ns / rows << " ns/row" << std::endl;
+  std::cout << "speedup: " << per_row_ns / batch_ns << "x" << std::endl;
+  if (per_row_true != batch_true)
+    std::cout << "MISMATCH: " << per_row_true << " vs " << batch_true
+              << std::endl;
+
+  for (Stmt *stmt : program)
+    delete stmt;
+  return per_row_true == batch_true ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+// Measures the cost of enforcing a budget: the same loop run without a
+// budget, with a step limit, with a timeout and with both, none of which is
+// reached. Every step counts down one counter either way; a budget adds a
+// check every few thousand steps, which reads the clock for a timeout.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: BudgetBench [iterations] [repeats]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+
+// The fastest of repeats runs of statements under budget.
+static double best_ns(const std::vector<Stmt *> &statements, Budget budget,
+                      int repeats) {
+  double best = 0;
+  for (int r = 0; r < repeats; r++) {
+    Interpreter interpreter;
+    std::ostringstream out;
+    interpreter.set_output(out);
+    interpreter.set_budget(budget);
+    auto start = std::chrono::steady_clock::now();
+    interpreter.execute_statements(statements);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    best = r == 0 ? ns : std::min(best, ns);
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 300000;
+  int repeats = argc > 2 ? atoi(argv[2]) : 5;
+
+  Scanner scanner("var sum = 0;\nfor (var i = 0; i < " +
+                  std::to_string(iterations) +
+                  "; i = i + 1) {\n"
+                  "  var x = i * 0.5;\n  sum = sum + x * (x - 1);\n}\n"
+                  "print sum;\n");
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+
+  const uint64_t steps = UINT64_MAX / 2;
+  const uint64_t ms = 3600 * 1000;
+  double none = best_ns(statements, {0, 0}, repeats);
+  double step_limit = best_ns(statements, {steps, 0}, repeats);
+  double timeout = best_ns(statements, {0, ms}, repeats);
+  double both = best_ns(statements, {steps, ms}, repeats);
+
+  std::cout << iterations << " iterations, best of " << repeats << std::endl;
+  auto report = [&](const char *name, double ns) {
+    std::cout << name << ns / iterations << " ns/iteration, "
+              << (ns / none - 1) * 100 << "% overhead" << std::endl;
+  };
+  std::cout << "no budget:   " << none / iterations << " ns/iteration"
+            << std::endl;
+  report("--max-steps: ", step_limit);
+  report("--timeout:   ", timeout);
+  report("both:        ", both);
+
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return 0;
+}
@@ -0,0 +1,119 @@
+// Measures what a call to a native function costs: the generated binding
+// against calling the C++ function directly and against a binding through
+// std::function and a vector of arguments, and a script calling a native in
+// a loop against one doing the same arithmetic inline.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: CallBench [calls] [iterations]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+#include "natives.h"
+#include "parser.h"
+#include "scanner.h"
+
+static double step(double x, double y) { return x * 0.5 + y; }
+
+// The fastest of runs timings of f, in milliseconds.
+template <typename F> static double best_ms(int runs, F f) {
+  double best = 1e300;
+  for (int r = 0; r < runs; r++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best,
+                    std::chrono::duration<double, std::milli>(elapsed).count());
+  }
+  return best;
+}
+
+static ExprValue number(double x) {
+  ExprValue value;
+  value.type = VALNUMBER;
+  value.number = x;
+  return value;
+}
+
+static double run_ms(const std::string &source, std::string &output) {
+  Scanner scanner(source);
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+
+  auto start = std::chrono::steady_clock::now();
+  interpreter.interpret(statements);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  output = out.str();
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+int main(int argc, char *argv[]) {
+  int calls = argc > 1 ? atoi(argv[1]) : 10000000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 1000000;
+
+  NativeFunction *native = Natives::define("step", step);
+  // What a binding without the generated unpacking would do: box the
+  // arguments in a vector and check and unpack them at run time.
+  std::function<ExprValue(const std::vector<ExprValue> &)> boxed =
+      [](const std::vector<ExprValue> &arguments) {
+        for (const ExprValue &argument : arguments)
+          if (argument.type != VALNUMBER)
+            throw std::runtime_error("Arguments must be numbers.");
+        return number(step(arguments[0].number, arguments[1].number));
+      };
+
+  volatile double sink = 0;
+  double direct = best_ms(5, [&]() {
+    double (*volatile function)(double, double) = step;
+    double x = 0;
+    for (int i = 0; i < calls; i++)
+      x = function(x, 1);
+    sink = x;
+  });
+  double bound = best_ms(5, [&]() {
+    ExprValue arguments[2] = {number(0), number(1)};
+    for (int i = 0; i < calls; i++)
+      arguments[0] = native->call(*native, arguments, 1);
+    sink = arguments[0].number;
+  });
+  double vector = best_ms(5, [&]() {
+    ExprValue x = number(0);
+    for (int i = 0; i < calls; i++)
+      x = boxed({x, number(1)});
+    sink = x.number;
+  });
+  std::cout << calls << " calls: direct " << direct << " ms, bound " << bound
+            << " ms (" << (bound - direct) * 1e6 / calls
+            << " ns per call over direct), std::function and vector "
+            << vector << " ms" << std::endl;
+
+  std::string loop = "var x = 0;\nfor (var i = 0; i < " +
+                     std::to_string(iterations) + "; i = i + 1) {\n";
+  std::string native_output, inline_output;
+  double native_ms =
+      run_ms(loop + "  x = step(x, 1);\n}\nprint x;\n", native_output);
+  double inline_ms =
+      run_ms(loop + "  x = x * 0.5 + 1;\n}\nprint x;\n", inline_output);
+  std::cout << iterations << " iterations: native call " << native_ms
+            << " ms, inline " << inline_ms << " ms ("
+            << (native_ms - inline_ms) * 1e6 / iterations
+            << " ns per call)" << std::endl;
+  if (native_output != inline_output) {
+    std::cerr << "outputs differ: " << native_output << " vs "
+              << inline_output << std::endl;
+    return 1;
+  }
+  return 0;
+}
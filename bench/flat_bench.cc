@@ -0,0 +1,134 @@
+// Compares evaluating expressions as the tree of Expr nodes with evaluating
+// their FlatExpr copy: throughput, bytes per node and, with
+// CCLOX_PERF_COUNTERS=1 in the environment, the hardware counters.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: FlatBench [expressions] [iterations]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "flat_expr.h"
+#include "heap.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "perf_counters.h"
+#include "scanner.h"
+
+static const int VARS = 8;
+
+static std::string expressions(int count) {
+  std::string source;
+  for (int i = 0; i < count; i++) {
+    auto var = [&](int k) { return "v" + std::to_string((i + k) % VARS); };
+    source += var(0) + " = " + var(1) + " * 0.5 + " + var(2) + " / 3 - (" +
+              var(3) + " - " + var(4) + ") * 0.1;\n";
+  }
+  return source;
+}
+
+struct Measurement {
+  double ns;
+  PerfSample perf;
+  double checksum;
+};
+
+template <typename Evaluate>
+static Measurement measure(Interpreter &interpreter, PerfCounters *counters,
+                           int iterations, Evaluate evaluate) {
+  for (int v = 0; v < VARS; v++) {
+    ExprValue value;
+    value.type = VALNUMBER;
+    value.number = v + 1.5;
+    interpreter.set_global("v" + std::to_string(v), value);
+  }
+
+  Measurement m;
+  if (counters != nullptr)
+    counters->start();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++)
+    evaluate();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  if (counters != nullptr)
+    m.perf = counters->stop();
+  m.ns = std::chrono::duration<double, std::nano>(elapsed).count();
+
+  m.checksum = 0;
+  for (int v = 0; v < VARS; v++) {
+    Variable var(Token(IDENTIFIER, "v" + std::to_string(v), nullptr, 0));
+    m.checksum += interpreter.evaluate(&var).number;
+  }
+  return m;
+}
+
+static void print(const char *name, const Measurement &m, double evaluated,
+                  size_t nodes, PerfCounters *counters) {
+  std::cout << name << m.ns / evaluated << " ns/expression" << std::endl;
+  if (counters != nullptr && counters->available()) {
+    std::cout << "  ";
+    m.perf.print(std::cout, evaluated * nodes);
+    std::cout << std::endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? atoi(argv[1]) : 100000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+  Scanner scanner(expressions(count));
+  Parser parser(scanner.scanTokens());
+  size_t before = Heap::used(HEAP_AST);
+  std::vector<Stmt *> program = parser.parse();
+  std::vector<Expr *> exprs;
+  for (Stmt *stmt : program)
+    exprs.push_back(static_cast<Expression *>(stmt)->expression);
+  // Minus the Expression statements around the expressions.
+  size_t tree_bytes =
+      Heap::used(HEAP_AST) - before - program.size() * sizeof(Expression);
+
+  FlatExpr flat;
+  std::vector<FlatRef> refs;
+  for (Expr *expr : exprs)
+    refs.push_back(flat.add(expr));
+  size_t nodes = flat.nodes() / count;
+
+  std::unique_ptr<PerfCounters> counters;
+  if (getenv("CCLOX_PERF_COUNTERS") != nullptr)
+    counters = std::make_unique<PerfCounters>();
+
+  Interpreter tree_interpreter, flat_interpreter;
+  Measurement tree =
+      measure(tree_interpreter, counters.get(), iterations, [&]() {
+        for (Expr *expr : exprs)
+          tree_interpreter.evaluate(expr);
+      });
+  Measurement flattened =
+      measure(flat_interpreter, counters.get(), iterations, [&]() {
+        for (FlatRef ref : refs)
+          flat_interpreter.evaluate(flat, ref);
+      });
+
+  double evaluated = (double)count * iterations;
+  std::cout << count << " expressions of " << nodes << " nodes x "
+            << iterations << " iterations" << std::endl;
+  std::cout << "tree: " << tree_bytes / flat.nodes() << " bytes/node, flat: "
+            << flat.bytes() / flat.nodes() << " bytes/node" << std::endl;
+  print("tree: ", tree, evaluated, nodes, counters.get());
+  print("flat: ", flattened, evaluated, nodes, counters.get());
+  if (counters != nullptr && !counters->available())
+    std::cout << "(no hardware counters: " << counters->error() << ")"
+              << std::endl;
+  std::cout << "speedup: " << tree.ns / flattened.ns << "x" << std::endl;
+  if (tree.checksum != flattened.checksum) {
+    std::cerr << "results differ" << std::endl;
+    return 1;
+  }
+
+  for (Stmt *stmt : program)
+    delete stmt;
+  return 0;
+}
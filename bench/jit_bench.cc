@@ -0,0 +1,91 @@
+// Compares the tree-walker with the JIT on a block of numeric statements.
+// With CCLOX_PERF_COUNTERS=1 in the environment it also prints the hardware
+// counters of each. Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: JitBench [statements] [iterations]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+#include "parser.h"
+#include "perf_counters.h"
+#include "scanner.h"
+
+static std::string numeric_block(int statements) {
+  const int vars = 8;
+  std::string source = "{\n";
+  for (int v = 0; v < vars; v++)
+    source += "var v" + std::to_string(v) + " = " + std::to_string(v + 1) +
+              ".5;\n";
+  for (int i = 0; i < statements; i++) {
+    auto var = [&](int k) { return "v" + std::to_string((i + k) % vars); };
+    source += var(0) + " = " + var(1) + " * 0.999 + " + var(2) + " / 3 - " +
+              var(3) + " * (" + var(4) + " - 1);\n";
+  }
+  return source + "}\n";
+}
+
+static double run(std::vector<Stmt *> &statements, int iterations, bool jit,
+                  PerfCounters *counters, PerfSample &sample) {
+  Interpreter interpreter;
+  if (jit)
+    interpreter.enable_jit();
+
+  if (counters != nullptr)
+    counters->start();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++)
+    interpreter.interpret(statements);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  if (counters != nullptr)
+    sample = counters->stop();
+
+  interpreter.release_code();
+  return std::chrono::duration<double, std::nano>(elapsed).count();
+}
+
+int main(int argc, char *argv[]) {
+  int statements = argc > 1 ? atoi(argv[1]) : 1000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 200;
+
+  Scanner scanner(numeric_block(statements));
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> program = parser.parse();
+
+  std::unique_ptr<PerfCounters> counters;
+  if (getenv("CCLOX_PERF_COUNTERS") != nullptr)
+    counters = std::make_unique<PerfCounters>();
+
+  double executed = (double)statements * iterations;
+  PerfSample tree_sample, jit_sample;
+  double tree_walker =
+      run(program, iterations, false, counters.get(), tree_sample);
+  double jit = run(program, iterations, true, counters.get(), jit_sample);
+
+  std::cout << statements << " statements x " << iterations << " iterations"
+            << std::endl;
+  std::cout << "tree-walker: " << tree_walker / executed << " ns/statement"
+            << std::endl;
+  std::cout << "jit:         " << jit / executed << " ns/statement"
+            << std::endl;
+  std::cout << "speedup:     " << tree_walker / jit << "x" << std::endl;
+  if (counters != nullptr && counters->available()) {
+    size_t nodes = parser.node_count() * iterations;
+    std::cout << "tree-walker: ";
+    tree_sample.print(std::cout, nodes);
+    std::cout << std::endl << "jit:         ";
+    jit_sample.print(std::cout, nodes);
+    std::cout << std::endl;
+  } else if (counters != nullptr) {
+    std::cout << "(no hardware counters: " << counters->error() << ")"
+              << std::endl;
+  }
+
+  for (Stmt *stmt : program)
+    delete stmt;
+  return 0;
+}
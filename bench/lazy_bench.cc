@@ -0,0 +1,83 @@
+// Compares eager, lazy and strict lazy parsing of a script made of many
+// blocks: the time and AST bytes up to the first statement running, and the
+// time of a full run, which parses every lazy block when it is reached.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: LazyBench [blocks] [statements per block]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "heap.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+
+static std::string blocks_script(int blocks, int statements) {
+  std::string source = "var total = 0;\n";
+  for (int b = 0; b < blocks; b++) {
+    source += "{\n  var x = " + std::to_string(b) + ";\n";
+    for (int i = 0; i < statements; i++)
+      source += "  x = x * 2 - (x + " + std::to_string(i) + ") / 3;\n";
+    source += "  { total = total + x; }\n}\n";
+  }
+  return source + "print total;\n";
+}
+
+struct Measurement {
+  double startup;
+  size_t ast_bytes;
+  double run;
+  std::string output;
+};
+
+static Measurement measure(const std::string &source, bool lazy, bool strict) {
+  Measurement m;
+  auto start = std::chrono::steady_clock::now();
+  Scanner scanner(source);
+  Parser parser(scanner.scanTokens());
+  parser.lazy_blocks = lazy;
+  parser.strict_blocks = strict;
+  std::vector<Stmt *> statements = parser.parse();
+  auto parsed = std::chrono::steady_clock::now();
+  m.ast_bytes = Heap::used(HEAP_AST);
+
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  interpreter.execute_statements(statements);
+  auto finished = std::chrono::steady_clock::now();
+  m.output = out.str();
+
+  m.startup = std::chrono::duration<double, std::milli>(parsed - start).count();
+  m.run = std::chrono::duration<double, std::milli>(finished - start).count();
+  for (Stmt *stmt : statements)
+    delete stmt;
+  Heap::clear(HEAP_AST);
+  Heap::clear(HEAP_TOKENS);
+  return m;
+}
+
+int main(int argc, char *argv[]) {
+  int blocks = argc > 1 ? atoi(argv[1]) : 2000;
+  int statements = argc > 2 ? atoi(argv[2]) : 50;
+  std::string source = blocks_script(blocks, statements);
+
+  std::cout << blocks << " blocks x " << statements << " statements, "
+            << source.size() / 1024 << " KiB" << std::endl;
+  const char *names[] = {"eager:  ", "lazy:   ", "strict: "};
+  Measurement eager = measure(source, false, false);
+  Measurement results[] = {eager, measure(source, true, false),
+                           measure(source, true, true)};
+  for (int i = 0; i < 3; i++) {
+    std::cout << names[i] << "startup " << results[i].startup << " ms, AST "
+              << results[i].ast_bytes / 1024 << " KiB at startup, full run "
+              << results[i].run << " ms" << std::endl;
+    if (results[i].output != eager.output)
+      std::cout << "MISMATCH" << std::endl;
+  }
+  return 0;
+}
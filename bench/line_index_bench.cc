@@ -0,0 +1,100 @@
+// Measures building the newline index of a script, looking up the line and
+// column of every token start by binary search and by the hint the scanner
+// passes along, and scanning, which builds the index and asks it for the
+// line of every token.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: LineIndexBench [megabytes] [runs]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "heap.h"
+#include "line_index.h"
+#include "scanner.h"
+
+static std::string script(size_t bytes) {
+  std::string source;
+  for (int i = 0; source.size() < bytes; i++) {
+    std::string v = "v" + std::to_string(i % 100);
+    source += "var " + v + " = " + v + " * 0.5 + (" + std::to_string(i) +
+              " - 1) / 3;\n";
+    if (i % 10 == 0)
+      source += "// A comment line.\n\n";
+  }
+  return source;
+}
+
+// The fastest of runs timings of f, in milliseconds.
+template <typename F> static double best_ms(int runs, F f) {
+  double best = 1e300;
+  for (int r = 0; r < runs; r++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best,
+                    std::chrono::duration<double, std::milli>(elapsed).count());
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  size_t megabytes = argc > 1 ? atoi(argv[1]) : 32;
+  int runs = argc > 2 ? atoi(argv[2]) : 5;
+
+  std::string source = script(megabytes << 20);
+  std::vector<TokenStart> starts;
+  {
+    Scanner scanner(source);
+    scanner.scanTokens();
+    starts = scanner.token_starts();
+    Heap::clear(HEAP_TOKENS);
+  }
+  double mb = double(source.size()) / (1 << 20);
+
+  size_t lines = 0;
+  double build = best_ms(runs, [&]() {
+    LineIndex index(source);
+    lines = index.line(source.size());
+  });
+  LineIndex index(source);
+  long sum = 0;
+  double search = best_ms(runs, [&]() {
+    for (const TokenStart &start : starts)
+      sum += index.line(start.offset);
+  });
+  double hinted = best_ms(runs, [&]() {
+    size_t hint = 0;
+    for (const TokenStart &start : starts)
+      sum += index.line(start.offset, hint);
+  });
+  double columns = best_ms(runs, [&]() {
+    for (const TokenStart &start : starts)
+      sum += index.column(start.offset);
+  });
+  size_t hint = 0;
+  for (const TokenStart &start : starts) {
+    if (index.line(start.offset, hint) != index.line(start.offset)) {
+      std::cerr << "wrong line at " << start.offset << std::endl;
+      return 1;
+    }
+  }
+  double scan = best_ms(runs, [&]() {
+    Scanner scanner(source);
+    scanner.scanTokens();
+    Heap::clear(HEAP_TOKENS);
+  });
+
+  std::cout << mb << " MB, " << lines << " lines, " << starts.size()
+            << " tokens (" << sum % 10 << ")" << std::endl;
+  std::cout << "build index: " << build << " ms (" << mb / build * 1000
+            << " MB/s)" << std::endl;
+  std::cout << "line of every token: binary search " << search
+            << " ms, hinted " << hinted << " ms; column " << columns << " ms"
+            << std::endl;
+  std::cout << "scan including the index: " << scan << " ms, index "
+            << 100 * build / scan << "%" << std::endl;
+  return 0;
+}
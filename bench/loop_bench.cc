@@ -0,0 +1,93 @@
+// Measures loop throughput: a for loop whose block body reuses one frame,
+// the same loop with the body nested in a second block, which makes and
+// deletes a frame every iteration as execute_block does, and looping outside
+// of Lox, scanning, parsing and running the body once per iteration.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: LoopBench [iterations]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+
+static const char *BODY = "var x = i * 0.5; var y = x + 1; sum = sum + x * y;";
+
+static double time_ns(const std::string &source, std::string &output) {
+  Scanner scanner(source);
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+
+  auto start = std::chrono::steady_clock::now();
+  interpreter.interpret(statements);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  output = out.str();
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return std::chrono::duration<double, std::nano>(elapsed).count();
+}
+
+// Runs the body once per iteration as a program of its own, with i and sum
+// carried over in the globals.
+static double external_ns(int iterations, std::string &output) {
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  ExprValue value;
+  value.type = VALNUMBER;
+  interpreter.set_global("sum", value);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    value.number = i;
+    interpreter.set_global("i", value);
+    Scanner scanner(std::string("{") + BODY + "}");
+    Parser parser(scanner.scanTokens());
+    std::vector<Stmt *> statements = parser.parse();
+    interpreter.interpret(statements);
+    for (Stmt *stmt : statements)
+      delete stmt;
+  }
+  Scanner scanner("print sum;");
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  interpreter.interpret(statements);
+  delete statements[0];
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  output = out.str();
+  return std::chrono::duration<double, std::nano>(elapsed).count();
+}
+
+int main(int argc, char *argv[]) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+  std::string head = "var sum = 0;\nfor (var i = 0; i < " +
+                     std::to_string(iterations) + "; i = i + 1) ";
+
+  std::string reused_out, nested_out, external_out;
+  double reused = time_ns(head + "{" + BODY + "}\nprint sum;", reused_out);
+  double nested = time_ns(head + "{{" + BODY + "}}\nprint sum;", nested_out);
+  double external = external_ns(iterations, external_out);
+
+  std::cout << iterations << " iterations" << std::endl;
+  std::cout << "reused frame:     " << reused / iterations << " ns/iteration"
+            << std::endl;
+  std::cout << "frame/iteration:  " << nested / iterations << " ns/iteration"
+            << std::endl;
+  std::cout << "external loop:    " << external / iterations
+            << " ns/iteration" << std::endl;
+  if (reused_out != nested_out || reused_out != external_out) {
+    std::cerr << "results differ" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,82 @@
+// Loads a program importing many modules with one worker thread, with
+// several, and again from the warm cache, where only the modification times
+// are checked. Each module is a long run of arithmetic over its own globals.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: ModuleBench [modules] [statements per module] [threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "modules.h"
+#include "parser.h"
+#include "scanner.h"
+
+static std::string module_source(int m, int statements) {
+  std::string v = "m" + std::to_string(m) + "_";
+  std::string source;
+  for (int s = 0; s < statements; s++)
+    source += "var " + v + std::to_string(s) + " = " + std::to_string(s) +
+              " * 2 + (" + std::to_string(m) + " - 1) / 3;\n";
+  return source;
+}
+
+static double load_ms(ModuleCache &cache, const std::vector<Stmt *> &program,
+                      const std::string &directory) {
+  auto start = std::chrono::steady_clock::now();
+  if (!cache.load(program, directory))
+    exit(1);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+int main(int argc, char *argv[]) {
+  int modules = argc > 1 ? atoi(argv[1]) : 64;
+  int statements = argc > 2 ? atoi(argv[2]) : 2000;
+  unsigned threads = argc > 3 ? atoi(argv[3]) : 4;
+
+  char path[] = "/tmp/module_benchXXXXXX";
+  std::string directory = mkdtemp(path);
+  std::string source;
+  for (int m = 0; m < modules; m++) {
+    std::string name = "m" + std::to_string(m) + ".lox";
+    std::ofstream(directory + "/" + name) << module_source(m, statements);
+    source += "import \"" + name + "\";\n";
+  }
+  Scanner scanner(source);
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> program = parser.parse();
+
+  double serial, parallel, warm;
+  {
+    ModuleCache cache;
+    cache.threads = 1;
+    serial = load_ms(cache, program, directory);
+  }
+  {
+    ModuleCache cache;
+    cache.threads = threads;
+    parallel = load_ms(cache, program, directory);
+    warm = load_ms(cache, program, directory);
+    if (cache.reused != size_t(modules))
+      std::cerr << "modules parsed again from a warm cache" << std::endl;
+  }
+  std::cout << modules << " modules x " << statements << " statements"
+            << std::endl;
+  std::cout << "1 thread: " << serial << " ms, " << threads
+            << " threads: " << parallel << " ms, speedup "
+            << serial / parallel << "x" << std::endl;
+  std::cout << "warm cache: " << warm << " ms" << std::endl;
+
+  for (Stmt *stmt : program)
+    delete stmt;
+  for (int m = 0; m < modules; m++)
+    unlink((directory + "/m" + std::to_string(m) + ".lox").c_str());
+  rmdir(directory.c_str());
+  return 0;
+}
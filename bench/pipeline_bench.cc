@@ -0,0 +1,77 @@
+// Compares scanning then parsing a large script with scanning on a second
+// thread while parsing (ScannerThread), in wall-clock time.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: PipelineBench [megabytes] [runs]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "heap.h"
+#include "parser.h"
+#include "scanner.h"
+#include "scanner_thread.h"
+
+static std::string script(size_t bytes) {
+  std::string source;
+  for (int i = 0; source.size() < bytes; i++) {
+    std::string v = "v" + std::to_string(i % 100);
+    source += "var " + v + " = " + v + " * 0.5 + \"label\" + (" +
+              std::to_string(i) + " - 1) / 3;\n{ print " + v + "; }\n";
+  }
+  return source;
+}
+
+// Returns the milliseconds to scan and parse source.
+static double parse(const std::string &source, bool pipelined) {
+  auto start = std::chrono::steady_clock::now();
+  std::shared_ptr<std::vector<Token>> tokens;
+  std::unique_ptr<ScannerThread> scanner_thread;
+  if (pipelined) {
+    scanner_thread = std::make_unique<ScannerThread>(source);
+    tokens = std::make_shared<std::vector<Token>>();
+  } else {
+    Scanner scanner(source);
+    tokens = scanner.scanTokens();
+  }
+  Parser parser(tokens);
+  if (pipelined)
+    parser.stream = &scanner_thread->tokens();
+  std::vector<Stmt *> statements = parser.parse();
+  if (pipelined)
+    scanner_thread->join();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  for (Stmt *stmt : statements)
+    delete stmt;
+  Heap::clear(HEAP_AST);
+  Heap::clear(HEAP_TOKENS);
+  return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+int main(int argc, char *argv[]) {
+  double megabytes = argc > 1 ? atof(argv[1]) : 8;
+  int runs = argc > 2 ? atoi(argv[2]) : 3;
+
+  std::string source = script(megabytes * 1024 * 1024);
+  double sequential = 1e300, pipelined = 1e300;
+  for (int i = 0; i < runs; i++) {
+    sequential = std::min(sequential, parse(source, false));
+    pipelined = std::min(pipelined, parse(source, true));
+  }
+
+  double mib = source.size() / 1024.0 / 1024.0;
+  std::cout << mib << " MiB, best of " << runs << " runs, "
+            << std::thread::hardware_concurrency() << " hardware threads"
+            << std::endl;
+  std::cout << "scan then parse: " << sequential << " ms ("
+            << mib / sequential * 1000 << " MiB/s)" << std::endl;
+  std::cout << "pipelined:       " << pipelined << " ms ("
+            << mib / pipelined * 1000 << " MiB/s)" << std::endl;
+  std::cout << "speedup:         " << sequential / pipelined << "x" << std::endl;
+  return 0;
+}
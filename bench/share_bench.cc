@@ -0,0 +1,138 @@
+// Compares parsing with and without Parser::share_exprs on a corpus: AST
+// nodes and bytes, parse time and the time of a run, whose output must not
+// change. Without arguments the corpus is a few generated scripts.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: ShareBench [script...]
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "heap.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+
+// Statements over a handful of variables, as in FlatBench.
+static std::string expressions_script(int count) {
+  std::string source;
+  for (int v = 0; v < 8; v++)
+    source += "var v" + std::to_string(v) + " = " + std::to_string(v) + ";\n";
+  for (int i = 0; i < count; i++) {
+    auto var = [&](int k) { return "v" + std::to_string((i + k) % 8); };
+    source += var(0) + " = " + var(1) + " * 0.5 + " + var(2) + " / 3 - (" +
+              var(3) + " - " + var(4) + ") * 0.1;\n";
+  }
+  return source;
+}
+
+// Blocks of the same statements on fresh locals, as in LazyBench.
+static std::string blocks_script(int blocks, int statements) {
+  std::string source = "var total = 0;\n";
+  for (int b = 0; b < blocks; b++) {
+    source += "{\n  var x = " + std::to_string(b % 10) + ";\n";
+    for (int i = 0; i < statements; i++)
+      source += "  x = x * 2 - (x + " + std::to_string(i) + ") / 3;\n";
+    source += "  total = total + x;\n}\n";
+  }
+  return source + "print total;\n";
+}
+
+// Generated code with constant subexpressions and repeated reads per line.
+static std::string formulas_script(int count) {
+  std::string source = "var r = 1;\nvar s = \"\";\n";
+  for (int i = 0; i < count; i++) {
+    source += "r = (r * r + r) / (r * r + 1) + (1 - 0.5 * 2) * " +
+              std::to_string(i % 16) + ";\n";
+    source += "if (r * r > 4 == false) s = s + \"x\"; else s = \"\";\n";
+  }
+  return source + "print r;\nprint s == \"\";\n";
+}
+
+struct Measurement {
+  int nodes;
+  size_t ast_bytes;
+  double parse_ms;
+  double run_ms;
+  std::string output;
+};
+
+static Measurement measure(const std::string &source, bool share) {
+  Measurement m;
+  auto start = std::chrono::steady_clock::now();
+  Scanner scanner(source);
+  std::vector<Stmt *> statements;
+  {
+    Parser parser(scanner.scanTokens());
+    parser.share_exprs = share;
+    statements = parser.parse();
+    m.nodes = parser.node_count();
+  }
+  auto parsed = std::chrono::steady_clock::now();
+  m.ast_bytes = Heap::used(HEAP_AST);
+
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  try {
+    interpreter.execute_statements(statements);
+  } catch (RuntimeError e) {
+    out << "[line " << e.op.line << "] " << e.what() << std::endl;
+  }
+  auto finished = std::chrono::steady_clock::now();
+  m.output = out.str();
+
+  m.parse_ms = std::chrono::duration<double, std::milli>(parsed - start).count();
+  m.run_ms = std::chrono::duration<double, std::milli>(finished - parsed).count();
+  for (Stmt *stmt : statements)
+    delete stmt;
+  Heap::clear(HEAP_AST);
+  Heap::clear(HEAP_TOKENS);
+  return m;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<std::pair<std::string, std::string>> corpus;
+  for (int i = 1; i < argc; i++) {
+    std::ifstream fin(argv[i]);
+    std::stringstream buffer;
+    buffer << fin.rdbuf();
+    corpus.push_back({argv[i], buffer.str()});
+  }
+  if (corpus.empty()) {
+    corpus.push_back({"expressions", expressions_script(100000)});
+    corpus.push_back({"blocks", blocks_script(2000, 50)});
+    corpus.push_back({"formulas", formulas_script(50000)});
+  }
+
+  size_t total_plain = 0, total_shared = 0;
+  bool mismatch = false;
+  for (auto &script : corpus) {
+    Measurement plain = measure(script.second, false);
+    Measurement shared = measure(script.second, true);
+    total_plain += plain.ast_bytes;
+    total_shared += shared.ast_bytes;
+    std::cout << script.first << ": " << plain.nodes << " -> " << shared.nodes
+              << " nodes, " << plain.ast_bytes / 1024 << " -> "
+              << shared.ast_bytes / 1024 << " KiB ("
+              << 100.0 * (plain.ast_bytes - shared.ast_bytes) /
+                     plain.ast_bytes
+              << "% saved), parse " << plain.parse_ms << " -> "
+              << shared.parse_ms << " ms, run " << plain.run_ms << " -> "
+              << shared.run_ms << " ms" << std::endl;
+    if (plain.output != shared.output) {
+      std::cout << "MISMATCH" << std::endl;
+      mismatch = true;
+    }
+  }
+  std::cout << "total: " << total_plain / 1024 << " -> "
+            << total_shared / 1024 << " KiB ("
+            << 100.0 * (total_plain - total_shared) / total_plain
+            << "% saved)" << std::endl;
+  return mismatch ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+// Compares running a large generated script whole, scanned and parsed before
+// it runs, with running it through StreamRunner: the time until the first
+// line is printed, the total time, and the most bytes the heap account held
+// for the AST and tokens. The source, the scanner's copy of it and its
+// newline index are held whole either way and are not in the account.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: StreamBench [megabytes]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "heap.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+#include "stream.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static std::string script(size_t bytes) {
+  std::string source = "var total = 0;\n";
+  for (int i = 0; source.size() < bytes; i++) {
+    std::string n = std::to_string(i), v = "v" + std::to_string(i % 100);
+    source += "var " + v + " = " + n + " * 0.5 + (total - 1) / 3;\n";
+    source += "total = total + " + v + ";\n";
+    if (i % 1000 == 0)
+      source += "print total;\n";
+  }
+  return source;
+}
+
+// Drops what is written, noting when the first character came.
+class FirstWrite : public std::streambuf {
+public:
+  Clock::time_point first;
+  bool written = false;
+
+protected:
+  int overflow(int c) override {
+    note();
+    return c;
+  }
+  std::streamsize xsputn(const char *, std::streamsize n) override {
+    note();
+    return n;
+  }
+
+private:
+  void note() {
+    if (!written)
+      first = Clock::now(), written = true;
+  }
+};
+
+static double ms(Clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+int main(int argc, char *argv[]) {
+  size_t megabytes = argc > 1 ? atoi(argv[1]) : 64;
+  std::string source = script(megabytes << 20);
+
+  for (bool streaming : {false, true}) {
+    FirstWrite sink;
+    std::ostream out(&sink);
+    Interpreter interpreter;
+    interpreter.set_output(out);
+    Heap::reset_peak();
+
+    auto start = Clock::now();
+    if (streaming) {
+      StreamRunner runner(interpreter);
+      runner.run(source);
+    } else {
+      Scanner scanner(source);
+      Parser parser(scanner.scanTokens());
+      std::vector<Stmt *> statements = parser.parse();
+      interpreter.interpret(statements);
+      for (Stmt *stmt : statements)
+        delete stmt;
+      Heap::clear(HEAP_AST);
+      Heap::clear(HEAP_TOKENS);
+    }
+    auto end = Clock::now();
+
+    std::cout << (streaming ? "streaming" : "whole") << ", "
+              << double(source.size()) / (1 << 20) << " MB: first output "
+              << ms(sink.first - start) << " ms, total " << ms(end - start)
+              << " ms, AST and tokens peak " << Heap::peak() / 1024 << " KB"
+              << std::endl;
+  }
+  return 0;
+}
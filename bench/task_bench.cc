@@ -0,0 +1,121 @@
+// Round-robins many scripts as Tasks over a few worker threads and compares
+// the time with running each script straight through, also reporting the
+// longest a task waited between two of its turns.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: TaskBench [tasks] [iterations per task] [slice] [threads]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static std::string script(int iterations) {
+  return "var total = 0;\n"
+         "for (var i = 0; i < " +
+         std::to_string(iterations) +
+         "; i = i + 1) {\n"
+         "  var x = i * 2;\n"
+         "  if (x > 10) { total = total + x; } else total = total - 1;\n"
+         "}\n";
+}
+
+struct Queued {
+  Task *task;
+  Clock::time_point since;
+};
+
+int main(int argc, char *argv[]) {
+  int tasks = argc > 1 ? atoi(argv[1]) : 2000;
+  int iterations = argc > 2 ? atoi(argv[2]) : 500;
+  uint64_t slice = argc > 3 ? atoi(argv[3]) : 100;
+  int threads = argc > 4 ? atoi(argv[4]) : 4;
+
+  Scanner scanner(script(iterations));
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+
+  auto start = Clock::now();
+  for (int t = 0; t < tasks; t++) {
+    Interpreter interpreter;
+    interpreter.execute_statements(statements);
+  }
+  double straight =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  std::vector<std::unique_ptr<Task>> all;
+  std::deque<Queued> queue;
+  start = Clock::now();
+  for (int t = 0; t < tasks; t++) {
+    all.push_back(std::make_unique<Task>(statements));
+    queue.push_back({all.back().get(), start});
+  }
+  std::mutex mutex;
+  std::vector<double> worst(threads, 0);
+  std::vector<uint64_t> turns(threads, 0);
+  std::vector<std::thread> workers;
+  for (int w = 0; w < threads; w++) {
+    workers.emplace_back([&, w]() {
+      Interpreter interpreter;
+      while (true) {
+        Queued next;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (queue.empty())
+            return;
+          next = queue.front();
+          queue.pop_front();
+        }
+        worst[w] = std::max(
+            worst[w], std::chrono::duration<double, std::milli>(
+                          Clock::now() - next.since)
+                          .count());
+        interpreter.resume(*next.task, slice);
+        turns[w]++;
+        if (next.task->done())
+          continue;
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({next.task, Clock::now()});
+      }
+    });
+  }
+  for (std::thread &worker : workers)
+    worker.join();
+  double multiplexed =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  uint64_t total_turns = 0;
+  for (uint64_t t : turns)
+    total_turns += t;
+  std::cout << tasks << " tasks x " << iterations << " iterations, slices of "
+            << slice << " on " << threads << " threads" << std::endl;
+  std::cout << "straight, one thread: " << straight << " ms" << std::endl;
+  std::cout << "multiplexed: " << multiplexed << " ms, " << total_turns
+            << " turns, longest wait "
+            << *std::max_element(worst.begin(), worst.end()) << " ms"
+            << std::endl;
+  for (auto &task : all) {
+    if (task->global_environment().bindings().at("total").number !=
+        all[0]->global_environment().bindings().at("total").number) {
+      std::cerr << "results differ" << std::endl;
+      return 1;
+    }
+  }
+
+  all.clear();
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return 0;
+}
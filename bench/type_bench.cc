@@ -0,0 +1,89 @@
+// Compares running numeric scripts dynamically with running them after
+// TypeInference, which unboxes the numbers it proves: a loop over a few
+// numeric locals, and FlatBench's straight-line expressions over globals.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: TypeBench [iterations] [expressions]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+#include "type_inference.h"
+
+static std::string loop_script(int iterations) {
+  return "var sum = 0;\n"
+         "for (var i = 0; i < " +
+         std::to_string(iterations) +
+         "; i = i + 1) {\n"
+         "  var x = i * 0.5; var y = x + 1;\n"
+         "  sum = sum + x * y - (y - x) / 2;\n"
+         "}\n"
+         "print sum;\n";
+}
+
+static std::string expressions_script(int count) {
+  std::string source;
+  for (int v = 0; v < 8; v++)
+    source += "var v" + std::to_string(v) + " = " + std::to_string(v) + ";\n";
+  for (int i = 0; i < count; i++) {
+    auto var = [&](int k) { return "v" + std::to_string((i + k) % 8); };
+    source += var(0) + " = " + var(1) + " * 0.5 + " + var(2) + " / 3 - (" +
+              var(3) + " - " + var(4) + ") * 0.1;\n";
+  }
+  return source + "print v0 + v7;\n";
+}
+
+static double run_ms(const std::string &source, bool infer,
+                     std::string &output) {
+  Scanner scanner(source);
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  if (infer) {
+    TypeInference inference(true);
+    inference.infer(statements);
+    inference.report(std::cout);
+  }
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+
+  auto start = std::chrono::steady_clock::now();
+  interpreter.interpret(statements);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  output = out.str();
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+int main(int argc, char *argv[]) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+  int expressions = argc > 2 ? atoi(argv[2]) : 200000;
+
+  struct {
+    const char *name;
+    std::string source;
+  } scripts[] = {{"loop", loop_script(iterations)},
+                 {"expressions", expressions_script(expressions)}};
+  bool mismatch = false;
+  for (auto &script : scripts) {
+    std::string dynamic_output, inferred_output;
+    double dynamic = run_ms(script.source, false, dynamic_output);
+    double inferred = run_ms(script.source, true, inferred_output);
+    std::cout << script.name << ": dynamic " << dynamic << " ms, inferred "
+              << inferred << " ms, speedup " << dynamic / inferred << "x"
+              << std::endl;
+    if (dynamic_output != inferred_output) {
+      std::cout << "MISMATCH" << std::endl;
+      mismatch = true;
+    }
+  }
+  return mismatch ? 1 : 0;
+}
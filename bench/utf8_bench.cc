@@ -0,0 +1,74 @@
+// Measures the UTF-8 check the scanner runs before lexing, with SIMD and
+// byte at a time, against the time scanning takes, on an ASCII script and
+// on one with a UTF-8 string literal and identifier on every line.
+// Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+// Usage: Utf8Bench [megabytes] [runs]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "heap.h"
+#include "scanner.h"
+#include "utf8.h"
+
+static std::string script(size_t bytes, bool unicode) {
+  std::string source;
+  for (int i = 0; source.size() < bytes; i++) {
+    std::string v = (unicode ? "\xce\xb4" : "d") + std::to_string(i % 100);
+    source += "var " + v + " = " + v + " * 0.5 + \"" +
+              (unicode ? "\xc3\xa9tiquette \xe6\x97\xa5" : "etiquette") +
+              "\" + (" + std::to_string(i) + " - 1) / 3;\n";
+  }
+  return source;
+}
+
+// The fastest of runs timings of f, in milliseconds.
+template <typename F> static double best_ms(int runs, F f) {
+  double best = 1e300;
+  for (int r = 0; r < runs; r++) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    best = std::min(best,
+                    std::chrono::duration<double, std::milli>(elapsed).count());
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  size_t megabytes = argc > 1 ? atoi(argv[1]) : 32;
+  int runs = argc > 2 ? atoi(argv[2]) : 5;
+
+  for (bool unicode : {false, true}) {
+    std::string source = script(megabytes << 20, unicode);
+    size_t offset = 0;
+    double simd = best_ms(runs, [&]() {
+      offset = utf8_error_offset(source.data(), source.size());
+    });
+    double scalar = best_ms(runs, [&]() {
+      offset = std::min(offset, utf8_error_offset_scalar(source.data(),
+                                                         source.size()));
+    });
+    if (offset != source.size()) {
+      std::cerr << "invalid UTF-8 at " << offset << std::endl;
+      return 1;
+    }
+    double scan = best_ms(runs, [&]() {
+      Scanner scanner(source);
+      scanner.scanTokens();
+      Heap::clear(HEAP_TOKENS);
+    });
+    double mb = double(source.size()) / (1 << 20);
+    std::cout << (unicode ? "unicode" : "ascii") << ", " << mb << " MB:"
+              << std::endl;
+    std::cout << "  validate: " << simd << " ms (" << mb / simd * 1000
+              << " MB/s), byte at a time " << scalar << " ms ("
+              << mb / scalar * 1000 << " MB/s)" << std::endl;
+    std::cout << "  scan including validation: " << scan
+              << " ms, validation " << 100 * simd / scan << "%" << std::endl;
+  }
+  return 0;
+}
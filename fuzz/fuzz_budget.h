@@ -0,0 +1,67 @@
+#ifndef FUZZ_BUDGET_H_
+#define FUZZ_BUDGET_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include "heap.h"
+
+// FuzzBudget fails the current input, by aborting, when the time or heap it
+// took grows faster than linearly with its size. Each limit is a fixed
+// allowance plus a per-byte rate; both can be overridden from the
+// environment, e.g. CCLOX_FUZZ_NS_PER_BYTE=5000.
+class FuzzBudget {
+public:
+  FuzzBudget(size_t size)
+      : size(size), start(std::chrono::steady_clock::now()) {
+    Heap::reset_peak();
+  }
+
+  // Heap bytes the input may hold on top of what was held before it.
+  size_t heap_budget() {
+    return env("CCLOX_FUZZ_BASE_HEAP", 1 << 20) +
+           env("CCLOX_FUZZ_HEAP_PER_BYTE", 1024) * size;
+  }
+
+  // Interpreter steps the input may take. Loops may legitimately run
+  // forever, so a script stops with a RuntimeError once it used them up,
+  // well within the time budget.
+  uint64_t step_budget() {
+    return env("CCLOX_FUZZ_BASE_STEPS", 100000) +
+           env("CCLOX_FUZZ_STEPS_PER_BYTE", 1000) * size;
+  }
+
+  void check(const char *phase) {
+    size_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    size_t time_budget = env("CCLOX_FUZZ_BASE_NS", 50000000) +
+                         env("CCLOX_FUZZ_NS_PER_BYTE", 20000) * size;
+    if (elapsed > time_budget) {
+      fprintf(stderr, "%s: %zu ns for %zu bytes, budget is %zu ns\n", phase,
+              elapsed, size, time_budget);
+      abort();
+    }
+
+    size_t heap_used = Heap::peak() - base_heap;
+    if (heap_used > heap_budget()) {
+      fprintf(stderr, "%s: %zu heap bytes for %zu bytes, budget is %zu\n",
+              phase, heap_used, size, heap_budget());
+      abort();
+    }
+  }
+
+private:
+  static size_t env(const char *name, size_t fallback) {
+    const char *value = getenv(name);
+    return value != nullptr ? strtoull(value, nullptr, 10) : fallback;
+  }
+
+  size_t size;
+  size_t base_heap = Heap::total();
+  std::chrono::steady_clock::time_point start;
+};
+
+#endif // FUZZ_BUDGET_H_
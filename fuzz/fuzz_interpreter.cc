@@ -0,0 +1,30 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "fuzz_budget.h"
+#include "heap.h"
+#include "lox.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  std::string source(reinterpret_cast<const char *>(data), size);
+
+  // Scripts may legitimately build huge strings, so the budget is also set as
+  // the heap limit; a script that reaches it stops with a RuntimeError.
+  FuzzBudget budget(size);
+  Heap::set_limit(Heap::total() + budget.heap_budget());
+  {
+    Lox lox;
+    Budget steps;
+    steps.max_steps = budget.step_budget();
+    lox.interpreter.set_budget(steps);
+    // Lox::run reports a used up budget like any other RuntimeError.
+    lox.run(source);
+  }
+  budget.check("Interpreter::interpret");
+
+  Heap::set_limit(0);
+  Lox::had_error = false;
+  Lox::had_runtime_error = false;
+  return 0;
+}
@@ -0,0 +1,27 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fuzz_budget.h"
+#include "heap.h"
+#include "lox.h"
+#include "parser.h"
+#include "scanner.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  std::string source(reinterpret_cast<const char *>(data), size);
+
+  FuzzBudget budget(size);
+  Scanner scanner(source);
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  budget.check("Parser::parse");
+
+  for (Stmt *stmt : statements)
+    delete stmt;
+  Heap::clear(HEAP_AST);
+  Heap::clear(HEAP_TOKENS);
+  Lox::had_error = false;
+  return 0;
+}
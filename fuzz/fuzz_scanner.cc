@@ -0,0 +1,21 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "fuzz_budget.h"
+#include "heap.h"
+#include "lox.h"
+#include "scanner.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  std::string source(reinterpret_cast<const char *>(data), size);
+
+  FuzzBudget budget(size);
+  Scanner scanner(source);
+  scanner.scanTokens();
+  budget.check("Scanner::scanTokens");
+
+  Heap::clear(HEAP_TOKENS);
+  Lox::had_error = false;
+  return 0;
+}
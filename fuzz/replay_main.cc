@@ -0,0 +1,38 @@
+// Runs a fuzz target over files or corpus directories without libFuzzer, so
+// the targets can be built by any compiler and replayed as regression tests.
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static void replay(const std::filesystem::path &path) {
+  std::ifstream fin(path, std::ios::binary);
+  std::stringstream buffer;
+  buffer << fin.rdbuf();
+  std::string input = buffer.str();
+  LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(input.data()),
+                         input.size());
+}
+
+int main(int argc, char *argv[]) {
+  int inputs = 0;
+  for (int i = 1; i < argc; i++) {
+    std::filesystem::path path(argv[i]);
+    if (std::filesystem::is_directory(path)) {
+      for (auto &entry : std::filesystem::directory_iterator(path)) {
+        replay(entry.path());
+        inputs++;
+      }
+    } else {
+      replay(path);
+      inputs++;
+    }
+  }
+  std::cerr << "replayed " << inputs << " inputs" << std::endl;
+  return 0;
+}
@@ -0,0 +1,199 @@
+#ifndef LOX_RUNTIME_H_
+#define LOX_RUNTIME_H_
+
+// Runtime for C++ generated by cclox --emit-cpp. Values, operators, stringify
+// and runtime error messages follow the tree-walking Interpreter exactly.
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace lox_rt {
+
+enum ValueType { VALSTRING, VALNUMBER, VALBOOL, VALNIL };
+
+struct Value {
+  double number = 0;
+  bool boolean = false;
+  std::string string;
+  ValueType type = VALNIL;
+};
+
+class RuntimeError : public std::runtime_error {
+public:
+  RuntimeError(int line, const std::string &what_arg)
+      : std::runtime_error(what_arg), line(line) {}
+
+  int line;
+};
+
+inline void report(const RuntimeError &e) {
+  std::cerr << "[line " << e.line << "] RuntimeError: " << e.what()
+            << std::endl;
+}
+
+inline Value nil() { return Value(); }
+
+inline Value number(double d) {
+  Value v;
+  v.type = VALNUMBER;
+  v.number = d;
+  return v;
+}
+
+inline Value boolean(bool b) {
+  Value v;
+  v.type = VALBOOL;
+  v.boolean = b;
+  return v;
+}
+
+inline Value string(std::string s) {
+  Value v;
+  v.type = VALSTRING;
+  v.string = std::move(s);
+  return v;
+}
+
+[[noreturn]] inline void undefined(const char *name, int line) {
+  throw RuntimeError(line, std::string("Undefined variable '") + name + "'.");
+}
+
+inline bool equal(const Value &l, const Value &r) {
+  if (l.type == VALNIL && r.type == VALNIL)
+    return true;
+  if (l.type == VALBOOL && r.type == VALBOOL)
+    return l.boolean == r.boolean;
+  if (l.type == VALNUMBER && r.type == VALNUMBER)
+    return l.number == r.number;
+  if (l.type == VALSTRING && r.type == VALSTRING)
+    return l.string == r.string;
+  return false;
+}
+
+inline bool is_truthy(const Value &v) {
+  if (v.type == VALNIL)
+    return false;
+  if (v.type == VALBOOL)
+    return v.boolean;
+  return true;
+}
+
+inline void check_numbers(const Value &l, const Value &r, int line) {
+  if (l.type != VALNUMBER || r.type != VALNUMBER)
+    throw RuntimeError(line, "Operands must be numbers.");
+}
+
+inline Value greater(const Value &l, const Value &r, int line) {
+  check_numbers(l, r, line);
+  return boolean(l.number > r.number);
+}
+
+inline Value greater_equal(const Value &l, const Value &r, int line) {
+  check_numbers(l, r, line);
+  return boolean(l.number >= r.number);
+}
+
+inline Value less(const Value &l, const Value &r, int line) {
+  check_numbers(l, r, line);
+  return boolean(l.number < r.number);
+}
+
+inline Value less_equal(const Value &l, const Value &r, int line) {
+  check_numbers(l, r, line);
+  return boolean(l.number <= r.number);
+}
+
+inline Value equal_equal(const Value &l, const Value &r, int) {
+  return boolean(equal(l, r));
+}
+
+inline Value bang_equal(const Value &l, const Value &r, int) {
+  return boolean(!equal(l, r));
+}
+
+inline Value subtract(const Value &l, const Value &r, int line) {
+  check_numbers(l, r, line);
+  return number(l.number - r.number);
+}
+
+inline Value add(const Value &l, const Value &r, int line) {
+  if (l.type == VALNUMBER && r.type == VALNUMBER)
+    return number(l.number + r.number);
+  if (l.type == VALSTRING && r.type == VALSTRING)
+    return string(l.string + r.string);
+  throw RuntimeError(line, "Operands must be two numbers or two strings.");
+}
+
+inline Value divide(const Value &l, const Value &r, int line) {
+  check_numbers(l, r, line);
+  if (r.number == 0)
+    throw RuntimeError(line, "Attempt to divide by zero.");
+  return number(l.number / r.number);
+}
+
+inline Value multiply(const Value &l, const Value &r, int line) {
+  check_numbers(l, r, line);
+  return number(l.number * r.number);
+}
+
+inline Value negate(const Value &v, int line) {
+  if (v.type != VALNUMBER)
+    throw RuntimeError(line, "Operand must be a number.");
+  return number(-v.number);
+}
+
+inline Value bang(const Value &v, int) { return boolean(!is_truthy(v)); }
+
+inline std::string stringify(const Value &v) {
+  if (v.type == VALNIL)
+    return "nil";
+  if (v.type == VALSTRING)
+    return v.string;
+  if (v.type == VALNUMBER)
+    return std::to_string(v.number);
+  return std::to_string(v.boolean);
+}
+
+inline void print(const Value &v) { std::cout << stringify(v) << std::endl; }
+
+// The standard natives, see Natives.
+inline void check_argument(const Value &v, ValueType type, const char *what,
+                           const char *native, int line) {
+  if (v.type != type)
+    throw RuntimeError(line, std::string("Argument 1 of '") + native +
+                                 "' must be " + what + ".");
+}
+
+inline Value native_clock(int) {
+  static const auto start = std::chrono::steady_clock::now();
+  return number(std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count());
+}
+
+inline Value native_sqrt(const Value &x, int line) {
+  check_argument(x, VALNUMBER, "a number", "sqrt", line);
+  return number(std::sqrt(x.number));
+}
+
+inline Value native_floor(const Value &x, int line) {
+  check_argument(x, VALNUMBER, "a number", "floor", line);
+  return number(std::floor(x.number));
+}
+
+inline Value native_abs(const Value &x, int line) {
+  check_argument(x, VALNUMBER, "a number", "abs", line);
+  return number(std::fabs(x.number));
+}
+
+inline Value native_len(const Value &s, int line) {
+  check_argument(s, VALSTRING, "a string", "len", line);
+  return number(s.string.size());
+}
+
+} // namespace lox_rt
+
+#endif // LOX_RUNTIME_H_
@@ -2,6 +2,7 @@
 #define AST_PRINTER_H_
 
 #include <string>
+#include <vector>
 
 #include "expr.h"
 
@@ -0,0 +1,59 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "expr.h"
+
+// BatchResult holds one value per row. Booleans are stored as 0 and 1.
+struct BatchResult {
+  ValueType type;
+  std::vector<double> values;
+  // 1 where evaluating the row raised a RuntimeError, such as a division by
+  // zero; the value of such a row is meaningless.
+  std::vector<uint8_t> errors;
+};
+
+// Batch evaluates one expression over many rows, column at a time. Each
+// variable is bound to a column of numbers and every Binary, Unary and
+// Grouping node runs as one vectorized kernel over a chunk of rows, instead
+// of one Interpreter::evaluate tree walk per row.
+//
+// Only numbers, booleans and nil are supported; strings, assignments and
+// calls throw a RuntimeError, as does a variable that is not bound.
+class Batch {
+public:
+  // Binds variable name to column, which must hold a value for every row.
+  void bind(const std::string &name, const double *column) {
+    columns[name] = column;
+  }
+
+  BatchResult evaluate(Expr *expr, size_t rows);
+
+private:
+  // The value of a node over the current chunk: either a constant or a
+  // column, plus the rows that raised an error so far.
+  struct Operand {
+    ValueType type;
+    bool constant;
+    double scalar;
+    const double *data;
+    std::vector<double> owned;
+    std::vector<uint8_t> errors;
+  };
+
+  void evaluate_chunk(Expr *expr, size_t begin, size_t count,
+                      BatchResult &result);
+  Operand leaf(Expr *expr, size_t begin);
+  void unary(Unary *unary, Operand &operand, size_t count);
+  void binary(Binary *binary, Operand &left, Operand &right, size_t count);
+
+  std::map<std::string, const double *> columns;
+  // Constant operands broadcast to a column for the kernels.
+  std::vector<double> broadcast[2];
+};
+
+#endif // BATCH_H_
@@ -0,0 +1,382 @@
+#include "cpp_emitter.h"
+#include "modules.h"
+
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+// Runtime functions implementing each binary operator.
+static const char *binary_function(TokenType type) {
+  switch (type) {
+  case GREATER:
+    return "greater";
+  case GREATER_EQUAL:
+    return "greater_equal";
+  case LESS:
+    return "less";
+  case LESS_EQUAL:
+    return "less_equal";
+  case BANG_EQUAL:
+    return "bang_equal";
+  case EQUAL_EQUAL:
+    return "equal_equal";
+  case MINUS:
+    return "subtract";
+  case PLUS:
+    return "add";
+  case SLASH:
+    return "divide";
+  case STAR:
+    return "multiply";
+  default:
+    return nullptr;
+  }
+}
+
+static std::string string_literal(const std::string &value) {
+  std::string literal = "\"";
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\') {
+      literal += '\\';
+      literal += c;
+    } else if (c < 0x20 || c >= 0x7F) {
+      // Octal escapes take at most three digits, so they cannot run into
+      // the characters that follow.
+      char escape[5];
+      snprintf(escape, sizeof(escape), "\\%03o", c);
+      literal += escape;
+    } else {
+      literal += c;
+    }
+  }
+  return literal + "\"";
+}
+
+// A C++ identifier for the Lox name, which may hold non-ASCII letters.
+static std::string identifier(const std::string &name) {
+  std::string id;
+  for (unsigned char c : name) {
+    if (c < 0x80) {
+      id += c;
+    } else {
+      char escape[4];
+      snprintf(escape, sizeof(escape), "_%02x", c);
+      id += escape;
+    }
+  }
+  return id;
+}
+
+// The natives runtime/lox_runtime.h defines, as native_<name>.
+static const std::set<std::string> runtime_natives = {"clock", "sqrt", "floor",
+                                                      "abs", "len"};
+
+static std::string number_literal(double value) {
+  std::ostringstream ss;
+  ss << std::setprecision(17) << value;
+  return ss.str();
+}
+
+void CppEmitter::emit(const std::vector<Stmt *> &statements) {
+  out << "// Generated by cclox --emit-cpp. Build with\n"
+      << "//   c++ -O2 -I<cclox>/runtime <this file>\n"
+      << "#include \"lox_runtime.h\"\n\n"
+      << "using namespace lox_rt;\n\n"
+      << "int main() {\n"
+      << "  try {\n";
+
+  indent = 2;
+  scopes.emplace_back();
+  for (Stmt *stmt : statements)
+    stmt->accept(this);
+  scopes.pop_back();
+
+  // Globals of modules imported in blocks are declared before all code.
+  for (const std::string &declaration : declarations)
+    out << "    " << declaration << "\n";
+  out << code.str();
+
+  out << "  } catch (const RuntimeError &e) {\n"
+      << "    report(e);\n"
+      << "    return 70;\n"
+      << "  }\n"
+      << "  return 0;\n"
+      << "}\n";
+}
+
+void CppEmitter::visit_ExpressionStmt(Expression *expression) {
+  line("(void)" + this->expression(expression->expression) + ";");
+}
+
+void CppEmitter::visit_PrintStmt(Print *print) {
+  line("print(" + expression(print->expression) + ");");
+}
+
+void CppEmitter::visit_VarStmt(Var *var) {
+  std::string value = "nil()";
+  if (var->initializer != nullptr)
+    value = expression(var->initializer);
+
+  // Environment::define keeps the first definition of a name in a scope.
+  auto &scope = scopes.back();
+  if (auto found = scope.find(var->name.lexeme); found != scope.end()) {
+    if (auto flag = defined_flags.find(found->second);
+        flag != defined_flags.end() && scopes.size() == 1)
+      line("if (!" + flag->second + ") " + found->second + " = " + value +
+           ", " + flag->second + " = true;");
+    else
+      line("(void)" + value + ";");
+    return;
+  }
+
+  std::string name =
+      "v" + std::to_string(++variables) + "_" + identifier(var->name.lexeme);
+  scope[var->name.lexeme] = name;
+  if (scopes.size() > 1 || hoisting == 0) {
+    line("Value " + name + " = " + value + ";");
+    return;
+  }
+  // A global of a module imported in a block, which may not have run.
+  std::string flag = name + "_defined";
+  declarations.push_back("Value " + name + " = nil();");
+  declarations.push_back("bool " + flag + " = false;");
+  defined_flags[name] = flag;
+  line(name + " = " + value + ", " + flag + " = true;");
+}
+
+void CppEmitter::visit_BlockStmt(Block *stmt) {
+  line("{");
+  indent++;
+  scopes.emplace_back();
+  for (Stmt *statement : stmt->statements)
+    statement->accept(this);
+  scopes.pop_back();
+  indent--;
+  line("}");
+}
+
+void CppEmitter::visit_IfStmt(If *stmt) {
+  line("if (is_truthy(" + expression(stmt->condition) + ")) {");
+  nested(stmt->then_branch);
+  if (stmt->else_branch != nullptr) {
+    line("} else {");
+    nested(stmt->else_branch);
+  }
+  line("}");
+}
+
+void CppEmitter::visit_WhileStmt(While *stmt) {
+  // The temporaries of the condition are computed anew every iteration.
+  line("while (true) {");
+  indent++;
+  line("if (!is_truthy(" + expression(stmt->condition) + "))");
+  line("  break;");
+  indent--;
+  nested(stmt->body);
+  if (stmt->increment != nullptr) {
+    indent++;
+    line("(void)" + expression(stmt->increment) + ";");
+    indent--;
+  }
+  line("}");
+}
+
+void CppEmitter::visit_ImportStmt(Import *stmt) {
+  // Like the Interpreter, runs a module once, into the globals.
+  const Module *module = stmt->module;
+  if (imported.count(module) || emitting.count(module))
+    return;
+  line("// import " + string_literal(stmt->path));
+  bool top_level = scopes.size() == 1 && hoisting == 0;
+  if (top_level && !run_flags.count(module)) {
+    imported.insert(module);
+    for (Stmt *statement : module->statements)
+      statement->accept(this);
+    return;
+  }
+
+  // Imported in a block, the module runs where the first import to be
+  // reached is, if any is. Its globals outlive the block, so they are
+  // declared at the top and checked for being defined where they are used.
+  auto [flag, added] = run_flags.emplace(module, "");
+  if (added) {
+    flag->second = "m" + std::to_string(run_flags.size()) + "_ran";
+    declarations.push_back("bool " + flag->second + " = false;");
+  }
+  line("if (!" + flag->second + ") {");
+  indent++;
+  line(flag->second + " = true;");
+  // The module sees the globals only, not the locals around the import.
+  std::vector<std::map<std::string, std::string>> locals(scopes.begin() + 1,
+                                                        scopes.end());
+  scopes.resize(1);
+  emitting.insert(module);
+  hoisting++;
+  for (Stmt *statement : module->statements)
+    statement->accept(this);
+  hoisting--;
+  emitting.erase(module);
+  scopes.insert(scopes.end(), locals.begin(), locals.end());
+  indent--;
+  line("}");
+  if (top_level)
+    imported.insert(module);
+}
+
+std::string CppEmitter::expression(Expr *expr) {
+  struct Work {
+    Expr *expr;
+    bool operands_done;
+  };
+  std::vector<Work> work{{expr, false}};
+  std::vector<std::string> values;
+
+  while (!work.empty()) {
+    Work w = work.back();
+    work.pop_back();
+
+    switch (w.expr->get_type()) {
+    case BINARY: {
+      Binary *binary = static_cast<Binary *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({binary, true});
+        work.push_back({binary->right, false});
+        work.push_back({binary->left, false});
+        break;
+      }
+      std::string right = values.back();
+      values.pop_back();
+      values.back() = temporary(
+          std::string(binary_function(binary->op.type)) + "(" + values.back() +
+          ", " + right + ", " + std::to_string(binary->op.line) + ")");
+      break;
+    }
+    case UNARY: {
+      Unary *unary = static_cast<Unary *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({unary, true});
+        work.push_back({unary->right, false});
+        break;
+      }
+      values.back() = temporary(
+          std::string(unary->op.type == MINUS ? "negate" : "bang") + "(" +
+          values.back() + ", " + std::to_string(unary->op.line) + ")");
+      break;
+    }
+    case ASSIGN: {
+      Assign *assign = static_cast<Assign *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({assign, true});
+        work.push_back({assign->value, false});
+        break;
+      }
+      if (const std::string *name = resolve(assign->name.lexeme)) {
+        if (const std::string *flag = defined_flag(*name))
+          line("if (!" + *flag + ") " + undefined(assign->name) + ";");
+        line(*name + " = " + values.back() + ";");
+      } else
+        line(undefined(assign->name) + ";");
+      break;
+    }
+    case GROUPING:
+      work.push_back({static_cast<Grouping *>(w.expr)->expression, false});
+      break;
+    case VARIABLE: {
+      Token &name = static_cast<Variable *>(w.expr)->name;
+      const std::string *resolved = resolve(name.lexeme);
+      if (resolved == nullptr)
+        values.push_back(temporary("(" + undefined(name) + ", nil())"));
+      else if (const std::string *flag = defined_flag(*resolved))
+        values.push_back(temporary(*flag + " ? " + *resolved + " : (" +
+                                   undefined(name) + ", nil())"));
+      else
+        values.push_back(temporary(*resolved));
+      break;
+    }
+    case PRIMITIVESTRING:
+      values.push_back(temporary(
+          "string(" +
+          string_literal(static_cast<PrimitiveString *>(w.expr)->value) +
+          ")"));
+      break;
+    case PRIMITIVENUMBER:
+      values.push_back(temporary(
+          "number(" +
+          number_literal(static_cast<PrimitiveNumber *>(w.expr)->value) +
+          ")"));
+      break;
+    case PRIMITIVEBOOL:
+      values.push_back(temporary(
+          static_cast<PrimitiveBool *>(w.expr)->value ? "boolean(true)"
+                                                      : "boolean(false)"));
+      break;
+    case PRIMITIVENIL:
+      values.push_back(temporary("nil()"));
+      break;
+    case CALL: {
+      Call *call = static_cast<Call *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({call, true});
+        for (auto it = call->arguments.rbegin(); it != call->arguments.rend();
+             ++it)
+          work.push_back({*it, false});
+        break;
+      }
+      std::string function = "native_" + identifier(call->name.lexeme);
+      size_t first = values.size() - call->arguments.size();
+      std::string code = function + "(";
+      for (size_t i = first; i < values.size(); i++)
+        code += values[i] + ", ";
+      code += std::to_string(call->name.line) + ")";
+      values.resize(first);
+      if (!runtime_natives.count(call->name.lexeme)) {
+        // The host links in its own natives, taking and returning Values.
+        std::string declaration = "Value " + function + "(";
+        for (size_t i = 0; i < call->arguments.size(); i++)
+          declaration += "const Value &, ";
+        line(declaration + "int);");
+      }
+      values.push_back(temporary(code));
+      break;
+    }
+    }
+  }
+
+  return values.back();
+}
+
+std::string CppEmitter::temporary(const std::string &init) {
+  std::string name = "t" + std::to_string(++temporaries);
+  line("Value " + name + " = " + init + ";");
+  return name;
+}
+
+const std::string *CppEmitter::resolve(const std::string &name) {
+  for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+    if (auto found = scope->find(name); found != scope->end())
+      return &found->second;
+  }
+  return nullptr;
+}
+
+const std::string *CppEmitter::defined_flag(const std::string &name) {
+  auto found = defined_flags.find(name);
+  return found == defined_flags.end() ? nullptr : &found->second;
+}
+
+std::string CppEmitter::undefined(const Token &name) {
+  return "undefined(" + string_literal(name.lexeme) + ", " +
+         std::to_string(name.line) + ")";
+}
+
+void CppEmitter::nested(Stmt *stmt) {
+  if (stmt == nullptr)
+    return;
+  indent++;
+  stmt->accept(this);
+  indent--;
+}
+
+void CppEmitter::line(const std::string &code) {
+  this->code << std::string(2 * indent, ' ') << code << "\n";
+}
@@ -0,0 +1,76 @@
+#ifndef CPP_EMITTER_H_
+#define CPP_EMITTER_H_
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "expr.h"
+#include "stmt.h"
+
+// CppEmitter translates a parsed program into a standalone C++ program that
+// links against runtime/lox_runtime.h and behaves like the Interpreter.
+//
+// Every expression node becomes one temporary, which keeps Lox's left to
+// right evaluation order and keeps deeply nested expressions flat. Variables
+// are resolved statically to uniquely named C++ locals; without functions
+// the declaration order in the source is also the order of execution, also
+// in loops, whose bodies are C++ blocks declaring their locals anew.
+// Modules are inlined where they are first imported. One imported inside a
+// block is inlined at each import, behind a flag that runs it once; its
+// variables are globals declared before all code, each with a flag that
+// tells whether it is defined yet.
+// Calls to the standard natives call their counterparts in the runtime;
+// the host's own natives are declared for the host to link in, as
+// Value native_<name>(const Value &..., int line).
+class CppEmitter : public StmtVisitor {
+public:
+  CppEmitter(std::ostream &out) : out(out), indent(1) {}
+
+  virtual void visit_ExpressionStmt(Expression *expression);
+  virtual void visit_PrintStmt(Print *print);
+  virtual void visit_VarStmt(Var *var);
+  virtual void visit_BlockStmt(Block *stmt);
+  virtual void visit_IfStmt(If *stmt);
+  virtual void visit_WhileStmt(While *stmt);
+  virtual void visit_ImportStmt(Import *stmt);
+
+  void emit(const std::vector<Stmt *> &statements);
+
+private:
+  // Emits the code computing expr and returns the temporary holding it.
+  std::string expression(Expr *expr);
+  std::string temporary(const std::string &init);
+  // Returns the C++ name of variable name, or null if it is undefined.
+  const std::string *resolve(const std::string &name);
+  // Returns the flag telling whether variable name is defined yet, or null
+  // if it always is where it can be resolved.
+  const std::string *defined_flag(const std::string &name);
+  std::string undefined(const Token &name);
+  void line(const std::string &code);
+  // Emits stmt, which may be null, one level deeper.
+  void nested(Stmt *stmt);
+
+  std::ostream &out;
+  // The code of main, written after the declarations it needs.
+  std::ostringstream code;
+  std::vector<std::string> declarations;
+  int indent;
+  int temporaries = 0;
+  int variables = 0;
+  std::vector<std::map<std::string, std::string>> scopes;
+  // Modules known to have run, the flags of those imported in blocks, and
+  // those being emitted.
+  std::set<const Module *> imported;
+  std::map<const Module *, std::string> run_flags;
+  std::set<const Module *> emitting;
+  // The flags of globals that may not be defined yet, by C++ name.
+  std::map<std::string, std::string> defined_flags;
+  // How many modules imported in blocks are being emitted.
+  int hoisting = 0;
+};
+
+#endif // CPP_EMITTER_H_
@@ -1,14 +1,53 @@
 #include "environment.h"
+#include "heap.h"
 #include "runtime_error.h"
 
 #include <iostream>
 
-void Environment::define(std::string name, ExprValue value) {
-  values.emplace(std::make_pair(name, value));
+// Approximate bytes held by one entry of values, excluding string contents.
+size_t Environment::entry_bytes(size_t name_length) {
+  // The red-black tree node carries three pointers and a color.
+  return sizeof(std::pair<const std::string, ExprValue>) + 4 * sizeof(void *) +
+         name_length;
+}
+
+Environment::~Environment() { release(); }
+
+void Environment::release() {
+  for (auto &v : values) {
+    Heap::release(HEAP_ENVIRONMENTS, entry_bytes(v.first.size()));
+    Heap::release(HEAP_STRINGS, v.second.string.size());
+  }
+}
+
+void Environment::reset() {
+  release();
+  while (!values.empty())
+    spare.push_back(values.extract(values.begin()));
+}
+
+void Environment::define(Token name, ExprValue value) {
+  if (values.find(name.lexeme) != values.end())
+    return;
+
+  Heap::charge(HEAP_ENVIRONMENTS, entry_bytes(name.lexeme.size()),
+               name.line);
+  Heap::charge(HEAP_STRINGS, value.string.size(), name.line);
+  if (spare.empty()) {
+    values.emplace(std::make_pair(name.lexeme, value));
+    return;
+  }
+  Values::node_type node = std::move(spare.back());
+  spare.pop_back();
+  node.key() = name.lexeme;
+  node.mapped() = value;
+  values.insert(std::move(node));
 }
 
 void Environment::assign(Token name, ExprValue value) {
   if (auto search = values.find(name.lexeme); search != values.end()) {
+    Heap::charge(HEAP_STRINGS, value.string.size(), name.line);
+    Heap::release(HEAP_STRINGS, search->second.string.size());
     search->second = value;
     return;
   }
@@ -32,9 +71,17 @@ ExprValue Environment::get(Token name) {
   throw RuntimeError(name, "Undefined variable \'" + name.lexeme + "\'.");
 }
 
+ExprValue *Environment::find(const std::string &name) {
+  for (Environment *env = this; env != nullptr; env = env->enclosing) {
+    if (auto search = env->values.find(name); search != env->values.end())
+      return &search->second;
+  }
+  return nullptr;
+}
+
 void Environment::list() {
   std::cout << "ENV contains:" << std::endl;
   for (auto &v : values) {
     std::cout << "[" << v.first << "]" << std::endl;
   }
-}
\ No newline at end of file
+}
@@ -2,6 +2,7 @@
 #define ENVIRONMENT_H_
 
 #include <map>
+#include <vector>
 
 #include "expr.h"
 
@@ -9,17 +10,38 @@ class Environment {
 public:
   Environment() : enclosing(nullptr) {}
   Environment(Environment *enclosing) : enclosing(enclosing) {}
+  ~Environment();
 
-  void define(std::string name, ExprValue value);
+  void define(Token name, ExprValue value);
   void assign(Token name, ExprValue value);
   ExprValue get(Token name);
+  // defines reports whether name is declared in this environment itself.
+  bool defines(const std::string &name) { return values.count(name) != 0; }
+  // find looks name up through the enclosing environments, or returns null.
+  ExprValue *find(const std::string &name);
+  // bindings are the names declared in this environment itself.
+  const std::map<std::string, ExprValue> &bindings() const { return values; }
   // enclosing is the envirionment which is outside of "this" environment.
   Environment *enclosing;
 
+  // reset drops every name declared in this environment itself, so it can
+  // be used again as a fresh scope. The map nodes are kept for the names
+  // defined next.
+  void reset();
+
   void list();
 
+  // The bytes define charges to the heap account for a name of name_length
+  // bytes, besides the contents of a string value.
+  static size_t entry_bytes(size_t name_length);
+
 private:
-  std::map<std::string, ExprValue> values;
+  // Returns the bytes of the entries to the heap account.
+  void release();
+
+  typedef std::map<std::string, ExprValue> Values;
+  Values values;
+  std::vector<Values::node_type> spare;
 };
 
-#endif // ENVIRONMENT_H_
\ No newline at end of file
+#endif // ENVIRONMENT_H_
@@ -0,0 +1,237 @@
+#include "expr_sharer.h"
+
+#include <cstring>
+#include <functional>
+#include <string>
+
+ExprSharer::~ExprSharer() {
+  for (Entry &entry : entries)
+    Expr::destroy(entry.expr);
+}
+
+Expr *ExprSharer::share(Expr *expr) {
+  if (expr->get_type() == ASSIGN || expr->get_type() == CALL)
+    return expr;
+  Shape shape = shape_of(expr);
+  const Entry *left = nullptr, *right = nullptr;
+  if (shape.left != nullptr && (left = find(shape.left)) == nullptr)
+    return expr;
+  if (shape.right != nullptr && (right = find(shape.right)) == nullptr)
+    return expr;
+
+  Entry entry{expr, 0, -1, false};
+  switch (shape.type) {
+  case PRIMITIVENUMBER:
+    entry.type = VALNUMBER;
+    entry.safe = true;
+    break;
+  case PRIMITIVESTRING:
+    entry.type = VALSTRING;
+    entry.safe = true;
+    break;
+  case PRIMITIVEBOOL:
+    entry.type = VALBOOL;
+    entry.safe = true;
+    break;
+  case PRIMITIVENIL:
+    entry.type = VALNIL;
+    entry.safe = true;
+    break;
+  case GROUPING:
+    entry.type = left->type;
+    entry.safe = left->safe;
+    break;
+  case UNARY:
+    if (shape.op == BANG) {
+      entry.type = VALBOOL;
+      entry.safe = right->safe;
+    } else {
+      entry.type = VALNUMBER;
+      entry.safe = right->safe && right->type == VALNUMBER;
+    }
+    break;
+  case BINARY: {
+    bool operands_safe = left->safe && right->safe;
+    bool numbers = left->type == VALNUMBER && right->type == VALNUMBER;
+    switch (shape.op) {
+    case EQUAL_EQUAL:
+    case BANG_EQUAL:
+      entry.type = VALBOOL;
+      entry.safe = operands_safe;
+      break;
+    case GREATER:
+    case GREATER_EQUAL:
+    case LESS:
+    case LESS_EQUAL:
+      entry.type = VALBOOL;
+      entry.safe = operands_safe && numbers;
+      break;
+    case PLUS:
+      // Concatenation allocates, which may exceed the heap limit.
+      if (left->type == VALSTRING && right->type == VALSTRING) {
+        entry.type = VALSTRING;
+      } else {
+        entry.type = VALNUMBER;
+        entry.safe = operands_safe && numbers;
+      }
+      break;
+    case SLASH:
+      entry.type = VALNUMBER;
+      entry.safe = operands_safe && numbers &&
+                   shape.right->get_type() == PRIMITIVENUMBER &&
+                   static_cast<PrimitiveNumber *>(shape.right)->value != 0;
+      break;
+    default:
+      entry.type = VALNUMBER;
+      entry.safe = operands_safe && numbers;
+      break;
+    }
+    break;
+  }
+  default:
+    // A variable may be undefined.
+    break;
+  }
+
+  entry.hash = hash(shape, !entry.safe);
+  size_t mask = by_structure.size() - 1;
+  for (size_t i = entry.hash & mask; !by_structure.empty() && by_structure[i];
+       i = (i + 1) & mask) {
+    Entry &found = entries[by_structure[i] - 1];
+    if (found.hash != entry.hash ||
+        !same(shape_of(found.expr), shape, !entry.safe))
+      continue;
+    // Deleting the new node drops its references to the shared children.
+    delete expr;
+    shared_nodes++;
+    found.expr->extra_owners++;
+    return found.expr;
+  }
+
+  // The table holds a reference of its own.
+  expr->extra_owners++;
+  add(entry);
+  return expr;
+}
+
+ExprSharer::Shape ExprSharer::shape_of(Expr *expr) {
+  Shape shape;
+  shape.type = expr->get_type();
+  switch (shape.type) {
+  case PRIMITIVENUMBER:
+    shape.number = static_cast<PrimitiveNumber *>(expr)->value;
+    break;
+  case PRIMITIVESTRING:
+    shape.text = &static_cast<PrimitiveString *>(expr)->value;
+    break;
+  case PRIMITIVEBOOL:
+    shape.op = static_cast<PrimitiveBool *>(expr)->value;
+    break;
+  case VARIABLE: {
+    Variable *variable = static_cast<Variable *>(expr);
+    shape.text = &variable->name.lexeme;
+    shape.line = variable->name.line;
+    break;
+  }
+  case GROUPING:
+    shape.left = static_cast<Grouping *>(expr)->expression;
+    break;
+  case UNARY: {
+    Unary *unary = static_cast<Unary *>(expr);
+    shape.op = unary->op.type;
+    shape.line = unary->op.line;
+    shape.right = unary->right;
+    break;
+  }
+  case BINARY: {
+    Binary *binary = static_cast<Binary *>(expr);
+    shape.left = binary->left;
+    shape.op = binary->op.type;
+    shape.line = binary->op.line;
+    shape.right = binary->right;
+    break;
+  }
+  default:
+    break;
+  }
+  return shape;
+}
+
+bool ExprSharer::same(const Shape &a, const Shape &b, bool lines) {
+  if (a.type != b.type || a.op != b.op || a.left != b.left ||
+      a.right != b.right || (lines && a.line != b.line))
+    return false;
+  // Bitwise, which tells 0 from -0.
+  if (memcmp(&a.number, &b.number, sizeof(a.number)) != 0)
+    return false;
+  if (a.text == nullptr || b.text == nullptr)
+    return a.text == b.text;
+  return *a.text == *b.text;
+}
+
+static size_t mix(size_t hash, size_t value) {
+  return (hash ^ value) * 0x100000001b3ULL;
+}
+
+static size_t address_hash(const void *pointer) {
+  size_t hash = (uintptr_t)pointer;
+  hash ^= hash >> 17;
+  hash *= 0x9e3779b97f4a7c15ULL;
+  return hash ^ (hash >> 29);
+}
+
+size_t ExprSharer::hash(const Shape &shape, bool lines) {
+  size_t hash = 0xcbf29ce484222325ULL;
+  uint64_t number;
+  memcpy(&number, &shape.number, sizeof(number));
+  hash = mix(hash, shape.type);
+  hash = mix(hash, shape.op);
+  hash = mix(hash, address_hash(shape.left));
+  hash = mix(hash, address_hash(shape.right));
+  hash = mix(hash, number);
+  if (shape.text != nullptr)
+    hash = mix(hash, std::hash<std::string>()(*shape.text));
+  if (lines)
+    hash = mix(hash, shape.line);
+  return hash ^ (hash >> 32);
+}
+
+const ExprSharer::Entry *ExprSharer::find(Expr *expr) const {
+  if (by_address.empty())
+    return nullptr;
+  size_t mask = by_address.size() - 1;
+  for (size_t i = address_hash(expr) & mask; by_address[i];
+       i = (i + 1) & mask) {
+    const Entry &entry = entries[by_address[i] - 1];
+    if (entry.expr == expr)
+      return &entry;
+  }
+  return nullptr;
+}
+
+// Both tables are kept at most half full.
+void ExprSharer::add(const Entry &entry) {
+  entries.push_back(entry);
+  if (entries.size() * 2 <= by_structure.size()) {
+    insert(entries.size());
+    return;
+  }
+  size_t size = by_structure.empty() ? 1024 : by_structure.size() * 2;
+  by_structure.assign(size, 0);
+  by_address.assign(size, 0);
+  for (uint32_t index = 1; index <= entries.size(); index++)
+    insert(index);
+}
+
+void ExprSharer::insert(uint32_t index) {
+  const Entry &entry = entries[index - 1];
+  size_t mask = by_structure.size() - 1;
+  size_t i = entry.hash & mask;
+  while (by_structure[i])
+    i = (i + 1) & mask;
+  by_structure[i] = index;
+  i = address_hash(entry.expr) & mask;
+  while (by_address[i])
+    i = (i + 1) & mask;
+  by_address[i] = index;
+}
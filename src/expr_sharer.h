@@ -0,0 +1,73 @@
+#ifndef EXPR_SHARER_H_
+#define EXPR_SHARER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "expr.h"
+
+// ExprSharer hash-conses expression nodes as a parser makes them, bottom up:
+// a node equal to one made before is deleted and the earlier node returned
+// in its place, with one more owner. As children are shared before their
+// parent, two nodes are equal when their own fields are and their children
+// are the same nodes.
+//
+// A shared node evaluates the same under each of its parents, so only nodes
+// without side effects, which leaves out assignments and calls, are shared.
+// A node that may raise a RuntimeError is only shared within its line, which
+// the error reports.
+//
+// The tables are flat arrays, so they neither cost an allocation per node
+// nor scatter the nodes between their own allocations.
+class ExprSharer {
+public:
+  ExprSharer() = default;
+  ExprSharer(const ExprSharer &) = delete;
+  ExprSharer &operator=(const ExprSharer &) = delete;
+  // Drops the tables' reference to every node, deleting those no tree holds.
+  ~ExprSharer();
+
+  // Returns expr, or the equal node made before after deleting expr.
+  Expr *share(Expr *expr);
+
+  // The nodes share() replaced by an equal node.
+  size_t shared_nodes = 0;
+
+private:
+  // A node open to sharing.
+  struct Entry {
+    Expr *expr;
+    size_t hash;
+    // The ValueType of its value, or -1 when unknown.
+    int type;
+    // Evaluating it cannot raise a RuntimeError.
+    bool safe;
+  };
+  // The fields of a node compared for equality.
+  struct Shape {
+    ExprType type;
+    int op = 0;
+    int line = 0;
+    Expr *left = nullptr;
+    Expr *right = nullptr;
+    double number = 0;
+    const std::string *text = nullptr;
+  };
+
+  static Shape shape_of(Expr *expr);
+  static bool same(const Shape &a, const Shape &b, bool lines);
+  static size_t hash(const Shape &shape, bool lines);
+  const Entry *find(Expr *expr) const;
+  void add(const Entry &entry);
+  void insert(uint32_t index);
+
+  std::vector<Entry> entries;
+  // Open addressing tables of entries index + 1, or 0 when empty, by the
+  // hash of the structure and of the address of the node.
+  std::vector<uint32_t> by_structure;
+  std::vector<uint32_t> by_address;
+};
+
+#endif // EXPR_SHARER_H_
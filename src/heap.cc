@@ -0,0 +1,57 @@
+#include "heap.h"
+#include "runtime_error.h"
+
+#include <string>
+
+static const char *HeapCategoryString[] = {"ast", "tokens", "environments",
+                                           "strings"};
+
+void Heap::charge(HeapCategory category, size_t bytes, int line) {
+  used_bytes[category] += bytes;
+  size_t sum = total();
+  if (limit != 0 && sum > limit) {
+    used_bytes[category] -= bytes;
+    exceeded(line);
+  }
+
+  size_t prev = peak_bytes;
+  while (sum > prev && !peak_bytes.compare_exchange_weak(prev, sum)) {
+  }
+}
+
+void Heap::release(HeapCategory category, size_t bytes) {
+  size_t prev = used_bytes[category];
+  while (!used_bytes[category].compare_exchange_weak(
+      prev, prev > bytes ? prev - bytes : 0)) {
+  }
+}
+
+void Heap::reserve(size_t bytes, int line) {
+  if (limit != 0 && total() + bytes > limit)
+    exceeded(line);
+}
+
+void Heap::clear(HeapCategory category) { used_bytes[category] = 0; }
+
+size_t Heap::total() {
+  size_t sum = 0;
+  for (auto &used : used_bytes)
+    sum += used;
+  return sum;
+}
+
+void Heap::report(std::ostream &out) {
+  out << "heap:";
+  for (int c = 0; c < HEAP_CATEGORIES; c++) {
+    out << " " << HeapCategoryString[c] << "=" << used_bytes[c];
+  }
+  out << " peak=" << peak_bytes;
+  if (limit != 0)
+    out << " limit=" << limit;
+  out << std::endl;
+}
+
+void Heap::exceeded(int line) {
+  throw RuntimeError(line, "Heap limit of " + std::to_string(limit) +
+                               " bytes exceeded.");
+}
@@ -0,0 +1,47 @@
+#ifndef HEAP_H_
+#define HEAP_H_
+
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+
+enum HeapCategory {
+  HEAP_AST,
+  HEAP_TOKENS,
+  HEAP_ENVIRONMENTS,
+  HEAP_STRINGS,
+  HEAP_CATEGORIES
+};
+
+// Heap keeps an approximate account of the bytes held by a run, split by
+// category. When a limit is set, a charge that would exceed it throws a
+// RuntimeError for the given line instead of letting the allocation happen.
+class Heap {
+public:
+  static void set_limit(size_t bytes) { limit = bytes; }
+  static size_t get_limit() { return limit; }
+
+  static void charge(HeapCategory category, size_t bytes, int line);
+  static void release(HeapCategory category, size_t bytes);
+  // reserve checks that a transient allocation of bytes fits in the limit
+  // without charging it to any category.
+  static void reserve(size_t bytes, int line);
+  // clear releases everything charged to category.
+  static void clear(HeapCategory category);
+
+  static size_t used(HeapCategory category) { return used_bytes[category]; }
+  static size_t total();
+  static size_t peak() { return peak_bytes; }
+  static void reset_peak() { peak_bytes = total(); }
+
+  static void report(std::ostream &out);
+
+private:
+  static void exceeded(int line);
+
+  inline static std::atomic<size_t> used_bytes[HEAP_CATEGORIES];
+  inline static std::atomic<size_t> peak_bytes;
+  inline static size_t limit = 0;
+};
+
+#endif // HEAP_H_
@@ -1,33 +1,190 @@
 #include "interpreter.h"
+#include "heap.h"
+#include "lines.h"
 #include "lox.h"
+#include "modules.h"
+#include "natives.h"
+#include "parser.h"
 #include "runtime_error.h"
+#include "trace.h"
 
+#include <algorithm>
+#include <iterator>
 #include <string>
 #include <vector>
 
 bool Lox::had_runtime_error;
 
+// StatementGuard makes stmt the current statement for as long as it runs,
+// also when a RuntimeError unwinds it.
+struct StatementGuard {
+  StatementGuard(Stmt *&current, Stmt *stmt)
+      : current(current), enclosing(current) {
+    current = stmt;
+  }
+  ~StatementGuard() { current = enclosing; }
+  Stmt *&current;
+  Stmt *enclosing;
+};
+
+// Steps between two checks of a budget, which reads the clock for a timeout.
+static const uint64_t BUDGET_CHECK_INTERVAL = 4096;
+
+// ArgumentsGuard pops the arguments pushed for a native call when the call
+// ends, also when a RuntimeError unwinds it.
+struct ArgumentsGuard {
+  ArgumentsGuard(std::vector<ExprValue> &arguments)
+      : arguments(arguments), base(arguments.size()) {}
+  ~ArgumentsGuard() { arguments.resize(base); }
+  std::vector<ExprValue> &arguments;
+  size_t base;
+};
+
+// Native evaluate() frames allowed before switching to evaluate_iterative().
+static const int MAX_RECURSION_DEPTH = 1000;
+
+// DepthGuard counts the evaluate() frames on the native stack, also when a
+// RuntimeError unwinds them.
+struct DepthGuard {
+  DepthGuard(int &depth) : depth(depth) { depth++; }
+  ~DepthGuard() { depth--; }
+  int &depth;
+};
+
 ExprValue Interpreter::visit_BinaryExpr(Binary *binary) {
+  if (binary->left->static_type == VALNUMBER &&
+      binary->right->static_type == VALNUMBER) {
+    double left = evaluate_number(binary->left);
+    double right = evaluate_number(binary->right);
+    ExprValue val;
+    switch (binary->op.type) {
+    case GREATER:
+      val.boolean = left > right;
+      break;
+    case GREATER_EQUAL:
+      val.boolean = left >= right;
+      break;
+    case LESS:
+      val.boolean = left < right;
+      break;
+    case LESS_EQUAL:
+      val.boolean = left <= right;
+      break;
+    case BANG_EQUAL:
+      val.boolean = left != right;
+      break;
+    case EQUAL_EQUAL:
+      val.boolean = left == right;
+      break;
+    default:
+      val.type = VALNUMBER;
+      val.number = arithmetic(binary->op.type, binary->op.line, left, right);
+      return val;
+    }
+    val.type = VALBOOL;
+    return val;
+  }
+
   ExprValue left_val = evaluate(binary->left);
   ExprValue right_val = evaluate(binary->right);
+  return binary_op(binary->op.type, binary->op.line, left_val, right_val);
+}
+
+// arithmetic applies one of + - * / to operands known to be numbers.
+double Interpreter::arithmetic(TokenType op, int line, double left,
+                               double right) {
+  switch (op) {
+  case MINUS:
+    return left - right;
+  case PLUS:
+    return left + right;
+  case SLASH:
+    if (right == 0)
+      throw RuntimeError(line, "Attempt to divide by zero.");
+    return left / right;
+  default:
+    return left * right;
+  }
+}
+
+// evaluate_number evaluates expr, which TypeInference proved to be a number,
+// without boxing its value or those of its operands into an ExprValue.
+double Interpreter::evaluate_number(Expr *expr) {
+  if (depth >= MAX_RECURSION_DEPTH)
+    return evaluate(expr).number;
+  step(nullptr, expr);
+  DepthGuard guard(depth);
+
+  switch (expr->get_type()) {
+  case PRIMITIVENUMBER:
+    return static_cast<PrimitiveNumber *>(expr)->value;
+  case VARIABLE:
+    if (ExprValue *value =
+            environment->find(static_cast<Variable *>(expr)->name.lexeme))
+      return value->number;
+    // Undefined, which accept() reports.
+    break;
+  case GROUPING:
+    return evaluate_number(static_cast<Grouping *>(expr)->expression);
+  case UNARY: {
+    Unary *unary = static_cast<Unary *>(expr);
+    if (unary->right->static_type == VALNUMBER)
+      return -evaluate_number(unary->right);
+    break;
+  }
+  case BINARY: {
+    Binary *binary = static_cast<Binary *>(expr);
+    if (binary->left->static_type != VALNUMBER ||
+        binary->right->static_type != VALNUMBER)
+      break;
+    double left = evaluate_number(binary->left);
+    double right = evaluate_number(binary->right);
+    return arithmetic(binary->op.type, binary->op.line, left, right);
+  }
+  case ASSIGN:
+    return assign_number(static_cast<Assign *>(expr));
+  default:
+    break;
+  }
+  return expr->accept(this).number;
+}
+
+// assign_number stores the value of assign, proven to be a number, in place
+// when the variable holds a number already.
+double Interpreter::assign_number(Assign *assign) {
+  double number = evaluate_number(assign->value);
+  ExprValue *slot = environment->find(assign->name.lexeme);
+  if (slot != nullptr && slot->type == VALNUMBER) {
+    slot->number = number;
+    return number;
+  }
+  ExprValue value;
+  value.type = VALNUMBER;
+  value.number = number;
+  environment->assign(assign->name, value);
+  return number;
+}
+
+ExprValue Interpreter::binary_op(TokenType op, int line, ExprValue left_val,
+                                 ExprValue right_val) {
   ExprValue bool_val;
   bool_val.type = VALBOOL;
 
-  switch (binary->op.type) {
+  switch (op) {
   case GREATER:
-    check_number_operands(binary->op, left_val, right_val);
+    check_number_operands(line, left_val, right_val);
     bool_val.boolean = left_val.number > right_val.number;
     return bool_val;
   case GREATER_EQUAL:
-    check_number_operands(binary->op, left_val, right_val);
+    check_number_operands(line, left_val, right_val);
     bool_val.boolean = left_val.number >= right_val.number;
     return bool_val;
   case LESS:
-    check_number_operands(binary->op, left_val, right_val);
+    check_number_operands(line, left_val, right_val);
     bool_val.boolean = left_val.number < right_val.number;
     return bool_val;
   case LESS_EQUAL:
-    check_number_operands(binary->op, left_val, right_val);
+    check_number_operands(line, left_val, right_val);
     bool_val.boolean = left_val.number <= right_val.number;
     return bool_val;
   case BANG_EQUAL:
@@ -37,7 +194,7 @@ ExprValue Interpreter::visit_BinaryExpr(Binary *binary) {
     bool_val.boolean = left_val == right_val;
     return bool_val;
   case MINUS:
-    check_number_operands(binary->op, left_val, right_val);
+    check_number_operands(line, left_val, right_val);
     left_val.number = left_val.number - right_val.number;
     return left_val;
   case PLUS:
@@ -45,19 +202,19 @@ ExprValue Interpreter::visit_BinaryExpr(Binary *binary) {
       left_val.number = left_val.number + right_val.number;
       return left_val;
     } else if (left_val.type == VALSTRING && right_val.type == VALSTRING) {
+      Heap::reserve(left_val.string.size() + right_val.string.size(), line);
       left_val.string = left_val.string + right_val.string;
       return left_val;
     }
-    throw RuntimeError(binary->op,
-                       "Operands must be two numbers or two strings.");
+    throw RuntimeError(line, "Operands must be two numbers or two strings.");
   case SLASH:
-    check_number_operands(binary->op, left_val, right_val);
+    check_number_operands(line, left_val, right_val);
     if (right_val.number == 0)
-      throw RuntimeError(binary->op, "Attempt to divide by zero.");
+      throw RuntimeError(line, "Attempt to divide by zero.");
     left_val.number = left_val.number / right_val.number;
     return left_val;
   case STAR:
-    check_number_operands(binary->op, left_val, right_val);
+    check_number_operands(line, left_val, right_val);
     left_val.number = left_val.number * right_val.number;
     return left_val;
   default:
@@ -72,12 +229,21 @@ ExprValue Interpreter::visit_GroupingExpr(Grouping *grouping) {
 }
 
 ExprValue Interpreter::visit_UnaryExpr(Unary *unary) {
-  ExprValue r_val = evaluate(unary->right);
+  if (unary->op.type == MINUS && unary->right->static_type == VALNUMBER) {
+    ExprValue val;
+    val.type = VALNUMBER;
+    val.number = -evaluate_number(unary->right);
+    return val;
+  }
+  return unary_op(unary->op.type, unary->op.line, evaluate(unary->right));
+}
+
+ExprValue Interpreter::unary_op(TokenType op, int line, ExprValue r_val) {
   ExprValue bool_val;
 
-  switch (unary->op.type) {
+  switch (op) {
   case MINUS:
-    check_number_operand(unary->op, r_val);
+    check_number_operand(line, r_val);
     r_val.number = -r_val.number;
     return r_val;
   case BANG:
@@ -124,18 +290,32 @@ ExprValue Interpreter::visit_VariableExpr(Variable *var) {
 }
 
 ExprValue Interpreter::visit_AssignExpr(Assign *assign) {
+  if (assign->value->static_type == VALNUMBER) {
+    ExprValue value;
+    value.type = VALNUMBER;
+    value.number = assign_number(assign);
+    return value;
+  }
   ExprValue value = evaluate(assign->value);
   environment->assign(assign->name, value);
   return value;
 }
 
+ExprValue Interpreter::visit_CallExpr(Call *call) {
+  ArgumentsGuard guard(arguments);
+  for (Expr *argument : call->arguments)
+    arguments.push_back(evaluate(argument));
+  return call->native->call(*call->native, arguments.data() + guard.base,
+                            call->name.line);
+}
+
 void Interpreter::visit_ExpressionStmt(Expression *expression) {
   ExprValue val = evaluate(expression->expression);
 }
 
 void Interpreter::visit_PrintStmt(Print *print) {
   ExprValue val = evaluate(print->expression);
-  std::cout << stringify(val) << std::endl;
+  *out << stringify(val) << std::endl;
 }
 
 void Interpreter::visit_VarStmt(Var *var) {
@@ -144,40 +324,567 @@ void Interpreter::visit_VarStmt(Var *var) {
     value = evaluate(var->initializer);
   }
 
-  environment->define(var->name.lexeme, value);
+  environment->define(var->name, value);
 }
 
 void Interpreter::visit_BlockStmt(Block *stmt) {
+  if (stmt->body.tokens != nullptr)
+    parse_body(stmt);
   execute_block(stmt->statements, new Environment(environment));
 }
 
-ExprValue Interpreter::evaluate(Expr *expr) { return expr->accept(this); }
+void Interpreter::visit_IfStmt(If *stmt) {
+  if (is_truthy(evaluate(stmt->condition)).boolean) {
+    if (stmt->then_branch != nullptr)
+      execute(stmt->then_branch);
+  } else if (stmt->else_branch != nullptr) {
+    execute(stmt->else_branch);
+  }
+}
+
+void Interpreter::visit_WhileStmt(While *stmt) {
+  Block *body = dynamic_cast<Block *>(stmt->body);
+  if (body == nullptr) {
+    while (is_truthy(evaluate(stmt->condition)).boolean) {
+      if (stmt->body != nullptr)
+        execute(stmt->body);
+      if (stmt->increment != nullptr)
+        evaluate(stmt->increment);
+    }
+    return;
+  }
+
+  // Every iteration runs the block body in the same frame, emptied first,
+  // instead of one made and deleted per iteration by execute_block.
+  Environment frame(environment);
+  while (is_truthy(evaluate(stmt->condition)).boolean) {
+    if (body->body.tokens != nullptr)
+      parse_body(body);
+    frame.reset();
+    execute_in(body->statements, &frame);
+    if (stmt->increment != nullptr)
+      evaluate(stmt->increment);
+  }
+}
+
+// first_import marks the module of stmt as run, returning whether it had not
+// run before. A module runs once, into the outermost environment, wherever
+// it is imported from. It is marked first, so imports going round in a cycle
+// stop.
+bool Interpreter::first_import(Import *stmt) {
+  if (stmt->module == nullptr)
+    throw RuntimeError(stmt->keyword,
+                       "Module \'" + stmt->path + "\' is not loaded.");
+  return imported->insert(stmt->module).second;
+}
+
+void Interpreter::visit_ImportStmt(Import *stmt) {
+  if (!first_import(stmt))
+    return;
+  Environment *outermost = environment;
+  while (outermost->enclosing != nullptr)
+    outermost = outermost->enclosing;
+  execute_in(stmt->module->statements, outermost);
+}
+
+// parse_body parses the body of a block the parser left unparsed.
+void Interpreter::parse_body(Block *stmt) {
+  TokenRange body = stmt->body;
+  stmt->body = TokenRange();
+  if (Parser::parse_body(body, stmt->statements))
+    return;
+
+  for (Stmt *statement : stmt->statements)
+    delete statement;
+  stmt->statements.clear();
+  stmt->body = body;
+  throw RuntimeError((*body.tokens)[body.begin - 1].line,
+                     "Syntax error in block.");
+}
+
+ExprValue Interpreter::evaluate(Expr *expr) {
+  step(nullptr, expr);
+  if (depth >= MAX_RECURSION_DEPTH)
+    return evaluate_iterative(expr);
+
+  DepthGuard guard(depth);
+  return expr->accept(this);
+}
+
+// evaluate_iterative walks expr in post-order with explicit work and value
+// stacks, so its native stack use does not grow with the nesting depth.
+ExprValue Interpreter::evaluate_iterative(Expr *expr) {
+  struct Work {
+    Expr *expr;
+    bool operands_done;
+  };
+  std::vector<Work> work{{expr, false}};
+  std::vector<ExprValue> values;
+
+  while (!work.empty()) {
+    Work w = work.back();
+    work.pop_back();
+    // evaluate() counted expr itself.
+    if (!w.operands_done && w.expr != expr)
+      step(nullptr, w.expr);
+
+    switch (w.expr->get_type()) {
+    case BINARY: {
+      Binary *binary = static_cast<Binary *>(w.expr);
+      if (!w.operands_done) {
+        // Evaluated left first, then right, then the operator.
+        work.push_back({binary, true});
+        work.push_back({binary->right, false});
+        work.push_back({binary->left, false});
+        break;
+      }
+      ExprValue right_val = std::move(values.back());
+      values.pop_back();
+      values.back() = binary_op(binary->op.type, binary->op.line,
+                                std::move(values.back()), right_val);
+      break;
+    }
+    case UNARY: {
+      Unary *unary = static_cast<Unary *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({unary, true});
+        work.push_back({unary->right, false});
+        break;
+      }
+      values.back() =
+          unary_op(unary->op.type, unary->op.line, std::move(values.back()));
+      break;
+    }
+    case ASSIGN: {
+      Assign *assign = static_cast<Assign *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({assign, true});
+        work.push_back({assign->value, false});
+        break;
+      }
+      environment->assign(assign->name, values.back());
+      break;
+    }
+    case CALL: {
+      Call *call = static_cast<Call *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({call, true});
+        for (auto it = call->arguments.rbegin(); it != call->arguments.rend();
+             ++it)
+          work.push_back({*it, false});
+        break;
+      }
+      ArgumentsGuard guard(arguments);
+      size_t first = values.size() - call->arguments.size();
+      std::move(values.begin() + first, values.end(),
+                std::back_inserter(arguments));
+      values.resize(first);
+      values.push_back(call->native->call(
+          *call->native, arguments.data() + guard.base, call->name.line));
+      break;
+    }
+    case GROUPING:
+      work.push_back({static_cast<Grouping *>(w.expr)->expression, false});
+      break;
+    default:
+      // Literals and variables have no operands.
+      values.push_back(w.expr->accept(this));
+      break;
+    }
+  }
+
+  return values.back();
+}
+
+ExprValue Interpreter::evaluate(const FlatExpr &flat, FlatRef ref) {
+  if (depth >= MAX_RECURSION_DEPTH)
+    return evaluate_iterative(flat, ref);
+
+  DepthGuard guard(depth);
+  uint32_t index = flat_index(ref);
+  switch (flat_type(ref)) {
+  case BINARY: {
+    const FlatBinary &binary = flat.binary_nodes[index];
+    ExprValue left_val = evaluate(flat, binary.left);
+    ExprValue right_val = evaluate(flat, binary.right);
+    return binary_op(binary.op, binary.op_line, left_val, right_val);
+  }
+  case UNARY: {
+    const FlatUnary &unary = flat.unary_nodes[index];
+    return unary_op(unary.op, unary.op_line, evaluate(flat, unary.right));
+  }
+  case ASSIGN: {
+    const FlatAssign &assign = flat.assign_nodes[index];
+    ExprValue value = evaluate(flat, assign.value);
+    flat_assign(flat, assign, value);
+    return value;
+  }
+  case GROUPING:
+    return evaluate(flat, flat.grouping_nodes[index].expression);
+  case CALL: {
+    const FlatCall &call = flat.call_nodes[index];
+    ArgumentsGuard guard(arguments);
+    for (uint32_t i = 0; i < call.arguments_count; i++)
+      arguments.push_back(evaluate(flat, flat.lists[call.arguments + i]));
+    return call.native->call(*call.native, arguments.data() + guard.base,
+                             call.name_line);
+  }
+  default:
+    return flat_leaf(flat, ref);
+  }
+}
+
+// The flat counterpart of evaluate_iterative(Expr *).
+ExprValue Interpreter::evaluate_iterative(const FlatExpr &flat, FlatRef ref) {
+  struct Work {
+    FlatRef ref;
+    bool operands_done;
+  };
+  std::vector<Work> work{{ref, false}};
+  std::vector<ExprValue> values;
+
+  while (!work.empty()) {
+    Work w = work.back();
+    work.pop_back();
+    uint32_t index = flat_index(w.ref);
+
+    switch (flat_type(w.ref)) {
+    case BINARY: {
+      const FlatBinary &binary = flat.binary_nodes[index];
+      if (!w.operands_done) {
+        work.push_back({w.ref, true});
+        work.push_back({binary.right, false});
+        work.push_back({binary.left, false});
+        break;
+      }
+      ExprValue right_val = std::move(values.back());
+      values.pop_back();
+      values.back() = binary_op(binary.op, binary.op_line,
+                                std::move(values.back()), right_val);
+      break;
+    }
+    case UNARY: {
+      const FlatUnary &unary = flat.unary_nodes[index];
+      if (!w.operands_done) {
+        work.push_back({w.ref, true});
+        work.push_back({unary.right, false});
+        break;
+      }
+      values.back() =
+          unary_op(unary.op, unary.op_line, std::move(values.back()));
+      break;
+    }
+    case ASSIGN: {
+      const FlatAssign &assign = flat.assign_nodes[index];
+      if (!w.operands_done) {
+        work.push_back({w.ref, true});
+        work.push_back({assign.value, false});
+        break;
+      }
+      flat_assign(flat, assign, values.back());
+      break;
+    }
+    case GROUPING:
+      work.push_back({flat.grouping_nodes[index].expression, false});
+      break;
+    case CALL: {
+      const FlatCall &call = flat.call_nodes[index];
+      if (!w.operands_done) {
+        work.push_back({w.ref, true});
+        for (uint32_t i = call.arguments_count; i > 0; i--)
+          work.push_back({flat.lists[call.arguments + i - 1], false});
+        break;
+      }
+      ArgumentsGuard guard(arguments);
+      size_t first = values.size() - call.arguments_count;
+      std::move(values.begin() + first, values.end(),
+                std::back_inserter(arguments));
+      values.resize(first);
+      values.push_back(call.native->call(
+          *call.native, arguments.data() + guard.base, call.name_line));
+      break;
+    }
+    default:
+      values.push_back(flat_leaf(flat, w.ref));
+      break;
+    }
+  }
+
+  return values.back();
+}
+
+void Interpreter::flat_assign(const FlatExpr &flat, const FlatAssign &assign,
+                              const ExprValue &value) {
+  environment->assign(
+      Token(IDENTIFIER, flat.strings[assign.name], nullptr, assign.name_line),
+      value);
+}
+
+ExprValue Interpreter::flat_leaf(const FlatExpr &flat, FlatRef ref) {
+  uint32_t index = flat_index(ref);
+  ExprValue val;
+  switch (flat_type(ref)) {
+  case VARIABLE: {
+    const FlatVariable &variable = flat.variable_nodes[index];
+    const std::string &name = flat.strings[variable.name];
+    ExprValue *value = environment->find(name);
+    if (value == nullptr)
+      throw RuntimeError(variable.name_line,
+                         "Undefined variable \'" + name + "\'.");
+    return *value;
+  }
+  case PRIMITIVENUMBER:
+    val.type = VALNUMBER;
+    val.number = flat.primitive_number_nodes[index].value;
+    break;
+  case PRIMITIVESTRING:
+    val.type = VALSTRING;
+    val.string = flat.strings[flat.primitive_string_nodes[index].value];
+    break;
+  case PRIMITIVEBOOL:
+    val.type = VALBOOL;
+    val.boolean = flat.primitive_bool_nodes[index].value;
+    break;
+  default:
+    // Nil.
+    break;
+  }
+  return val;
+}
+
+// A span name for a top-level statement of a trace.
+static std::string statement_name(Stmt *stmt) {
+  if (Var *var = dynamic_cast<Var *>(stmt))
+    return "var " + var->name.lexeme;
+  if (dynamic_cast<Print *>(stmt) != nullptr)
+    return "print";
+  if (dynamic_cast<Block *>(stmt) != nullptr)
+    return "block";
+  if (dynamic_cast<If *>(stmt) != nullptr)
+    return "if";
+  if (dynamic_cast<While *>(stmt) != nullptr)
+    return "while";
+  if (Import *import = dynamic_cast<Import *>(stmt))
+    return "import " + import->path;
+  return "expression";
+}
 
 void Interpreter::interpret(std::vector<Stmt *> statements) {
   try {
-    for (auto stmt : statements) {
-      execute(stmt);
+    // Compiled runs of statements cannot be timed one by one.
+    if (!Trace::enabled() || jit != nullptr) {
+      execute_statements(statements);
+      return;
+    }
+    for (size_t i = 0; i < statements.size(); i++) {
+      TraceSpan span(statement_name(statements[i]), "statement");
+      span.count("index", i);
+      execute(statements[i]);
     }
   } catch (RuntimeError e) {
     Lox::runtime_error(e);
   }
 }
 
-void Interpreter::execute(Stmt *stmt) { stmt->accept(this); }
+void Interpreter::execute(Stmt *stmt) {
+  StatementGuard guard(current, stmt);
+  step(stmt, nullptr);
+  stmt->accept(this);
+}
+
+void Interpreter::set_budget(const Budget &budget) {
+  this->budget = budget;
+  restart_budget();
+}
+
+void Interpreter::restart_budget() {
+  steps_checked = 0;
+  deadline = std::chrono::steady_clock::now() +
+             std::chrono::milliseconds(budget.timeout_ms);
+  load_budget();
+}
+
+void Interpreter::load_budget() {
+  if (budget.max_steps == 0 && budget.timeout_ms == 0)
+    steps_loaded = UINT64_MAX;
+  else if (budget.max_steps == 0)
+    steps_loaded = BUDGET_CHECK_INTERVAL;
+  else
+    // Run out on the first step past the limit.
+    steps_loaded = std::min(BUDGET_CHECK_INTERVAL,
+                            budget.max_steps - steps_checked + 1);
+  steps_until_check = steps_loaded;
+}
+
+// check_budget raises a RuntimeError once the budget is used up, at the line
+// of stmt or expr, whichever is not null, or of the current statement.
+void Interpreter::check_budget(Stmt *stmt, Expr *expr) {
+  steps_checked += steps_loaded;
+  std::string exceeded;
+  if (budget.max_steps != 0 && steps_checked > budget.max_steps)
+    exceeded = "the budget of " + std::to_string(budget.max_steps) + " steps";
+  else if (budget.timeout_ms != 0 &&
+           std::chrono::steady_clock::now() >= deadline)
+    exceeded = "the timeout of " + std::to_string(budget.timeout_ms) + " ms";
+  if (exceeded.empty()) {
+    load_budget();
+    return;
+  }
+
+  // Stay exhausted until the budget is restarted.
+  steps_checked--;
+  steps_until_check = steps_loaded = 1;
+  int line = stmt != nullptr ? line_of(stmt) : line_of(expr);
+  if (line == 0 && current != nullptr)
+    line = line_of(current);
+  throw RuntimeError(line, "Execution exceeded " + exceeded + ".");
+}
 
 void Interpreter::execute_block(std::vector<Stmt *> statements,
                                 Environment *environment) {
-  Environment *previsous = this->environment;
+  try {
+    execute_in(statements, environment);
+  } catch (...) {
+    delete environment;
+    throw;
+  }
+  delete environment;
+}
+
+void Interpreter::execute_in(const std::vector<Stmt *> &statements,
+                             Environment *environment) {
+  Environment *previous = this->environment;
   try {
     this->environment = environment;
+    execute_statements(statements);
+  } catch (...) {
+    this->environment = previous;
+    throw;
+  }
+  this->environment = previous;
+}
 
+void Interpreter::execute_statements(const std::vector<Stmt *> &statements) {
+  if (jit == nullptr) {
     for (Stmt *statement : statements) {
       execute(statement);
     }
+    return;
+  }
+
+  for (const JitSegment &segment : jit->plan(statements)) {
+    size_t i = segment.begin;
+    if (segment.code != nullptr) {
+      // A run of native code counts as one step.
+      step(statements[i], nullptr);
+      i += jit->run(*segment.code, environment);
+    }
+    for (; i < segment.end; i++) {
+      execute(statements[i]);
+    }
+  }
+}
+
+void Interpreter::resume(Task &task, uint64_t slice) {
+  Environment *previous = environment;
+  imported = &task.imported;
+  try {
+    while (!task.done()) {
+      Task::Frame &frame = task.frames.back();
+      if (frame.next == frame.end && frame.loop == nullptr) {
+        task.pop();
+        continue;
+      }
+      if (slice == 0)
+        break;
+      slice--;
+      environment = frame.environment;
+
+      if (frame.loop != nullptr) {
+        While *loop = frame.loop;
+        StatementGuard guard(current, loop);
+        if (frame.iterating && loop->increment != nullptr)
+          evaluate(loop->increment);
+        frame.iterating = true;
+        if (!is_truthy(evaluate(loop->condition)).boolean) {
+          task.pop();
+          continue;
+        }
+        if (Block *body = dynamic_cast<Block *>(loop->body)) {
+          if (body->body.tokens != nullptr)
+            parse_body(body);
+          // The body reuses one frame for every iteration, as in
+          // visit_WhileStmt.
+          frame.owned->reset();
+          task.push(body->statements.data(),
+                    body->statements.data() + body->statements.size(),
+                    frame.owned, nullptr);
+        } else if (loop->body != nullptr) {
+          task.push(&loop->body, &loop->body + 1, environment, nullptr);
+        }
+        continue;
+      }
+
+      Stmt *stmt = *frame.next++;
+      if (Block *block = dynamic_cast<Block *>(stmt)) {
+        StatementGuard guard(current, stmt);
+        step(stmt, nullptr);
+        if (block->body.tokens != nullptr)
+          parse_body(block);
+        Environment *scope = new Environment(environment);
+        task.push(block->statements.data(),
+                  block->statements.data() + block->statements.size(), scope,
+                  scope);
+      } else if (If *branch = dynamic_cast<If *>(stmt)) {
+        StatementGuard guard(current, stmt);
+        step(stmt, nullptr);
+        Stmt **taken = is_truthy(evaluate(branch->condition)).boolean
+                           ? &branch->then_branch
+                           : &branch->else_branch;
+        if (*taken != nullptr)
+          task.push(taken, taken + 1, environment, nullptr);
+      } else if (While *loop = dynamic_cast<While *>(stmt)) {
+        StatementGuard guard(current, stmt);
+        step(stmt, nullptr);
+        Environment *scope = dynamic_cast<Block *>(loop->body) != nullptr
+                                 ? new Environment(environment)
+                                 : nullptr;
+        task.push(nullptr, nullptr, environment, scope);
+        task.frames.back().loop = loop;
+      } else if (Import *import = dynamic_cast<Import *>(stmt)) {
+        StatementGuard guard(current, stmt);
+        step(stmt, nullptr);
+        if (first_import(import)) {
+          const std::vector<Stmt *> &body = import->module->statements;
+          task.push(body.data(), body.data() + body.size(), task.globals,
+                    nullptr);
+        }
+      } else {
+        execute(stmt);
+      }
+    }
   } catch (...) {
+    environment = previous;
+    imported = &imported_modules;
+    task.abandon();
+    throw;
   }
-  delete environment;
-  this->environment = previsous;
+  environment = previous;
+  imported = &imported_modules;
+}
+
+void Interpreter::set_global(const std::string &name, ExprValue value) {
+  Token token(IDENTIFIER, name, nullptr, 0);
+  if (globals->defines(name))
+    globals->assign(token, value);
+  else
+    globals->define(token, value);
+}
+
+void Interpreter::reset_globals() {
+  delete globals;
+  globals = environment = new Environment();
+  imported_modules.clear();
 }
 
 ExprValue Interpreter::is_truthy(ExprValue val) {
@@ -193,16 +900,16 @@ ExprValue Interpreter::is_truthy(ExprValue val) {
   return v;
 };
 
-void Interpreter::check_number_operand(Token op, ExprValue operand) {
+void Interpreter::check_number_operand(int line, const ExprValue &operand) {
   if (operand.type != VALNUMBER)
-    throw RuntimeError(op, "Operand must be a number.");
+    throw RuntimeError(line, "Operand must be a number.");
 };
 
-void Interpreter::check_number_operands(Token op, ExprValue left,
-                                        ExprValue right) {
+void Interpreter::check_number_operands(int line, const ExprValue &left,
+                                        const ExprValue &right) {
   if (left.type == VALNUMBER && right.type == VALNUMBER)
     return;
-  throw RuntimeError(op, "Operands must be numbers.");
+  throw RuntimeError(line, "Operands must be numbers.");
 };
 
 std::string Interpreter::stringify(ExprValue val) {
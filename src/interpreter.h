@@ -1,16 +1,37 @@
 #ifndef INTERPRETER_H_
 #define INTERPRETER_H_
 
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <set>
 #include <string>
 
 #include "environment.h"
 #include "expr.h"
+#include "flat_expr.h"
+#include "jit.h"
 #include "stmt.h"
+#include "task.h"
+
+// A Budget bounds a run of an Interpreter: the steps it takes, which are
+// the statements it executes and the expression nodes it evaluates, and its
+// wall-clock time in milliseconds. 0 leaves either unbounded.
+struct Budget {
+  uint64_t max_steps = 0;
+  uint64_t timeout_ms = 0;
+};
 
 class Interpreter : public ExprVisitor, public StmtVisitor {
 public:
-  Interpreter() { environment = new Environment(); }
-  virtual ~Interpreter() {}
+  Interpreter() : out(&std::cout), depth(0), jit(nullptr) {
+    globals = environment = new Environment();
+    restart_budget();
+  }
+  virtual ~Interpreter() {
+    delete globals;
+    delete jit;
+  }
 
   virtual ExprValue visit_BinaryExpr(Binary *binary);
   virtual ExprValue visit_GroupingExpr(Grouping *grouping);
@@ -21,24 +42,110 @@ public:
   virtual ExprValue visit_PrimitiveNilExpr(PrimitiveNil *pn);
   virtual ExprValue visit_VariableExpr(Variable *var);
   virtual ExprValue visit_AssignExpr(Assign *assign);
+  virtual ExprValue visit_CallExpr(Call *call);
 
   virtual void visit_ExpressionStmt(Expression *expression);
   virtual void visit_PrintStmt(Print *print);
   virtual void visit_VarStmt(Var *var);
   virtual void visit_BlockStmt(Block *stmt);
+  virtual void visit_IfStmt(If *stmt);
+  virtual void visit_WhileStmt(While *stmt);
+  virtual void visit_ImportStmt(Import *stmt);
 
   void interpret(std::vector<Stmt *> statements);
+  // Like interpret, but leaves a RuntimeError to the caller.
+  void execute_statements(const std::vector<Stmt *> &statements);
+  // Runs task until it is done or has taken slice more turns, a turn being
+  // a statement, also one nested in a block or loop, or a loop iteration.
+  // A RuntimeError ends the task and is left to the caller. Compiled code
+  // is not used, as it cannot stop between statements.
+  void resume(Task &task, uint64_t slice);
   ExprValue evaluate(Expr *expr);
+  // Evaluates the node ref of flat, dispatching on the node type with a
+  // switch instead of the two virtual calls per node of the tree.
+  ExprValue evaluate(const FlatExpr &flat, FlatRef ref);
+  // Defines the global name, or overwrites it when it already exists, e.g.
+  // to feed one row of input to a script.
+  void set_global(const std::string &name, ExprValue value);
+  const Environment &global_environment() const { return *globals; }
+  // Drops every global and forgets the modules imported, so the next run
+  // starts from a clean state.
+  void reset_globals();
+  // Sends the output of print statements to stream instead of std::cout.
+  void set_output(std::ostream &stream) { out = &stream; }
+
+  // Bounds the runs from now on, raising a RuntimeError at the line being
+  // run when the budget is exceeded. The steps and the time count from this
+  // call, or from the last restart_budget().
+  void set_budget(const Budget &budget);
+  const Budget &get_budget() const { return budget; }
+  void restart_budget();
+
+  // Run numeric statement runs as native code where the platform allows.
+  void enable_jit() { jit = jit != nullptr ? jit : new Jit(); }
+  Jit *get_jit() { return jit; }
+  // Drops compiled code, which refers to the AST, before the AST is freed.
+  void release_code() {
+    if (jit != nullptr)
+      jit->clear();
+  }
 
 private:
   void execute(Stmt *stmt);
+  // Counts one step, checking the budget only every so many steps.
+  void step(Stmt *stmt, Expr *expr) {
+    if (--steps_until_check == 0)
+      check_budget(stmt, expr);
+  }
+  void check_budget(Stmt *stmt, Expr *expr);
+  void load_budget();
   void execute_block(std::vector<Stmt *> statements, Environment *environment);
+  // Runs statements in environment, which the caller keeps.
+  void execute_in(const std::vector<Stmt *> &statements,
+                  Environment *environment);
+  void parse_body(Block *stmt);
+  bool first_import(Import *stmt);
+  ExprValue evaluate_iterative(Expr *expr);
+  double evaluate_number(Expr *expr);
+  double assign_number(Assign *assign);
+  double arithmetic(TokenType op, int line, double left, double right);
+  ExprValue evaluate_iterative(const FlatExpr &flat, FlatRef ref);
+  void flat_assign(const FlatExpr &flat, const FlatAssign &assign,
+                   const ExprValue &value);
+  ExprValue flat_leaf(const FlatExpr &flat, FlatRef ref);
+  ExprValue binary_op(TokenType op, int line, ExprValue left_val,
+                      ExprValue right_val);
+  ExprValue unary_op(TokenType op, int line, ExprValue r_val);
   ExprValue is_truthy(ExprValue val);
   std::string stringify(ExprValue val);
-  void check_number_operand(Token op, ExprValue operand);
-  void check_number_operands(Token op, ExprValue left, ExprValue right);
+  void check_number_operand(int line, const ExprValue &operand);
+  void check_number_operands(int line, const ExprValue &left,
+                             const ExprValue &right);
 
+  Environment *globals;
   Environment *environment;
+  // The modules run into globals, and those run into the globals of the
+  // task being resumed, if any.
+  std::set<const Module *> imported_modules;
+  std::set<const Module *> *imported = &imported_modules;
+  std::ostream *out;
+  // Number of evaluate() frames currently on the native stack.
+  int depth;
+  // The arguments of the native calls being evaluated, innermost last,
+  // kept from one call to the next so calls do not allocate.
+  std::vector<ExprValue> arguments;
+  Jit *jit;
+
+  Budget budget;
+  // The steps counted down to the next check of the budget, the steps done
+  // up to the last check, and how many the count started from.
+  uint64_t steps_until_check;
+  uint64_t steps_checked;
+  uint64_t steps_loaded;
+  std::chrono::steady_clock::time_point deadline;
+  // The statement being executed, for the line of a budget error raised by
+  // an expression without one.
+  Stmt *current = nullptr;
 };
 
 #endif // INTERPRETER_H_
\ No newline at end of file
@@ -0,0 +1,447 @@
+#include "jit.h"
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define JIT_SUPPORTED 1
+#endif
+
+namespace {
+
+// Fewest consecutive statements worth compiling.
+const size_t MIN_RUN_LENGTH = 2;
+// xmm0..xmm13 hold intermediate values; xmm14 holds 0.0 and xmm15 the sign
+// bit used to negate.
+const int MAX_REGISTERS = 14;
+const int XMM_ZERO = 14;
+const int XMM_SIGN = 15;
+
+// SSE2 opcodes, all following a 0x0F escape.
+const uint8_t MOVSD_LOAD = 0x10;
+const uint8_t MOVSD_STORE = 0x11;
+const uint8_t UCOMISD = 0x2E;
+const uint8_t XORPD = 0x57;
+const uint8_t ADDSD = 0x58;
+const uint8_t MULSD = 0x59;
+const uint8_t SUBSD = 0x5C;
+const uint8_t DIVSD = 0x5E;
+
+// Strips groupings, which evaluate to their inner expression.
+Expr *strip(Expr *expr) {
+  while (expr->get_type() == GROUPING)
+    expr = static_cast<Grouping *>(expr)->expression;
+  return expr;
+}
+
+// Collects the chain of binary left operands and unary operands below expr,
+// outermost first, and returns the leaf at its bottom. Walking the chain
+// iteratively keeps long "a + b + c + ..." runs off the native stack; only
+// right operands recurse, and those are bounded by the register count.
+Expr *spine(Expr *expr, std::vector<Expr *> &nodes) {
+  while (true) {
+    expr = strip(expr);
+    if (expr->get_type() == BINARY) {
+      nodes.push_back(expr);
+      expr = static_cast<Binary *>(expr)->left;
+    } else if (expr->get_type() == UNARY) {
+      nodes.push_back(expr);
+      expr = static_cast<Unary *>(expr)->right;
+    } else {
+      return expr;
+    }
+  }
+}
+
+// Returns the registers needed to evaluate expr with at most budget of them,
+// or -1 if expr is not numeric or needs more. Variables read go to reads.
+int analyze(Expr *expr, int budget, std::vector<Token> &reads) {
+  if (budget <= 0)
+    return -1;
+
+  std::vector<Expr *> nodes;
+  Expr *leaf = spine(expr, nodes);
+  if (leaf->get_type() == VARIABLE)
+    reads.push_back(static_cast<Variable *>(leaf)->name);
+  else if (leaf->get_type() != PRIMITIVENUMBER)
+    return -1;
+
+  int needed = 1;
+  for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+    if ((*it)->get_type() == UNARY) {
+      if (static_cast<Unary *>(*it)->op.type != MINUS)
+        return -1;
+      continue;
+    }
+
+    Binary *binary = static_cast<Binary *>(*it);
+    switch (binary->op.type) {
+    case PLUS:
+    case MINUS:
+    case STAR:
+    case SLASH:
+      break;
+    default:
+      return -1;
+    }
+    int right = analyze(binary->right, budget - 1, reads);
+    if (right < 0)
+      return -1;
+    needed = std::max(needed, right + 1);
+  }
+  return needed;
+}
+
+// A numeric statement: what it stores (if anything) and what it reads.
+struct NumericStatement {
+  Expr *value;
+  const Token *target;
+  bool declares;
+  std::vector<Token> reads;
+};
+
+bool numeric_statement(Stmt *stmt, NumericStatement &ns) {
+  ns.target = nullptr;
+  ns.declares = false;
+  if (Var *var = dynamic_cast<Var *>(stmt)) {
+    if (var->initializer == nullptr)
+      return false;
+    ns.value = var->initializer;
+    ns.target = &var->name;
+    ns.declares = true;
+  } else if (Expression *es = dynamic_cast<Expression *>(stmt)) {
+    ns.value = es->expression;
+    if (ns.value->get_type() == ASSIGN) {
+      Assign *assign = static_cast<Assign *>(ns.value);
+      ns.value = assign->value;
+      ns.target = &assign->name;
+    }
+  } else {
+    return false;
+  }
+  return analyze(ns.value, MAX_REGISTERS, ns.reads) > 0;
+}
+
+// Returns the end of the longest run of numeric statements from begin in
+// which every variable name refers to a single variable: a var declaration
+// may not shadow a name the run already used, nor read its own name.
+size_t run_end(const std::vector<Stmt *> &statements, size_t begin) {
+  std::set<std::string> seen;
+  for (size_t i = begin; i < statements.size(); i++) {
+    NumericStatement ns;
+    if (!numeric_statement(statements[i], ns))
+      return i;
+    if (ns.declares) {
+      if (seen.count(ns.target->lexeme))
+        return i;
+      for (const Token &read : ns.reads) {
+        if (read.lexeme == ns.target->lexeme)
+          return i;
+      }
+    }
+    for (const Token &read : ns.reads)
+      seen.insert(read.lexeme);
+    if (ns.target != nullptr)
+      seen.insert(ns.target->lexeme);
+  }
+  return statements.size();
+}
+
+class Assembler {
+public:
+  void byte(uint8_t b) { code.push_back(b); }
+
+  void u32(uint32_t v) {
+    for (int i = 0; i < 4; i++)
+      byte(v >> (8 * i));
+  }
+
+  void u64(uint64_t v) {
+    for (int i = 0; i < 8; i++)
+      byte(v >> (8 * i));
+  }
+
+  // opcode xmm(reg), xmm(rm)
+  void sse(uint8_t prefix, uint8_t opcode, int reg, int rm) {
+    byte(prefix);
+    if (reg >= 8 || rm >= 8)
+      byte(0x40 | (reg >= 8) << 2 | (rm >= 8));
+    byte(0x0F);
+    byte(opcode);
+    byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+  }
+
+  // opcode xmm(reg), [rdi + slot * 8]
+  void sse_slot(uint8_t opcode, int reg, int slot) {
+    byte(0xF2);
+    if (reg >= 8)
+      byte(0x44);
+    byte(0x0F);
+    byte(opcode);
+    byte(0x80 | (reg & 7) << 3 | 7);
+    u32(slot * sizeof(double));
+  }
+
+  void load_constant(int reg, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    // mov rax, imm64
+    byte(0x48);
+    byte(0xB8);
+    u64(bits);
+    // movq xmm(reg), rax
+    byte(0x66);
+    byte(0x48 | (reg >= 8) << 2);
+    byte(0x0F);
+    byte(0x6E);
+    byte(0xC0 | (reg & 7) << 3);
+  }
+
+  // je rel32, returns the offset of rel32 to patch.
+  size_t jump_if_equal() {
+    byte(0x0F);
+    byte(0x84);
+    u32(0);
+    return code.size() - 4;
+  }
+
+  void patch(size_t at, size_t target) {
+    int32_t rel = target - (at + 4);
+    memcpy(&code[at], &rel, sizeof(rel));
+  }
+
+  // mov eax, value; ret
+  void return_value(uint32_t value) {
+    byte(0xB8);
+    u32(value);
+    byte(0xC3);
+  }
+
+  std::vector<uint8_t> code;
+};
+
+class Compiler {
+public:
+  Compiler(JitCode *code) : code(code) {}
+
+  void prologue() {
+    a.sse(0x66, XORPD, XMM_ZERO, XMM_ZERO);
+    a.load_constant(XMM_SIGN, -0.0);
+  }
+
+  void statement(Stmt *stmt, int index) {
+    NumericStatement ns;
+    numeric_statement(stmt, ns);
+    current = index;
+    emit(ns.value, 0);
+    if (ns.target == nullptr)
+      return;
+
+    int s = slot(*ns.target, false);
+    if (ns.declares)
+      code->declared_at[s] = index;
+    if (code->written_at[s] < 0)
+      code->written_at[s] = index;
+    a.sse_slot(MOVSD_STORE, 0, s);
+  }
+
+  // Finishes the code; the statements ran to completion return count.
+  std::vector<uint8_t> &finish(int count) {
+    a.return_value(count);
+    // A failed division check leaves before its statement takes effect.
+    std::map<int, size_t> stubs;
+    for (auto &bail : bails) {
+      if (!stubs.count(bail.second)) {
+        stubs[bail.second] = a.code.size();
+        a.return_value(bail.second);
+      }
+      a.patch(bail.first, stubs[bail.second]);
+    }
+    return a.code;
+  }
+
+private:
+  int slot(const Token &name, bool read) {
+    if (auto found = slots.find(name.lexeme); found != slots.end())
+      return found->second;
+
+    int s = code->names.size();
+    slots[name.lexeme] = s;
+    code->names.push_back(name);
+    code->declared_at.push_back(-1);
+    code->written_at.push_back(-1);
+    code->inputs.push_back(read);
+    return s;
+  }
+
+  // Evaluates expr into xmm(reg).
+  void emit(Expr *expr, int reg) {
+    std::vector<Expr *> nodes;
+    Expr *leaf = spine(expr, nodes);
+    if (leaf->get_type() == VARIABLE) {
+      a.sse_slot(MOVSD_LOAD, reg,
+                 slot(static_cast<Variable *>(leaf)->name, true));
+    } else {
+      a.load_constant(reg, static_cast<PrimitiveNumber *>(leaf)->value);
+    }
+
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+      if ((*it)->get_type() == UNARY) {
+        a.sse(0x66, XORPD, reg, XMM_SIGN);
+        continue;
+      }
+
+      Binary *binary = static_cast<Binary *>(*it);
+      emit(binary->right, reg + 1);
+      switch (binary->op.type) {
+      case PLUS:
+        a.sse(0xF2, ADDSD, reg, reg + 1);
+        break;
+      case MINUS:
+        a.sse(0xF2, SUBSD, reg, reg + 1);
+        break;
+      case STAR:
+        a.sse(0xF2, MULSD, reg, reg + 1);
+        break;
+      case SLASH:
+        a.sse(0x66, UCOMISD, reg + 1, XMM_ZERO);
+        bails.push_back({a.jump_if_equal(), current});
+        a.sse(0xF2, DIVSD, reg, reg + 1);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  JitCode *code;
+  Assembler a;
+  std::map<std::string, int> slots;
+  // Jumps to patch and the statement they leave at.
+  std::vector<std::pair<size_t, int>> bails;
+  int current = 0;
+};
+
+} // namespace
+
+const std::vector<JitSegment> &
+Jit::plan(const std::vector<Stmt *> &statements) {
+  static const std::vector<JitSegment> none;
+  if (statements.empty())
+    return none;
+  if (auto found = plans.find(statements.front()); found != plans.end())
+    return found->second;
+
+  std::vector<JitSegment> &segments = plans[statements.front()];
+  size_t interpreted_from = 0;
+  size_t i = 0;
+  while (i < statements.size()) {
+    size_t end = run_end(statements, i);
+    if (end - i >= MIN_RUN_LENGTH) {
+      if (JitCode *code = compile(statements, i, end)) {
+        if (interpreted_from < i)
+          segments.push_back({interpreted_from, i, nullptr});
+        segments.push_back({i, end, code});
+        interpreted_from = end;
+      }
+    }
+    i = end > i ? end : i + 1;
+  }
+  if (interpreted_from < statements.size())
+    segments.push_back({interpreted_from, statements.size(), nullptr});
+  return segments;
+}
+
+JitCode *Jit::compile(const std::vector<Stmt *> &statements, size_t begin,
+                      size_t end) {
+#ifdef JIT_SUPPORTED
+  JitCode *code = new JitCode();
+  Compiler compiler(code);
+  compiler.prologue();
+  for (size_t i = begin; i < end; i++)
+    compiler.statement(statements[i], i - begin);
+  std::vector<uint8_t> &bytes = compiler.finish(end - begin);
+
+  code->size = bytes.size();
+  code->memory = mmap(nullptr, code->size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code->memory == MAP_FAILED) {
+    delete code;
+    return nullptr;
+  }
+  memcpy(code->memory, bytes.data(), bytes.size());
+  if (mprotect(code->memory, code->size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(code->memory, code->size);
+    delete code;
+    return nullptr;
+  }
+  code->entry = reinterpret_cast<int (*)(double *)>(code->memory);
+  code->statements = end - begin;
+  compiled_statements += end - begin;
+  return code;
+#else
+  return nullptr;
+#endif
+}
+
+size_t Jit::run(const JitCode &code, Environment *environment) {
+  slots.resize(code.names.size());
+  for (size_t s = 0; s < code.names.size(); s++) {
+    const std::string &name = code.names[s].lexeme;
+    if (code.declared_at[s] >= 0) {
+      if (environment->defines(name)) {
+        guard_failures++;
+        return 0;
+      }
+      continue;
+    }
+
+    ExprValue *value = environment->find(name);
+    if (value == nullptr || (code.inputs[s] && value->type != VALNUMBER)) {
+      guard_failures++;
+      return 0;
+    }
+    slots[s] = value->number;
+  }
+
+  int done = code.entry(slots.data());
+  native_runs++;
+  if ((size_t)done < code.statements)
+    early_exits++;
+
+  for (size_t s = 0; s < code.names.size(); s++) {
+    ExprValue value;
+    value.type = VALNUMBER;
+    value.number = slots[s];
+    if (code.declared_at[s] >= 0) {
+      if (code.declared_at[s] < done)
+        environment->define(code.names[s], value);
+    } else if (code.written_at[s] >= 0 && code.written_at[s] < done) {
+      environment->assign(code.names[s], value);
+    }
+  }
+  return done;
+}
+
+void Jit::clear() {
+  for (auto &plan : plans) {
+    for (JitSegment &segment : plan.second) {
+      if (segment.code == nullptr)
+        continue;
+#ifdef JIT_SUPPORTED
+      munmap(segment.code->memory, segment.code->size);
+#endif
+      delete segment.code;
+    }
+  }
+  plans.clear();
+}
+
+void Jit::report(std::ostream &out) {
+  out << "jit: compiled_statements=" << compiled_statements
+      << " native_runs=" << native_runs
+      << " guard_failures=" << guard_failures
+      << " early_exits=" << early_exits << std::endl;
+}
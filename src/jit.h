@@ -0,0 +1,73 @@
+#ifndef JIT_H_
+#define JIT_H_
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "environment.h"
+#include "expr.h"
+#include "stmt.h"
+
+// JitCode is native x86-64 code for a run of consecutive numeric statements:
+// var declarations, assignments and expression statements built from number
+// literals, variables, groupings, unary minus and + - * /.
+//
+// Variables live unboxed in a slot array while the code runs. Slots are
+// loaded from the environment on entry and written back when it returns.
+struct JitCode {
+  // Runs the statements on slots and returns how many completed. It stops
+  // early before a division by zero, which the interpreter then reports.
+  int (*entry)(double *slots);
+  size_t statements;
+  void *memory;
+  size_t size;
+
+  // Per slot: the variable, the statement declaring it with var (or -1),
+  // the first statement writing it (or -1), and whether its value on entry
+  // is read, in which case it must be a number.
+  std::vector<Token> names;
+  std::vector<int> declared_at;
+  std::vector<int> written_at;
+  std::vector<bool> inputs;
+};
+
+// JitSegment is the slice [begin, end) of a statement list. code is null when
+// the slice is left to the tree-walker.
+struct JitSegment {
+  size_t begin;
+  size_t end;
+  JitCode *code;
+};
+
+class Jit {
+public:
+  ~Jit() { clear(); }
+
+  // plan splits statements into compiled and interpreted segments. Plans are
+  // cached by the first statement, so clear() must be called before the AST
+  // they were built from is freed.
+  const std::vector<JitSegment> &plan(const std::vector<Stmt *> &statements);
+  // run executes code against environment and returns how many of its
+  // statements took effect; the caller interprets the rest. It returns 0
+  // without running anything when a guard on the entry values fails.
+  size_t run(const JitCode &code, Environment *environment);
+  void clear();
+
+  void report(std::ostream &out);
+
+private:
+  JitCode *compile(const std::vector<Stmt *> &statements, size_t begin,
+                   size_t end);
+
+  std::map<Stmt *, std::vector<JitSegment>> plans;
+  std::vector<double> slots;
+
+  size_t compiled_statements = 0;
+  size_t native_runs = 0;
+  size_t guard_failures = 0;
+  size_t early_exits = 0;
+};
+
+#endif // JIT_H_
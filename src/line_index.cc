@@ -0,0 +1,57 @@
+#include "line_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+LineIndex::LineIndex(const std::string &source) {
+  const char *data = source.data();
+  size_t size = source.size();
+  size_t i = 0;
+#if defined(__x86_64__)
+  // SSE2 is part of x86-64: compare 16 bytes with '\n' at once and walk
+  // the bits of the matches.
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; i + 16 <= size; i += 16) {
+    __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+    while (mask != 0) {
+      newlines.push_back(i + __builtin_ctz(mask));
+      mask &= mask - 1;
+    }
+  }
+#endif
+  while (i < size) {
+    const void *found = memchr(data + i, '\n', size - i);
+    if (found == nullptr)
+      break;
+    i = static_cast<const char *>(found) - data;
+    newlines.push_back(i++);
+  }
+}
+
+int LineIndex::line(int64_t offset) const {
+  return std::lower_bound(newlines.begin(), newlines.end(), offset) -
+         newlines.begin() + 1;
+}
+
+int LineIndex::line(int64_t offset, size_t &hint) const {
+  if (hint > newlines.size() || (hint > 0 && newlines[hint - 1] >= offset)) {
+    hint = line(offset) - 1;
+    return hint + 1;
+  }
+  // Usually no more than a newline or two away.
+  while (hint < newlines.size() && newlines[hint] < offset)
+    hint++;
+  return hint + 1;
+}
+
+int64_t LineIndex::column(int64_t offset) const {
+  int before = line(offset) - 1;
+  int64_t line_start = before == 0 ? 0 : newlines[before - 1] + 1;
+  return offset - line_start + 1;
+}
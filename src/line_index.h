@@ -0,0 +1,29 @@
+#ifndef LINE_INDEX_H_
+#define LINE_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// LineIndex maps byte offsets in a source to lines and columns by a binary
+// search of the offsets of its newlines, which are found up front 16 bytes
+// at a time. The scanner records where tokens start and end as offsets and
+// asks the index for their lines, instead of counting newlines as it goes.
+class LineIndex {
+public:
+  explicit LineIndex(const std::string &source);
+
+  // The line holding offset, from 1: one more than the newlines before it.
+  int line(int64_t offset) const;
+  // Like line, for offsets that mostly grow from one call to the next, as
+  // while scanning; hint keeps the newline the last call stopped at.
+  int line(int64_t offset, size_t &hint) const;
+  // The column of offset, from 1, in bytes as compilers count them.
+  int64_t column(int64_t offset) const;
+
+private:
+  std::vector<int64_t> newlines;
+};
+
+#endif // LINE_INDEX_H_
@@ -0,0 +1,48 @@
+#include "lines.h"
+
+#include <vector>
+
+int line_of(Expr *expr) {
+  std::vector<Expr *> pending{expr};
+  while (!pending.empty()) {
+    Expr *e = pending.back();
+    pending.pop_back();
+    switch (e->get_type()) {
+    case ASSIGN:
+      return static_cast<Assign *>(e)->name.line;
+    case BINARY:
+      return static_cast<Binary *>(e)->op.line;
+    case UNARY:
+      return static_cast<Unary *>(e)->op.line;
+    case VARIABLE:
+      return static_cast<Variable *>(e)->name.line;
+    case CALL:
+      return static_cast<Call *>(e)->name.line;
+    case GROUPING:
+      pending.push_back(static_cast<Grouping *>(e)->expression);
+      break;
+    default:
+      break;
+    }
+  }
+  return 0;
+}
+
+int line_of(Stmt *stmt) {
+  if (Var *var = dynamic_cast<Var *>(stmt))
+    return var->name.line;
+  if (Expression *expression = dynamic_cast<Expression *>(stmt))
+    return line_of(expression->expression);
+  if (Print *print = dynamic_cast<Print *>(stmt))
+    return line_of(print->expression);
+  if (If *branch = dynamic_cast<If *>(stmt))
+    return branch->keyword.line;
+  if (While *loop = dynamic_cast<While *>(stmt))
+    return loop->keyword.line;
+  if (Import *import = dynamic_cast<Import *>(stmt))
+    return import->keyword.line;
+  Block *block = static_cast<Block *>(stmt);
+  if (block->body.tokens != nullptr)
+    return (*block->body.tokens)[block->body.begin].line;
+  return block->statements.empty() ? 0 : line_of(block->statements[0]);
+}
@@ -0,0 +1,12 @@
+#ifndef LINES_H_
+#define LINES_H_
+
+#include "expr.h"
+#include "stmt.h"
+
+// The line of the first token found in a node, or 0 if it has none, as for
+// a literal or an empty block.
+int line_of(Expr *expr);
+int line_of(Stmt *stmt);
+
+#endif // LINES_H_
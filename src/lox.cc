@@ -1,49 +1,261 @@
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <sstream>
 #include <string>
 
 #include "ast_printer.h"
+#include "cpp_emitter.h"
+#include "heap.h"
 #include "lox.h"
+#include "optimizer.h"
 #include "parser.h"
+#include "perf_counters.h"
+#include "rows.h"
 #include "scanner.h"
+#include "scanner_thread.h"
+#include "snapshot.h"
+#include "stream.h"
+#include "trace.h"
+#include "type_inference.h"
+#include "watch.h"
 
 void Lox::run(const std::string &source) {
-  Scanner scanner(source);
-  auto tokens = scanner.scanTokens();
-  // for (auto token : *tokens) {
-  //   std::cout << token.to_string() << std::endl;
-  // }
+  std::vector<Stmt *> statements;
+  // Every run, e.g. every line of the prompt, gets a budget of its own.
+  interpreter.restart_budget();
+  if (stream) {
+    StreamRunner runner(interpreter);
+    runner.modules = &modules;
+    runner.module_directory = module_directory;
+    runner.run(source);
+    return;
+  }
+  // Kept until the run ends, for the errors of blocks parsed lazily.
+  std::shared_ptr<const LineIndex> positions;
+  try {
+    std::shared_ptr<std::vector<Token>> tokens;
+    std::unique_ptr<ScannerThread> scanner_thread;
+    if (pipeline) {
+      // The parser pulls the tokens in as they are scanned.
+      scanner_thread = std::make_unique<ScannerThread>(source);
+      tokens = std::make_shared<std::vector<Token>>();
+      positions = scanner_thread->line_index();
+    } else {
+      TraceSpan span("scan");
+      PerfScope perf("scan");
+      Scanner scanner(source);
+      tokens = scanner.scanTokens();
+      positions = scanner.line_index();
+      span.count("tokens", tokens->size());
+    }
+    Lox::source_positions = positions.get();
+    // for (auto token : *tokens) {
+    //   std::cout << token.to_string() << std::endl;
+    // }
 
-  Parser parser(tokens);
-  std::vector<Stmt *> statements = parser.parse();
+    Parser parser(tokens);
+    // The C++ translation needs every block up front.
+    parser.lazy_blocks = lazy_blocks && !emit_cpp;
+    parser.strict_blocks = strict_blocks;
+    parser.share_exprs = share_exprs && !optimize && !optimize_verbose;
+    if (scanner_thread != nullptr)
+      parser.stream = &scanner_thread->tokens();
+    {
+      TraceSpan span("parse");
+      PerfScope perf("parse");
+      statements = parser.parse();
+      if (scanner_thread != nullptr)
+        scanner_thread->join();
+      span.count("statements", statements.size());
+      span.count("nodes", parser.node_count());
+      span.count("ast_bytes", Heap::used(HEAP_AST));
+      PerfPhases::add_nodes(parser.node_count());
+      if (parser.share_exprs) {
+        span.count("shared_nodes", parser.shared_count());
+        if (heap_stats)
+          std::cerr << "shared: " << parser.shared_count()
+                    << " expression nodes, " << parser.shared_bytes()
+                    << " bytes" << std::endl;
+      }
+    }
 
-  // Stop if there was a syntax error.
-  if (had_error)
-    return;
+    // A syntax error in a module stops the run as well.
+    if (!had_error)
+      modules.load(statements, module_directory);
 
-  // AstPrinter ap;
-  // std::string ppt = ap.print(expression);
-  // std::cout << ppt << std::endl;
+    // Stop if there was a syntax error.
+    if (!had_error) {
+      // AstPrinter ap;
+      // std::string ppt = ap.print(expression);
+      // std::cout << ppt << std::endl;
 
-  interpreter.interpret(statements);
+      // Modules define globals the passes do not see.
+      bool closed_globals = running_file && modules.imports == 0;
+      optimize_program(statements, closed_globals);
+      infer_program(statements, closed_globals);
+
+      if (emit_cpp) {
+        TraceSpan span("emit C++");
+        CppEmitter emitter(std::cout);
+        emitter.emit(statements);
+      } else {
+        TraceSpan span("interpret");
+        PerfScope perf("interpret");
+        span.count("statements", statements.size());
+        interpreter.interpret(statements);
+      }
+    }
+  } catch (RuntimeError e) {
+    Lox::runtime_error(e);
+  }
+  Lox::source_positions = nullptr;
+
+  interpreter.release_code();
+  for (Stmt *stmt : statements)
+    delete stmt;
+  Heap::clear(HEAP_AST);
+  Heap::clear(HEAP_TOKENS);
 }
 
 void Lox::run_file(char *file) {
+  // Read straight into one string, which a stringstream would copy again.
+  std::string source;
+  {
+    TraceSpan span("read file");
+    std::ifstream fin(file);
+    if (fin.good())
+      source.assign(std::istreambuf_iterator<char>(fin),
+                    std::istreambuf_iterator<char>());
+    fin.close();
+    span.count("bytes", source.size());
+  }
+  std::string path(file);
+  size_t slash = path.rfind('/');
+  module_directory = slash == std::string::npos ? "." : path.substr(0, slash);
+  // The globals of a snapshot are neither empty at the start nor unread at
+  // the end.
+  running_file = !snapshot_in && snapshot_out.empty();
+  Lox::run(source);
+  running_file = false;
+  if (!had_error && !had_runtime_error)
+    save_snapshot();
+
+  if (heap_stats)
+    Heap::report(std::cerr);
+  PerfPhases::report(std::cerr);
+  if (jit_stats && interpreter.get_jit() != nullptr)
+    interpreter.get_jit()->report(std::cerr);
+  if (Lox::had_error)
+    exit(65);
+  if (Lox::had_runtime_error)
+    exit(70);
+}
+
+void Lox::watch_file(char *file) {
+  Watcher watcher(interpreter);
+  watcher.watch(file, std::cerr);
+  exit(74);
+}
+
+void Lox::load_snapshot(const std::string &path) {
+  std::string error;
+  if (!Snapshot::load(interpreter, path, error)) {
+    std::cerr << "Could not read snapshot '" << path << "': " << error << "."
+              << std::endl;
+    exit(66);
+  }
+  snapshot_in = true;
+}
+
+void Lox::save_snapshot() {
+  if (snapshot_out.empty())
+    return;
+  std::string error;
+  if (!Snapshot::save(interpreter, snapshot_out, error)) {
+    std::cerr << "Could not write snapshot '" << snapshot_out << "': " << error
+              << "." << std::endl;
+    exit(74);
+  }
+}
+
+void Lox::run_rows(char *rows, char *file) {
   std::ifstream fin(file);
   std::stringstream buffer;
   if (fin.good()) {
     buffer << fin.rdbuf();
   }
   fin.close();
-  Lox::run(buffer.str());
 
+  std::vector<Stmt *> statements;
+  try {
+    Scanner scanner(buffer.str());
+    Parser parser(scanner.scanTokens());
+    Lox::source_positions = scanner.line_index().get();
+    statements = parser.parse();
+  } catch (RuntimeError e) {
+    Lox::runtime_error(e);
+  }
+  Lox::source_positions = nullptr;
+  if (!had_error && !had_runtime_error) {
+    std::string path(file);
+    size_t slash = path.rfind('/');
+    modules.load(statements,
+                 slash == std::string::npos ? "." : path.substr(0, slash));
+  }
+
+  if (!had_error && !had_runtime_error) {
+    // Every row starts with its columns already defined as globals.
+    optimize_program(statements, false);
+    infer_program(statements, false);
+    RowRunner runner(statements);
+    runner.threads = row_threads;
+    runner.delimiter = row_delimiter;
+    runner.jit = interpreter.get_jit() != nullptr;
+    runner.budget = interpreter.get_budget();
+    if (!runner.run(rows, std::cout, std::cerr)) {
+      std::cerr << "Could not read rows from '" << rows << "'." << std::endl;
+      exit(66);
+    }
+    had_runtime_error = runner.failed_rows != 0;
+  }
+
+  for (Stmt *stmt : statements)
+    delete stmt;
+  Heap::clear(HEAP_AST);
+  Heap::clear(HEAP_TOKENS);
+
+  if (heap_stats)
+    Heap::report(std::cerr);
   if (Lox::had_error)
     exit(65);
   if (Lox::had_runtime_error)
     exit(70);
 }
 
+void Lox::optimize_program(std::vector<Stmt *> &statements,
+                           bool closed_globals) {
+  if (!optimize && !optimize_verbose)
+    return;
+  TraceSpan span("optimize");
+  Optimizer optimizer(closed_globals);
+  optimizer.optimize(statements);
+  span.count("statements", statements.size());
+  if (optimize_verbose)
+    optimizer.report(std::cerr);
+}
+
+void Lox::infer_program(const std::vector<Stmt *> &statements,
+                        bool closed_globals) {
+  if (!infer_types && !infer_types_verbose)
+    return;
+  TypeInference inference(closed_globals);
+  inference.infer(statements);
+  if (infer_types_verbose)
+    inference.report(std::cerr);
+}
+
 void Lox::run_prompt() {
   std::string line;
   while (std::cin) {
@@ -51,4 +263,5 @@ void Lox::run_prompt() {
     Lox::run(line);
     Lox::had_error = false;
   }
+  save_snapshot();
 }
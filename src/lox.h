@@ -5,6 +5,8 @@
 #include <string>
 
 #include "interpreter.h"
+#include "line_index.h"
+#include "modules.h"
 #include "runtime_error.h"
 
 class Lox {
@@ -12,28 +14,99 @@ public:
   void run(const std::string &source);
   void run_file(char *file);
   void run_prompt();
+  // Runs file once per row of the delimited file rows; see RowRunner.
+  void run_rows(char *rows, char *file);
+  // Runs file again every time it changes; see Watcher.
+  void watch_file(char *file);
+  // Starts from the globals saved in a snapshot; exits if it cannot be read.
+  void load_snapshot(const std::string &path);
 
   Interpreter interpreter;
+  // The modules imported so far, parsed again only when they change.
+  ModuleCache modules;
+  // The directory imports are relative to: the script's, or for the prompt
+  // the working directory.
+  std::string module_directory = ".";
+  // Run the dataflow optimizer, and report what it eliminated to stderr.
+  bool optimize = false;
+  bool optimize_verbose = false;
+  // Run type inference, and report what it specialized to stderr.
+  bool infer_types = false;
+  bool infer_types_verbose = false;
+  // Parse the bodies of blocks only when they first run; with strict_blocks
+  // their syntax is still checked up front.
+  bool lazy_blocks = false;
+  bool strict_blocks = false;
+  // Let equal expressions share one node; see Parser::share_exprs. Left off
+  // with the optimizer, which rewrites expressions in place.
+  bool share_exprs = false;
+  // Scan on a thread of its own while parsing; see ScannerThread.
+  bool pipeline = false;
+  // Run each top-level declaration as soon as it is parsed, freeing it before
+  // parsing the next; see StreamRunner. The passes above do not apply.
+  bool stream = false;
+  // Print the program translated to C++ instead of running it.
+  bool emit_cpp = false;
+  // Print the heap account to stderr after running a file.
+  bool heap_stats = false;
+  // Print the JIT counters to stderr after running a file.
+  bool jit_stats = false;
+  // Saves the globals to this snapshot after running a file or at the end of
+  // the prompt; see Snapshot.
+  std::string snapshot_out;
+  // Worker threads and field delimiter for run_rows.
+  unsigned row_threads = 1;
+  char row_delimiter = ',';
 
   static bool had_error;
   static bool had_runtime_error;
 
-  static void report(int line, const std::string &where,
+  // Syntax errors in a module parsed on a worker thread, naming its file.
+  struct HeldReports {
+    std::string file;
+    std::string text;
+  };
+  // While set, reports made on this thread are appended here, for the
+  // ModuleCache to print in order, instead of going to stdout and setting
+  // had_error.
+  inline static thread_local HeldReports *held_reports = nullptr;
+  // The lines and columns of the source being parsed on this thread, when
+  // known, for the columns of syntax errors at a token.
+  inline static thread_local const LineIndex *source_positions = nullptr;
+
+  // Reports an error at line, and at column unless it is 0.
+  static void report(int line, int64_t column, const std::string &where,
                      const std::string &message) {
-    std::cout << "[line " << line << "] Error" + where + ": " + message
-              << std::endl;
+    std::string position = "[line " + std::to_string(line);
+    if (column > 0)
+      position += ", column " + std::to_string(column);
+    position += "] Error";
+    if (held_reports != nullptr) {
+      held_reports->text += position + " in \'" + held_reports->file + "\'" +
+                            where + ": " + message + "\n";
+      return;
+    }
+    std::cout << position + where + ": " + message << std::endl;
     had_error = true;
   }
 
+  static void report(int line, const std::string &where,
+                     const std::string &message) {
+    report(line, 0, where, message);
+  }
+
   static void error(int line, const std::string &message) {
     report(line, "", message);
   }
 
   static void error(Token token, const std::string &message) {
+    int64_t column = 0;
+    if (source_positions != nullptr && token.offset >= 0)
+      column = source_positions->column(token.offset);
     if (token.type == EOFL) {
-      report(token.line, " at end", message);
+      report(token.line, column, " at end", message);
     } else {
-      report(token.line, " at \'" + token.lexeme + "\'", message);
+      report(token.line, column, " at \'" + token.lexeme + "\'", message);
     }
   }
 
@@ -42,6 +115,17 @@ public:
               << std::endl;
     had_runtime_error = true;
   }
+
+private:
+  void optimize_program(std::vector<Stmt *> &statements, bool closed_globals);
+  void infer_program(const std::vector<Stmt *> &statements,
+                     bool closed_globals);
+  void save_snapshot();
+
+  // Set while running a whole file, whose globals nothing reads afterwards.
+  bool running_file = false;
+  // Set once the globals came from a snapshot.
+  bool snapshot_in = false;
 };
 
 #endif // LOX_H_
\ No newline at end of file
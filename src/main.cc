@@ -1,19 +1,183 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <thread>
 
 #include "ast_printer.h"
 #include "expr.h"
+#include "heap.h"
 #include "lox.h"
+#include "perf_counters.h"
+#include "trace.h"
+
+static void usage() {
+  std::cout << "Usage: cclox [options] [script]" << std::endl;
+  std::cout << "  --max-heap <bytes>  abort the run past this many bytes"
+            << std::endl;
+  std::cout << "  --heap-stats        print the heap account after the run"
+            << std::endl;
+  std::cout << "  --max-steps <n>     stop after n statements and expressions"
+            << std::endl;
+  std::cout << "  --timeout <ms>      stop after ms milliseconds" << std::endl;
+  std::cout << "  --perf-counters     print hardware counters for each phase"
+            << std::endl;
+  std::cout << "  --jit               compile numeric statement runs to x86-64"
+            << std::endl;
+  std::cout << "  --jit-stats         print the JIT counters after the run"
+            << std::endl;
+  std::cout << "  --optimize          remove dead stores and propagate copies"
+            << std::endl;
+  std::cout << "  --optimize-verbose  --optimize, reporting what it removed"
+            << std::endl;
+  std::cout << "  --infer-types       unbox the numbers type inference proves"
+            << std::endl;
+  std::cout << "  --infer-verbose     --infer-types, reporting what it proved"
+            << std::endl;
+  std::cout << "  --lazy-blocks       parse block bodies when they first run"
+            << std::endl;
+  std::cout << "  --strict-blocks     --lazy-blocks, checking syntax up front"
+            << std::endl;
+  std::cout << "  --share-exprs       share equal expression nodes in the AST"
+            << std::endl;
+  std::cout << "  --pipeline          scan on a second thread while parsing"
+            << std::endl;
+  std::cout << "  --stream            run each declaration as soon as it parses"
+            << std::endl;
+  std::cout << "  --emit-cpp          print the script translated to C++"
+            << std::endl;
+  std::cout << "  --watch             run the script again whenever it changes"
+            << std::endl;
+  std::cout << "  --trace <file>      write a Chrome trace of the run's phases"
+            << std::endl;
+  std::cout << "  --snapshot-in <f>   start from the globals saved in f"
+            << std::endl;
+  std::cout << "  --snapshot-out <f>  save the globals to f after the run"
+            << std::endl;
+  std::cout << "  --rows <file>       run the script once per row of a CSV file"
+            << std::endl;
+  std::cout << "  --threads <n>       worker threads for --rows (default: cores)"
+            << std::endl;
+  std::cout << "  --delimiter <c>     field delimiter for --rows (default: ,)"
+            << std::endl;
+  exit(64);
+}
+
+// The value of a numeric option, or the usage for anything but a whole
+// number up to max.
+static unsigned long long number_option(const char *arg,
+                                        unsigned long long max = ULLONG_MAX) {
+  if (*arg < '0' || *arg > '9')
+    usage();
+  char *end;
+  errno = 0;
+  unsigned long long value = strtoull(arg, &end, 10);
+  if (*end != 0 || errno == ERANGE || value > max)
+    usage();
+  return value;
+}
 
 int main(int argc, char *argv[]) {
   Lox lox;
   Lox::had_error = false;
   Lox::had_runtime_error = false;
 
-  if (argc > 2) {
-    std::cout << "Usage: cclox [script]" << std::endl;
-    exit(64);
-  } else if (argc == 2) {
-    lox.run_file(argv[1]);
+  char *script = nullptr;
+  char *rows = nullptr;
+  char *snapshot_in = nullptr;
+  bool watch = false;
+  Budget budget;
+  lox.row_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--max-heap" && i + 1 < argc) {
+      Heap::set_limit(number_option(argv[++i]));
+    } else if (arg == "--heap-stats") {
+      lox.heap_stats = true;
+    } else if (arg == "--max-steps" && i + 1 < argc) {
+      budget.max_steps = number_option(argv[++i]);
+    } else if (arg == "--timeout" && i + 1 < argc) {
+      budget.timeout_ms = number_option(argv[++i]);
+    } else if (arg == "--perf-counters") {
+      PerfPhases::enable();
+    } else if (arg == "--jit") {
+      lox.interpreter.enable_jit();
+    } else if (arg == "--jit-stats") {
+      lox.jit_stats = true;
+    } else if (arg == "--optimize") {
+      lox.optimize = true;
+    } else if (arg == "--optimize-verbose") {
+      lox.optimize_verbose = true;
+    } else if (arg == "--infer-types") {
+      lox.infer_types = true;
+    } else if (arg == "--infer-verbose") {
+      lox.infer_types_verbose = true;
+    } else if (arg == "--lazy-blocks") {
+      lox.lazy_blocks = true;
+    } else if (arg == "--strict-blocks") {
+      lox.lazy_blocks = lox.strict_blocks = true;
+    } else if (arg == "--share-exprs") {
+      lox.share_exprs = true;
+    } else if (arg == "--pipeline") {
+      lox.pipeline = true;
+    } else if (arg == "--stream") {
+      lox.stream = true;
+    } else if (arg == "--emit-cpp") {
+      lox.emit_cpp = true;
+    } else if (arg == "--watch") {
+      watch = true;
+    } else if (arg == "--trace" && i + 1 < argc) {
+      if (!Trace::start(argv[++i])) {
+        std::cerr << "Could not write trace to '" << argv[i] << "'."
+                  << std::endl;
+        exit(74);
+      }
+    } else if (arg == "--snapshot-in" && i + 1 < argc) {
+      snapshot_in = argv[++i];
+    } else if (arg == "--snapshot-out" && i + 1 < argc) {
+      lox.snapshot_out = argv[++i];
+    } else if (arg == "--rows" && i + 1 < argc) {
+      rows = argv[++i];
+    } else if (arg == "--threads" && i + 1 < argc) {
+      lox.row_threads =
+          std::max(1u, unsigned(number_option(argv[++i], UINT_MAX)));
+    } else if (arg == "--delimiter" && i + 1 < argc && argv[i + 1][0] != 0) {
+      lox.row_delimiter = argv[++i][0];
+    } else if (arg[0] != '-' && script == nullptr) {
+      script = argv[i];
+    } else {
+      usage();
+    }
+  }
+
+  lox.interpreter.set_budget(budget);
+
+  // Only a single run or the prompt carries its globals over.
+  if ((rows != nullptr || watch) &&
+      (snapshot_in != nullptr || !lox.snapshot_out.empty()))
+    usage();
+  // Streaming runs each declaration before the rest is parsed, which the
+  // whole-program passes and the other modes need.
+  if (lox.stream &&
+      (lox.optimize || lox.optimize_verbose || lox.infer_types ||
+       lox.infer_types_verbose || lox.lazy_blocks || lox.share_exprs ||
+       lox.emit_cpp || rows != nullptr || watch))
+    usage();
+  if (snapshot_in != nullptr)
+    lox.load_snapshot(snapshot_in);
+
+  if (rows != nullptr) {
+    if (script == nullptr)
+      usage();
+    lox.run_rows(rows, script);
+  } else if (watch) {
+    if (script == nullptr)
+      usage();
+    lox.watch_file(script);
+  } else if (script != nullptr) {
+    lox.run_file(script);
   } else {
     lox.run_prompt();
   }
@@ -0,0 +1,202 @@
+#include "modules.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+
+#include "lox.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+#include "trace.h"
+
+namespace {
+
+std::string directory_of(const std::string &path) {
+  size_t slash = path.rfind('/');
+  if (slash == std::string::npos)
+    return ".";
+  return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+// Resolves path against directory, to the canonical path when the file
+// exists, so that every spelling of it shares one module.
+std::string resolve(const std::string &directory, const std::string &path) {
+  std::string joined =
+      !path.empty() && path[0] == '/' ? path : directory + "/" + path;
+  char resolved[PATH_MAX];
+  if (realpath(joined.c_str(), resolved) != nullptr)
+    return resolved;
+  return joined;
+}
+
+// The modification time of path in nanoseconds, or -1 if it is not a
+// regular file.
+int64_t modification_time(const std::string &path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+    return -1;
+  return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+// The imports in statements, in the order they appear.
+std::vector<Import *> imports_in(const std::vector<Stmt *> &statements) {
+  std::vector<Import *> found;
+  std::vector<Stmt *> pending(statements.rbegin(), statements.rend());
+  while (!pending.empty()) {
+    Stmt *stmt = pending.back();
+    pending.pop_back();
+    if (Import *import = dynamic_cast<Import *>(stmt)) {
+      found.push_back(import);
+    } else if (Block *block = dynamic_cast<Block *>(stmt)) {
+      pending.insert(pending.end(), block->statements.rbegin(),
+                     block->statements.rend());
+    } else if (If *branch = dynamic_cast<If *>(stmt)) {
+      for (Stmt *s : {branch->else_branch, branch->then_branch}) {
+        if (s != nullptr)
+          pending.push_back(s);
+      }
+    } else if (While *loop = dynamic_cast<While *>(stmt)) {
+      if (loop->body != nullptr)
+        pending.push_back(loop->body);
+    }
+  }
+  return found;
+}
+
+} // namespace
+
+bool ModuleCache::load(const std::vector<Stmt *> &statements,
+                       const std::string &directory) {
+  TraceSpan span("load modules");
+  std::unique_lock<std::mutex> lock(mutex);
+  generation++;
+  parsed = reused = 0;
+  imports = discover(statements, directory);
+  if (!queue.empty()) {
+    lock.unlock();
+    std::vector<std::thread> workers;
+    for (unsigned w = 0; w < std::max(1u, threads); w++)
+      workers.emplace_back(&ModuleCache::work, this);
+    for (std::thread &worker : workers)
+      worker.join();
+    lock.lock();
+  }
+
+  // Workers find modules in no particular order, so their errors are
+  // printed in the order a depth-first run of the imports reaches them.
+  std::vector<Module *> order;
+  std::set<Module *> seen;
+  std::vector<Import *> pending = imports_in(statements);
+  std::reverse(pending.begin(), pending.end());
+  while (!pending.empty()) {
+    Module *module = pending.back()->module;
+    pending.pop_back();
+    if (!seen.insert(module).second)
+      continue;
+    order.push_back(module);
+    std::vector<Import *> nested = imports_in(module->statements);
+    pending.insert(pending.end(), nested.rbegin(), nested.rend());
+  }
+  reached = order.size();
+  bool ok = true;
+  for (Module *module : order) {
+    if (module->failed) {
+      std::cout << module->errors;
+      ok = false;
+    }
+  }
+  if (!ok)
+    Lox::had_error = true;
+  span.count("modules", reached);
+  span.count("parsed", parsed);
+  return ok;
+}
+
+size_t ModuleCache::discover(const std::vector<Stmt *> &statements,
+                             const std::string &directory) {
+  std::vector<Import *> found = imports_in(statements);
+  for (Import *import : found) {
+    std::string path = resolve(directory, import->path);
+    std::unique_ptr<Module> &module = modules[path];
+    if (module == nullptr) {
+      module = std::make_unique<Module>();
+      module->path = path;
+    }
+    import->module = module.get();
+    if (module->generation != generation) {
+      module->generation = generation;
+      module->line = import->keyword.line;
+      queue.push_back(module.get());
+      idle.notify_one();
+    }
+  }
+  return found.size();
+}
+
+void ModuleCache::work() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    idle.wait(lock, [this] { return !queue.empty() || busy == 0; });
+    // With nothing queued and no module being parsed, nothing more can be.
+    if (queue.empty())
+      return;
+    Module *module = queue.front();
+    queue.pop_front();
+    busy++;
+    lock.unlock();
+    bool changed = refresh(module);
+    lock.lock();
+    if (changed)
+      parsed++;
+    else
+      reused++;
+    discover(module->statements, directory_of(module->path));
+    busy--;
+    idle.notify_all();
+  }
+}
+
+bool ModuleCache::refresh(Module *module) {
+  int64_t mtime = modification_time(module->path);
+  if (mtime != -1 && mtime == module->mtime)
+    return false;
+
+  for (Stmt *stmt : module->statements)
+    delete stmt;
+  module->statements.clear();
+  module->mtime = mtime;
+  std::ifstream fin(module->path);
+  if (mtime == -1 || !fin.good()) {
+    module->errors = "[line " + std::to_string(module->line) +
+                     "] Error at 'import': Could not read module '" +
+                     module->path + "'.\n";
+    module->failed = true;
+    return true;
+  }
+  std::stringstream buffer;
+  buffer << fin.rdbuf();
+
+  Lox::HeldReports held{module->path, ""};
+  Lox::held_reports = &held;
+  try {
+    Scanner scanner(buffer.str());
+    Parser parser(scanner.scanTokens());
+    Lox::source_positions = scanner.line_index().get();
+    module->statements = parser.parse();
+  } catch (RuntimeError e) {
+    held.text += "[line " + std::to_string(e.op.line) + "] RuntimeError in '" +
+                 module->path + "': " + e.what() + "\n";
+  }
+  Lox::source_positions = nullptr;
+  Lox::held_reports = nullptr;
+  module->errors = held.text;
+  module->failed = !held.text.empty();
+  return true;
+}
@@ -0,0 +1,91 @@
+#ifndef MODULES_H_
+#define MODULES_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "stmt.h"
+
+// A Module is a file run by import statements, parsed by the ModuleCache
+// that owns it.
+struct Module {
+  ~Module() {
+    for (Stmt *stmt : statements)
+      delete stmt;
+  }
+
+  // The resolved path of the file, and the modification time it had when it
+  // was parsed, in nanoseconds.
+  std::string path;
+  int64_t mtime = -1;
+  std::vector<Stmt *> statements;
+  // The syntax errors of the last parse, or why the file could not be read,
+  // already formatted; failed when there are any.
+  std::string errors;
+  bool failed = false;
+  // The line of the first import found reaching the module, and the load
+  // that reached it last.
+  int line = 0;
+  unsigned generation = 0;
+};
+
+// ModuleCache loads the modules a program imports before it runs. The
+// imports of the program are found in its tree, then the modules are read,
+// scanned and parsed on a pool of worker threads, and the imports found in
+// each module are queued in turn, so a program importing many files parses
+// them side by side.
+//
+// Modules stay cached across loads, keyed by their resolved path, and are
+// parsed again only once their modification time changes, e.g. between the
+// lines of the prompt. The parsed statements are only read while running,
+// so any number of interpreters may share them.
+class ModuleCache {
+public:
+  ModuleCache() = default;
+  ModuleCache(const ModuleCache &) = delete;
+  ModuleCache &operator=(const ModuleCache &) = delete;
+
+  // Points every import in statements, and in the modules they reach, at
+  // its Module, reading and parsing the modules that are new or changed.
+  // Paths are relative to directory, or for an import in a module, to the
+  // directory of the module. Prints the errors of failed modules in the
+  // order they were imported and returns false if there were any.
+  bool load(const std::vector<Stmt *> &statements,
+            const std::string &directory);
+
+  // The worker threads parsing modules.
+  unsigned threads = 4;
+  // The imports found in the statements passed to the last load, and the
+  // modules it reached, parsed and found unchanged.
+  size_t imports = 0;
+  size_t reached = 0;
+  size_t parsed = 0;
+  size_t reused = 0;
+
+private:
+  // Finds the imports in statements, resolving their paths against
+  // directory, and queues each module not yet reached by this load. Called
+  // with mutex held.
+  size_t discover(const std::vector<Stmt *> &statements,
+                  const std::string &directory);
+  // Reparses module if its file changed since it was parsed, returning
+  // whether it did.
+  bool refresh(Module *module);
+  void work();
+
+  std::map<std::string, std::unique_ptr<Module>> modules;
+  std::mutex mutex;
+  std::condition_variable idle;
+  std::deque<Module *> queue;
+  // Workers parsing a module.
+  unsigned busy = 0;
+  unsigned generation = 0;
+};
+
+#endif // MODULES_H_
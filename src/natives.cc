@@ -0,0 +1,64 @@
+#include "natives.h"
+
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+namespace {
+
+double clock_seconds() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+double square_root(double x) { return std::sqrt(x); }
+double round_down(double x) { return std::floor(x); }
+double absolute(double x) { return std::fabs(x); }
+double length(const std::string &s) { return s.size(); }
+
+std::mutex registry_mutex;
+
+struct Binding {
+  NativeFunction native;
+  // Set once a parse resolved a call to native, which may then be running.
+  bool resolved = false;
+};
+
+// Node based, so the functions stay where they are as more are defined. The
+// standard functions are also in runtime/lox_runtime.h for CppEmitter.
+std::map<std::string, Binding> &registry() {
+  static std::map<std::string, Binding> bindings = [] {
+    std::map<std::string, Binding> standard;
+    for (const NativeFunction &native :
+         {native_binding::bind("clock", clock_seconds),
+          native_binding::bind("sqrt", square_root),
+          native_binding::bind("floor", round_down),
+          native_binding::bind("abs", absolute),
+          native_binding::bind("len", length)})
+      standard[native.name].native = native;
+    return standard;
+  }();
+  return bindings;
+}
+
+} // namespace
+
+NativeFunction *Natives::find(const std::string &name) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  auto found = registry().find(name);
+  if (found == registry().end())
+    return nullptr;
+  found->second.resolved = true;
+  return &found->second.native;
+}
+
+NativeFunction *Natives::add(const NativeFunction &native) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  Binding &binding = registry()[native.name];
+  if (binding.resolved)
+    return nullptr;
+  binding.native = native;
+  return &binding.native;
+}
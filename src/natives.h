@@ -0,0 +1,161 @@
+#ifndef NATIVES_H_
+#define NATIVES_H_
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "expr.h"
+#include "runtime_error.h"
+
+// A NativeFunction is a host C++ function that scripts call as
+// name(arguments). Calls are resolved by the parser, which also checks the
+// number of arguments, so a call only evaluates its arguments and jumps
+// through call.
+struct NativeFunction {
+  std::string name;
+  int arity;
+  // The ValueType of every result, or -1 when it varies, for TypeInference.
+  int result_type;
+  // Checks the types of arity arguments, unpacks them straight into the
+  // parameters of function and boxes its result, raising a RuntimeError at
+  // line for an argument of the wrong type. Generated from the signature of
+  // function by Natives::define.
+  ExprValue (*call)(const NativeFunction &native, const ExprValue *arguments,
+                    int line);
+  // The bound function, cast back to its own type by call.
+  void (*function)();
+};
+
+namespace native_binding {
+
+// NativeType converts between ExprValue and the C++ type T of a parameter
+// or a result: double and other arithmetic types are Lox numbers, bool a
+// Lox boolean, std::string a string and ExprValue any value at all.
+// Arguments are passed by reference where the parameter allows it, so a
+// string argument is not copied for a const std::string & parameter.
+template <typename T, typename = void> struct NativeType;
+
+template <typename T>
+struct NativeType<
+    T, std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>> {
+  static constexpr int type = VALNUMBER;
+  static constexpr const char *name = "a number";
+  static T from(const ExprValue &value) { return static_cast<T>(value.number); }
+  static ExprValue to(T number) {
+    ExprValue value;
+    value.type = VALNUMBER;
+    value.number = number;
+    return value;
+  }
+};
+
+template <> struct NativeType<bool> {
+  static constexpr int type = VALBOOL;
+  static constexpr const char *name = "a boolean";
+  static bool from(const ExprValue &value) { return value.boolean; }
+  static ExprValue to(bool boolean) {
+    ExprValue value;
+    value.type = VALBOOL;
+    value.boolean = boolean;
+    return value;
+  }
+};
+
+template <> struct NativeType<std::string> {
+  static constexpr int type = VALSTRING;
+  static constexpr const char *name = "a string";
+  static const std::string &from(const ExprValue &value) {
+    return value.string;
+  }
+  static ExprValue to(std::string string) {
+    ExprValue value;
+    value.type = VALSTRING;
+    value.string = std::move(string);
+    return value;
+  }
+};
+
+template <> struct NativeType<ExprValue> {
+  static constexpr int type = -1;
+  static const ExprValue &from(const ExprValue &value) { return value; }
+  static ExprValue to(ExprValue value) { return value; }
+};
+
+template <typename T> using Native = NativeType<std::decay_t<T>>;
+
+template <typename T>
+void check(const NativeFunction &native, const ExprValue &argument,
+           size_t index, int line) {
+  if constexpr (Native<T>::type != -1) {
+    if (argument.type != Native<T>::type)
+      throw RuntimeError(line, "Argument " + std::to_string(index + 1) +
+                                   " of \'" + native.name + "\' must be " +
+                                   Native<T>::name + ".");
+  }
+}
+
+template <typename R, typename... Args, size_t... I>
+ExprValue invoke(const NativeFunction &native, const ExprValue *arguments,
+                 [[maybe_unused]] int line, std::index_sequence<I...>) {
+  (check<Args>(native, arguments[I], I, line), ...);
+  auto function = reinterpret_cast<R (*)(Args...)>(native.function);
+  if constexpr (std::is_void_v<R>) {
+    function(Native<Args>::from(arguments[I])...);
+    return ExprValue();
+  } else {
+    return Native<R>::to(function(Native<Args>::from(arguments[I])...));
+  }
+}
+
+template <typename R, typename... Args>
+ExprValue call(const NativeFunction &native, const ExprValue *arguments,
+               int line) {
+  return invoke<R, Args...>(native, arguments, line,
+                            std::index_sequence_for<Args...>());
+}
+
+// The NativeFunction calling function under name.
+template <typename R, typename... Args>
+NativeFunction bind(const std::string &name, R (*function)(Args...)) {
+  int result_type = -1;
+  if constexpr (std::is_void_v<R>)
+    result_type = VALNIL;
+  else
+    result_type = Native<R>::type;
+  return {name, int(sizeof...(Args)), result_type, &call<R, Args...>,
+          reinterpret_cast<void (*)()>(function)};
+}
+
+} // namespace native_binding
+
+// Natives is the registry of the native functions scripts may call, shared
+// by every parser and interpreter of the process. It starts out with clock,
+// sqrt, floor, abs and len; hosts define their own before parsing the
+// scripts that call them.
+class Natives {
+public:
+  // Binds name to function, replacing an earlier binding of the name as long
+  // as no parse has resolved a call to it yet. After that, calls may be
+  // running it on other threads, e.g. the workers of --rows, so the binding
+  // is left alone and null is returned. Captureless lambdas are bound through
+  // their function pointer.
+  template <typename R, typename... Args>
+  static NativeFunction *define(const std::string &name,
+                                R (*function)(Args...)) {
+    return add(native_binding::bind(name, function));
+  }
+  template <typename F>
+  static NativeFunction *define(const std::string &name, F function) {
+    return define(name, +function);
+  }
+
+  // The function bound to name, or null. Fixes the binding of name.
+  static NativeFunction *find(const std::string &name);
+
+private:
+  static NativeFunction *add(const NativeFunction &native);
+};
+
+#endif // NATIVES_H_
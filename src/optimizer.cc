@@ -0,0 +1,505 @@
+#include "optimizer.h"
+#include "heap.h"
+#include "lines.h"
+#include "natives.h"
+#include "trace.h"
+
+#include <sstream>
+
+namespace {
+
+const int UNKNOWN = -1;
+
+// Each pass can expose more dead code, e.g. removing a dead store drops the
+// reads in its value.
+const int MAX_PASSES = 4;
+
+// A literal of value, in place of a read on line.
+Expr *literal(const ExprValue &value, int line) {
+  switch (value.type) {
+  case VALSTRING:
+    return new PrimitiveString(value.string, line);
+  case VALNUMBER:
+    return new PrimitiveNumber(value.number);
+  case VALBOOL:
+    return new PrimitiveBool(value.boolean);
+  default:
+    return new PrimitiveNil(nullptr);
+  }
+}
+
+} // namespace
+
+void Optimizer::optimize(std::vector<Stmt *> &statements) {
+  for (int pass = 0; pass < MAX_PASSES; pass++) {
+    TraceSpan span("optimizer pass " + std::to_string(pass + 1));
+    declarations.clear();
+    externals.clear();
+    removed.clear();
+    unwrapped.clear();
+    dropped_initializers.clear();
+    changes = 0;
+
+    scopes.push_back({closed_globals, {}});
+    for (Stmt *stmt : statements)
+      stmt->accept(this);
+    end_scope();
+
+    rewrite(statements);
+    span.count("changes", changes);
+    if (changes == 0)
+      break;
+  }
+}
+
+void Optimizer::report(std::ostream &out) {
+  for (const std::string &line : log)
+    out << line << std::endl;
+  out << "optimizer: " << eliminated << " statements eliminated, "
+      << propagated << " copies propagated" << std::endl;
+}
+
+void Optimizer::visit_ExpressionStmt(Expression *expression) {
+  if (expression->expression->get_type() != ASSIGN) {
+    if (analyze(expression->expression).pure)
+      remove(expression, "expression without effect");
+    return;
+  }
+
+  Assign *assign = static_cast<Assign *>(expression->expression);
+  Value value = analyze(assign->value);
+  Declaration *declaration = resolve(assign->name.lexeme);
+  if (!declaration->tracked) {
+    store(declaration, nullptr, value);
+    return;
+  }
+  store(declaration, expression, value);
+  declaration->stores.push_back({expression, value.pure});
+}
+
+void Optimizer::visit_PrintStmt(Print *print) { analyze(print->expression); }
+
+void Optimizer::visit_VarStmt(Var *var) {
+  Value value{VALNIL, true, nullptr, true, ExprValue()};
+  if (var->initializer != nullptr)
+    value = analyze(var->initializer);
+
+  Scope &scope = scopes.back();
+  if (!scope.closed) {
+    // The global may exist already, in which case this does not store.
+    Declaration *declaration = resolve(var->name.lexeme);
+    Value unknown{UNKNOWN, false, nullptr, false, ExprValue()};
+    store(declaration, nullptr, unknown);
+    return;
+  }
+
+  // Environment::define keeps the first definition of a name in a scope.
+  if (scope.names.count(var->name.lexeme)) {
+    if (value.pure)
+      remove(var, "redeclaration of '" + var->name.lexeme + "'");
+    return;
+  }
+
+  declarations.emplace_back();
+  Declaration *declaration = &declarations.back();
+  declaration->name = var->name.lexeme;
+  declaration->var = var;
+  declaration->tracked = true;
+  declaration->initializer_pure = value.pure;
+  scope.names[var->name.lexeme] = declaration;
+  store(declaration, var, value);
+}
+
+void Optimizer::visit_BlockStmt(Block *block) {
+  if (block->body.tokens != nullptr) {
+    escape_all();
+    return;
+  }
+  scopes.push_back({true, {}});
+  for (Stmt *stmt : block->statements)
+    stmt->accept(this);
+  end_scope();
+}
+
+void Optimizer::visit_ImportStmt(Import *) {
+  // The module may read and store any variable in scope.
+  escape_all();
+}
+
+void Optimizer::visit_IfStmt(If *stmt) {
+  analyze(stmt->condition);
+  // Either branch may run, so nothing learned in one holds in the other or
+  // after the if.
+  for (Stmt *branch : {stmt->then_branch, stmt->else_branch}) {
+    escape_all();
+    if (branch != nullptr)
+      branch->accept(this);
+  }
+  escape_all();
+}
+
+void Optimizer::visit_WhileStmt(While *stmt) {
+  // The condition also runs after the body, and after the loop nothing is
+  // known about how often the body ran.
+  escape_all();
+  analyze(stmt->condition);
+  if (stmt->body != nullptr)
+    stmt->body->accept(this);
+  if (stmt->increment != nullptr)
+    analyze(stmt->increment);
+  escape_all();
+}
+
+// analyze walks expr in evaluation order with an explicit stack, recording
+// reads and stores and replacing propagated copies in place.
+Optimizer::Value Optimizer::analyze(Expr *&expr) {
+  struct Work {
+    Expr **slot;
+    bool operands_done;
+  };
+  std::vector<Work> work{{&expr, false}};
+  std::vector<Value> values;
+
+  while (!work.empty()) {
+    Work w = work.back();
+    work.pop_back();
+    Expr *e = *w.slot;
+
+    switch (e->get_type()) {
+    case BINARY: {
+      Binary *binary = static_cast<Binary *>(e);
+      if (!w.operands_done) {
+        work.push_back({w.slot, true});
+        work.push_back({&binary->right, false});
+        work.push_back({&binary->left, false});
+        break;
+      }
+      Value right = values.back();
+      values.pop_back();
+      Value left = values.back();
+      bool pure = left.pure && right.pure;
+      bool numbers = left.type == VALNUMBER && right.type == VALNUMBER;
+      Value result{VALBOOL, pure, nullptr, false, ExprValue()};
+
+      switch (binary->op.type) {
+      case EQUAL_EQUAL:
+      case BANG_EQUAL:
+        break;
+      case GREATER:
+      case GREATER_EQUAL:
+      case LESS:
+      case LESS_EQUAL:
+        result.pure = pure && numbers;
+        break;
+      case PLUS:
+        if (left.type == VALSTRING || right.type == VALSTRING)
+          result.type = VALSTRING;
+        else if (left.type == VALNUMBER || right.type == VALNUMBER)
+          result.type = VALNUMBER;
+        else
+          result.type = UNKNOWN;
+        // Concatenation can exceed a heap limit.
+        result.pure = pure && (numbers || (left.type == VALSTRING &&
+                                           right.type == VALSTRING &&
+                                           Heap::get_limit() == 0));
+        break;
+      case SLASH:
+        result.type = VALNUMBER;
+        result.pure = pure && numbers && right.constant &&
+                      right.literal.number != 0;
+        break;
+      default:
+        result.type = VALNUMBER;
+        result.pure = pure && numbers;
+        break;
+      }
+      values.back() = result;
+      break;
+    }
+    case UNARY: {
+      Unary *unary = static_cast<Unary *>(e);
+      if (!w.operands_done) {
+        work.push_back({w.slot, true});
+        work.push_back({&unary->right, false});
+        break;
+      }
+      Value &value = values.back();
+      if (unary->op.type == MINUS) {
+        value.pure = value.pure && value.type == VALNUMBER;
+        value.type = VALNUMBER;
+      } else {
+        value.type = VALBOOL;
+      }
+      value.copy_of = nullptr;
+      value.constant = false;
+      break;
+    }
+    case GROUPING:
+      work.push_back({&static_cast<Grouping *>(e)->expression, false});
+      break;
+    case ASSIGN: {
+      Assign *assign = static_cast<Assign *>(e);
+      if (!w.operands_done) {
+        work.push_back({w.slot, true});
+        work.push_back({&assign->value, false});
+        break;
+      }
+      Declaration *declaration = resolve(assign->name.lexeme);
+      declaration->pinned = true;
+      store(declaration, nullptr, values.back());
+      values.back() = {values.back().type, false, nullptr, false, ExprValue()};
+      break;
+    }
+    case CALL: {
+      Call *call = static_cast<Call *>(e);
+      if (!w.operands_done) {
+        work.push_back({w.slot, true});
+        for (auto it = call->arguments.rbegin(); it != call->arguments.rend();
+             ++it)
+          work.push_back({&*it, false});
+        break;
+      }
+      values.resize(values.size() - call->arguments.size());
+      // A native may raise a RuntimeError, or have effects of its own.
+      values.push_back({call->native->result_type, false, nullptr, false,
+                        ExprValue()});
+      break;
+    }
+    case VARIABLE:
+      values.push_back(read(*w.slot));
+      break;
+    case PRIMITIVESTRING: {
+      Value value{VALSTRING, true, nullptr, true, ExprValue()};
+      value.literal.type = VALSTRING;
+      value.literal.string = static_cast<PrimitiveString *>(e)->value;
+      values.push_back(value);
+      break;
+    }
+    case PRIMITIVENUMBER: {
+      Value value{VALNUMBER, true, nullptr, true, ExprValue()};
+      value.literal.type = VALNUMBER;
+      value.literal.number = static_cast<PrimitiveNumber *>(e)->value;
+      values.push_back(value);
+      break;
+    }
+    case PRIMITIVEBOOL: {
+      Value value{VALBOOL, true, nullptr, true, ExprValue()};
+      value.literal.type = VALBOOL;
+      value.literal.boolean = static_cast<PrimitiveBool *>(e)->value;
+      values.push_back(value);
+      break;
+    }
+    case PRIMITIVENIL:
+      values.push_back({VALNIL, true, nullptr, true, ExprValue()});
+      break;
+    }
+  }
+
+  return values.back();
+}
+
+Optimizer::Value Optimizer::read(Expr *&slot) {
+  Variable *variable = static_cast<Variable *>(slot);
+  Declaration *declaration = resolve(variable->name.lexeme);
+  const Value &known = declaration->value;
+
+  if (known.constant) {
+    std::ostringstream line;
+    line << "[line " << variable->name.line << "] propagated the value of '"
+         << variable->name.lexeme << "'";
+    log.push_back(line.str());
+    propagated++;
+    changes++;
+    slot = literal(known.literal, variable->name.line);
+    delete variable;
+    return known;
+  }
+
+  // The source must still be the variable its name refers to here.
+  Declaration *source = known.copy_of;
+  if (source != nullptr && resolve(source->name) == source) {
+    std::ostringstream line;
+    line << "[line " << variable->name.line << "] propagated copy of '"
+         << source->name << "' into '" << variable->name.lexeme << "'";
+    log.push_back(line.str());
+    propagated++;
+    changes++;
+    variable->name.lexeme = source->name;
+    declaration = source;
+  }
+
+  declaration->reads++;
+  declaration->pending = nullptr;
+  // Reading a variable the program did not declare may fail.
+  if (!declaration->tracked)
+    return {UNKNOWN, false, declaration, false, ExprValue()};
+  return {declaration->value.type, true, declaration, false, ExprValue()};
+}
+
+// store records that declaration now holds value, written by stmt, or by an
+// assignment inside a larger expression when stmt is null.
+void Optimizer::store(Declaration *declaration, Stmt *stmt,
+                      const Value &value) {
+  if (declaration->pending != nullptr && declaration->pending_pure) {
+    Stmt *dead = declaration->pending;
+    if (Var *var = dynamic_cast<Var *>(dead)) {
+      if (var->initializer != nullptr && !dropped_initializers.count(var)) {
+        dropped_initializers[var] =
+            "dead initializer of '" + declaration->name + "'";
+        changes++;
+      }
+    } else {
+      remove(dead, "dead store to '" + declaration->name + "'");
+    }
+  }
+  declaration->pending = declaration->tracked ? stmt : nullptr;
+  declaration->pending_pure = value.pure;
+
+  for (Declaration *copy : declaration->copies) {
+    if (copy->value.copy_of == declaration)
+      copy->value.copy_of = nullptr;
+  }
+  declaration->copies.clear();
+
+  if (!declaration->tracked) {
+    declaration->value = {UNKNOWN, false, nullptr, false, ExprValue()};
+    return;
+  }
+  declaration->value = value;
+  if (value.copy_of == declaration)
+    declaration->value.copy_of = nullptr;
+  if (declaration->value.copy_of != nullptr)
+    declaration->value.copy_of->copies.push_back(declaration);
+}
+
+Optimizer::Declaration *Optimizer::resolve(const std::string &name) {
+  for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+    if (!scope->closed)
+      continue;
+    if (auto found = scope->names.find(name); found != scope->names.end())
+      return found->second;
+  }
+
+  Declaration *&external = externals[name];
+  if (external == nullptr) {
+    declarations.emplace_back();
+    external = &declarations.back();
+    external->name = name;
+  }
+  return external;
+}
+
+void Optimizer::end_scope() {
+  for (auto &entry : scopes.back().names) {
+    Declaration *declaration = entry.second;
+    if (declaration->reads == 0 && !declaration->pinned) {
+      remove_unused(declaration);
+    } else if (declaration->pending != nullptr && declaration->pending_pure) {
+      Value unknown{UNKNOWN, false, nullptr, false, ExprValue()};
+      store(declaration, nullptr, unknown);
+    }
+  }
+  scopes.pop_back();
+}
+
+void Optimizer::escape_all() {
+  for (Declaration &declaration : declarations) {
+    declaration.reads++;
+    declaration.pinned = true;
+    declaration.pending = nullptr;
+    declaration.value = {UNKNOWN, false, nullptr, false, ExprValue()};
+    declaration.copies.clear();
+  }
+}
+
+void Optimizer::remove_unused(Declaration *declaration) {
+  std::string reason = "unused variable '" + declaration->name + "'";
+  Var *var = declaration->var;
+  if (declaration->initializer_pure)
+    remove(var, reason);
+  else if (!unwrapped.count(var) && !removed.count(var))
+    unwrapped[var] = reason, changes++;
+
+  for (auto &store : declaration->stores) {
+    if (store.second)
+      remove(store.first, "store to " + reason);
+    else if (!unwrapped.count(store.first) && !removed.count(store.first))
+      unwrapped[store.first] = "store to " + reason, changes++;
+  }
+}
+
+void Optimizer::remove(Stmt *stmt, const std::string &reason) {
+  if (removed.count(stmt))
+    return;
+  removed[stmt] = reason;
+  changes++;
+}
+
+void Optimizer::rewrite(std::vector<Stmt *> &statements) {
+  std::vector<Stmt *> kept;
+  for (Stmt *stmt : statements) {
+    int line = line_of(stmt);
+    std::string reason;
+
+    if (auto found = removed.find(stmt); found != removed.end()) {
+      reason = "removed " + found->second;
+      delete stmt;
+      stmt = nullptr;
+    } else if (auto found = unwrapped.find(stmt); found != unwrapped.end()) {
+      // Keep evaluating the value for its errors and assignments.
+      Expr *value;
+      if (Var *var = dynamic_cast<Var *>(stmt)) {
+        value = var->initializer;
+        var->initializer = nullptr;
+      } else {
+        Assign *assign = static_cast<Assign *>(
+            static_cast<Expression *>(stmt)->expression);
+        value = assign->value;
+        assign->value = nullptr;
+      }
+      reason = "dropped the " + found->second;
+      delete stmt;
+      stmt = new Expression(value);
+    } else if (Var *var = dynamic_cast<Var *>(stmt)) {
+      if (auto found = dropped_initializers.find(var);
+          found != dropped_initializers.end()) {
+        reason = "removed " + found->second;
+        delete var->initializer;
+        var->initializer = nullptr;
+      }
+    } else if (If *branch = dynamic_cast<If *>(stmt)) {
+      rewrite_branch(branch->then_branch);
+      rewrite_branch(branch->else_branch);
+    } else if (While *loop = dynamic_cast<While *>(stmt)) {
+      rewrite_branch(loop->body);
+    } else if (Block *block = dynamic_cast<Block *>(stmt)) {
+      rewrite(block->statements);
+      if (block->statements.empty() && block->body.tokens == nullptr) {
+        delete block;
+        stmt = nullptr;
+        reason = "removed empty block";
+      }
+    }
+
+    if (!reason.empty()) {
+      std::ostringstream entry;
+      entry << "[line " << line << "] " << reason;
+      log.push_back(entry.str());
+      if (stmt == nullptr)
+        eliminated++;
+    }
+    if (stmt != nullptr)
+      kept.push_back(stmt);
+  }
+  statements.swap(kept);
+}
+
+// rewrite_branch rewrites the single statement of an if or while, which
+// becomes null when it is removed.
+void Optimizer::rewrite_branch(Stmt *&branch) {
+  if (branch == nullptr)
+    return;
+  std::vector<Stmt *> statements{branch};
+  rewrite(statements);
+  branch = statements.empty() ? nullptr : statements[0];
+}
@@ -0,0 +1,117 @@
+#ifndef OPTIMIZER_H_
+#define OPTIMIZER_H_
+
+#include <deque>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "expr.h"
+#include "stmt.h"
+
+// Optimizer is a dataflow pass over a parsed program. Outside of if and
+// while statements every statement list runs straight through, so one
+// forward walk per pass sees each variable's stores and reads in execution
+// order. It
+//   - removes stores that are overwritten or go out of scope unread,
+//   - removes variables that are never read, with all their stores,
+//   - removes expression statements and blocks that have no effect, and
+//   - replaces reads of a variable holding a copy of another variable or a
+//     literal with that variable or literal.
+// A block left unparsed by a lazy parse may read or assign any variable in
+// scope, so every variable is treated as read and pinned there. The same
+// goes around the branches of an if and around a loop, which may run any
+// number of times.
+// Only expressions that cannot raise a RuntimeError are removed, so print
+// output and runtime errors stay the same.
+class Optimizer : public StmtVisitor {
+public:
+  // closed_globals means the program starts from empty globals which nothing
+  // reads after it ends, as when running a file. Otherwise, as in the REPL,
+  // globals are left alone and only block locals are optimized.
+  Optimizer(bool closed_globals) : closed_globals(closed_globals) {}
+
+  virtual void visit_ExpressionStmt(Expression *expression);
+  virtual void visit_PrintStmt(Print *print);
+  virtual void visit_VarStmt(Var *var);
+  virtual void visit_BlockStmt(Block *block);
+  virtual void visit_IfStmt(If *stmt);
+  virtual void visit_WhileStmt(While *stmt);
+  virtual void visit_ImportStmt(Import *stmt);
+
+  // Rewrites statements in place, deleting whatever it removes.
+  void optimize(std::vector<Stmt *> &statements);
+  // Writes one line per eliminated statement or propagated copy.
+  void report(std::ostream &out);
+
+  size_t eliminated = 0;
+  size_t propagated = 0;
+
+private:
+  struct Declaration;
+
+  // What the pass knows about the value of an expression.
+  struct Value {
+    // A ValueType, or -1 when unknown.
+    int type;
+    // Evaluating it cannot raise a RuntimeError or assign a variable.
+    bool pure;
+    Declaration *copy_of;
+    bool constant;
+    ExprValue literal;
+  };
+
+  // A variable, or for a name not declared by the program, every global of
+  // that name. Only variables the program declares are tracked.
+  struct Declaration {
+    std::string name;
+    Var *var = nullptr;
+    bool tracked = false;
+    bool initializer_pure = true;
+    int reads = 0;
+    // Assigned inside a larger expression, which is never removed.
+    bool pinned = false;
+    // Assignment statements storing to it, and whether their value is pure.
+    std::vector<std::pair<Expression *, bool>> stores;
+    // The last store not read yet.
+    Stmt *pending = nullptr;
+    bool pending_pure = false;
+    // The current value, when known.
+    Value value{-1, false, nullptr, false, ExprValue()};
+    // Declarations whose value is a copy of this one.
+    std::vector<Declaration *> copies;
+  };
+
+  struct Scope {
+    bool closed;
+    std::map<std::string, Declaration *> names;
+  };
+
+  Value analyze(Expr *&expr);
+  Value read(Expr *&slot);
+  void store(Declaration *declaration, Stmt *stmt, const Value &value);
+  Declaration *resolve(const std::string &name);
+  void end_scope();
+  void escape_all();
+  void remove_unused(Declaration *declaration);
+  void remove(Stmt *stmt, const std::string &reason);
+  void rewrite(std::vector<Stmt *> &statements);
+  void rewrite_branch(Stmt *&branch);
+
+  bool closed_globals;
+  std::deque<Declaration> declarations;
+  std::map<std::string, Declaration *> externals;
+  std::vector<Scope> scopes;
+
+  // Decisions of the current pass, applied by rewrite().
+  std::map<Stmt *, std::string> removed;
+  // Statements whose store is dropped while their value is still evaluated.
+  std::map<Stmt *, std::string> unwrapped;
+  std::map<Var *, std::string> dropped_initializers;
+  size_t changes = 0;
+
+  std::vector<std::string> log;
+};
+
+#endif // OPTIMIZER_H_
@@ -1,5 +1,7 @@
 #include "parser.h"
 #include "lox.h"
+#include "natives.h"
+#include "scanner_thread.h"
 
 bool Parser::match(std::vector<TokenType> types) {
   for (TokenType type : types) {
@@ -24,9 +26,29 @@ Token Parser::advance() {
   return previous();
 }
 
-bool Parser::is_at_end() { return peek().type == EOFL; }
+bool Parser::is_at_end() {
+  return current == end || peek().type == EOFL;
+}
+
+Token Parser::peek() {
+  if (stream != nullptr)
+    pull(current);
+  return tokens->at(current);
+}
 
-Token Parser::peek() { return tokens->at(current); }
+void Parser::pull(int index) {
+  while (stream != nullptr && (int)tokens->size() <= index) {
+    tokens->push_back(stream->pop());
+    if (tokens->back().type != EOFL)
+      continue;
+
+    // The scanner is done, and so are its errors.
+    stream = nullptr;
+    for (auto &held : held_errors)
+      Lox::error(held.first, held.second);
+    held_errors.clear();
+  }
+}
 
 Token Parser::previous() { return tokens->at(current - 1); }
 
@@ -38,7 +60,13 @@ Token Parser::consume(TokenType type, std::string message) {
 }
 
 Parser::ParserError Parser::error(Token token, std::string message) {
-  Lox::error(token, message);
+  errors++;
+  if (scanner_errors != nullptr)
+    scanner_errors->report_errors(token.offset);
+  if (stream != nullptr && scanner_errors == nullptr)
+    held_errors.push_back({token, message});
+  else
+    Lox::error(token, message);
   return ParserError(token.to_string() + message);
 }
 
@@ -51,6 +79,32 @@ std::vector<Stmt *> Parser::parse() {
   return statements;
 }
 
+Stmt *Parser::parse_declaration(int &position) {
+  current = position;
+  Stmt *stmt = declaration();
+  position = current;
+  return stmt;
+}
+
+Stmt *Parser::next_declaration() {
+  // The bodies of lazy blocks refer back to the tokens by index.
+  if (stream != nullptr && current > 0 && !lazy_blocks) {
+    size_t bytes = 0;
+    for (int i = 0; i < current; i++) {
+      const Token &token = (*tokens)[i];
+      bytes += sizeof(Token) + token.lexeme.size();
+      if (auto string = dynamic_cast<LiteralString *>(token.literal.get()))
+        bytes += sizeof(LiteralString) + string->value.size();
+      else if (token.literal != nullptr)
+        bytes += sizeof(LiteralNumber);
+    }
+    tokens->erase(tokens->begin(), tokens->begin() + current);
+    current = 0;
+    Heap::release(HEAP_TOKENS, bytes);
+  }
+  return declaration();
+}
+
 void Parser::synchronize() {
   advance();
 
@@ -62,6 +116,7 @@ void Parser::synchronize() {
     case CLASS:
     case FUN:
     case VAR:
+    case IMPORT:
     case FOR:
     case IF:
     case WHILE:
@@ -77,11 +132,13 @@ void Parser::synchronize() {
 }
 
 // program -> declaration* EOF ;
-// declaration -> varDecl | statement ;
+// declaration -> varDecl | importDecl | statement ;
 Stmt *Parser::declaration() {
   try {
     if (match({VAR}))
       return var_declaration();
+    if (match({IMPORT}))
+      return import_declaration();
     return statement();
   } catch (ParserError error) {
     synchronize();
@@ -99,31 +156,169 @@ Stmt *Parser::var_declaration() {
   }
 
   consume(SEMICOLON, "Expect \';\' after variable declaration.");
-  return new Var(name, initializer);
+  return make<Var>(name, initializer);
+}
+
+// importDecl -> "import" STRING ";" ;
+Stmt *Parser::import_declaration() {
+  Token keyword = previous();
+  Token path = consume(STRING, "Expect module path after 'import'.");
+  consume(SEMICOLON, "Expect ';' after module path.");
+  std::shared_ptr<LiteralString> ls =
+      std::dynamic_pointer_cast<LiteralString>(path.literal);
+  return make<Import>(keyword, ls->value, nullptr);
 }
 
-// statement -> exprStmt | printStmt | block;
+// statement -> exprStmt | forStmt | ifStmt | printStmt | whileStmt | block ;
 Stmt *Parser::statement() {
+  if (match({FOR}))
+    return for_statement();
+  if (match({IF}))
+    return if_statement();
+  if (match({WHILE}))
+    return while_statement();
   if (match({PRINT}))
     return print_statement();
   if (match({LEFT_BRACE}))
-    return new Block(block());
+    return block_statement();
 
   return expression_statement();
 }
 
+// forStmt -> "for" "(" ( varDecl | exprStmt | ";" )
+//            expression? ";" expression? ")" statement ;
+// A for loop becomes a while loop that evaluates the increment after its
+// body, inside a block scoping the initializer.
+Stmt *Parser::for_statement() {
+  Token keyword = previous();
+  consume(LEFT_PAREN, "Expect \'(\' after \'for\'.");
+  Stmt *initializer = nullptr;
+  if (match({VAR}))
+    initializer = var_declaration();
+  else if (!match({SEMICOLON}))
+    initializer = expression_statement();
+
+  // From here on, stmt owns everything parsed.
+  While *loop = make<While>(keyword, nullptr, nullptr, nullptr);
+  Stmt *stmt = loop;
+  if (initializer != nullptr)
+    stmt = make<Block>(std::vector<Stmt *>{initializer, loop}, TokenRange());
+  try {
+    if (!check(SEMICOLON))
+      loop->condition = expression();
+    consume(SEMICOLON, "Expect \';\' after loop condition.");
+    if (!check(RIGHT_PAREN))
+      loop->increment = expression();
+    consume(RIGHT_PAREN, "Expect \')\' after for clauses.");
+    if (loop->condition == nullptr)
+      loop->condition = make<PrimitiveBool>(true);
+    loop->body = statement();
+  } catch (...) {
+    delete stmt;
+    throw;
+  }
+  return stmt;
+}
+
+// ifStmt -> "if" "(" expression ")" statement ( "else" statement )? ;
+Stmt *Parser::if_statement() {
+  Token keyword = previous();
+  consume(LEFT_PAREN, "Expect \'(\' after \'if\'.");
+  If *stmt = make<If>(keyword, expression(), nullptr, nullptr);
+  try {
+    consume(RIGHT_PAREN, "Expect \')\' after if condition.");
+    stmt->then_branch = statement();
+    if (match({ELSE}))
+      stmt->else_branch = statement();
+  } catch (...) {
+    delete stmt;
+    throw;
+  }
+  return stmt;
+}
+
+// whileStmt -> "while" "(" expression ")" statement ;
+Stmt *Parser::while_statement() {
+  Token keyword = previous();
+  consume(LEFT_PAREN, "Expect \'(\' after \'while\'.");
+  While *stmt = make<While>(keyword, expression(), nullptr, nullptr);
+  try {
+    consume(RIGHT_PAREN, "Expect \')\' after condition.");
+    stmt->body = statement();
+  } catch (...) {
+    delete stmt;
+    throw;
+  }
+  return stmt;
+}
+
 // printStmt -> "print" expression ";" ;
 Stmt *Parser::print_statement() {
   Expr *expr = expression();
   consume(SEMICOLON, "Expect \';\' after value.");
-  return new Print(expr);
+  return make<Print>(expr);
 }
 
 // exprStmt -> expression ";" ;
 Stmt *Parser::expression_statement() {
   Expr *expr = expression();
   consume(SEMICOLON, "Expect \';\' after expression.");
-  return new Expression(expr);
+  return make<Expression>(expr);
+}
+
+Stmt *Parser::block_statement() {
+  if (!lazy_blocks)
+    return make<Block>(block(), TokenRange());
+
+  // Skip to the matching brace; the body is parsed on first use.
+  int begin = current;
+  bool imports = false;
+  for (int depth = 0; !is_at_end(); advance()) {
+    if (check(LEFT_BRACE))
+      depth++;
+    else if (check(RIGHT_BRACE) && depth-- == 0)
+      break;
+    imports = imports || check(IMPORT);
+  }
+  if (imports) {
+    // Modules are loaded before the program runs, so every import must be
+    // known up front.
+    current = begin;
+    return make<Block>(block(), TokenRange());
+  }
+  TokenRange body{tokens, begin, current};
+  consume(RIGHT_BRACE, "Expect '}' after block.");
+  if (body.begin == body.end)
+    return make<Block>(std::vector<Stmt *>(), TokenRange());
+
+  if (strict_blocks) {
+    // Report syntax errors now, without keeping the nodes around.
+    size_t charged = Heap::used(HEAP_AST);
+    Parser parser(tokens);
+    parser.current = body.begin;
+    parser.end = body.end;
+    // The body is pulled in already; this only holds its errors back with
+    // ours while the stream is open, to keep them in order.
+    parser.stream = stream;
+    parser.scanner_errors = scanner_errors;
+    for (Stmt *stmt : parser.parse())
+      delete stmt;
+    Heap::release(HEAP_AST, Heap::used(HEAP_AST) - charged);
+    errors += parser.errors;
+    held_errors.insert(held_errors.end(), parser.held_errors.begin(),
+                       parser.held_errors.end());
+  }
+  return make<Block>(std::vector<Stmt *>(), body);
+}
+
+bool Parser::parse_body(const TokenRange &body,
+                        std::vector<Stmt *> &statements) {
+  Parser parser(body.tokens);
+  parser.current = body.begin;
+  parser.end = body.end;
+  parser.lazy_blocks = true;
+  statements = parser.parse();
+  return parser.errors == 0;
 }
 
 // block -> "{" declaration* "}" ;
@@ -138,119 +333,199 @@ std::vector<Stmt *> Parser::block() {
   return statements;
 }
 
-// expression -> assignment ;
-Expr *Parser::expression() { return assignment(); }
-
-// assignment -> IDENTIFIER "=" assignment | equality ;
-Expr *Parser::assignment() {
-  Expr *expr = equality();
-
-  if (match({EQUAL})) {
-    Token equals = previous();
-    Expr *value = assignment();
-
-    if (expr->get_type() == VARIABLE) {
-      Variable *var = dynamic_cast<Variable *>(expr);
-      Token name = var->name;
-      return new Assign(name, value);
-    }
-
-    throw error(equals, "Invalid assignment target");
+// Binding power of the operators on the stack of expression(), loosest first.
+enum Precedence {
+  PREC_NONE, // "(" on the stack, or not an operator.
+  PREC_ASSIGNMENT,
+  PREC_EQUALITY,
+  PREC_COMPARISON,
+  PREC_TERM,
+  PREC_FACTOR,
+  PREC_UNARY,
+};
+
+static int binary_precedence(TokenType type) {
+  switch (type) {
+  case BANG_EQUAL:
+  case EQUAL_EQUAL:
+    return PREC_EQUALITY;
+  case GREATER:
+  case GREATER_EQUAL:
+  case LESS:
+  case LESS_EQUAL:
+    return PREC_COMPARISON;
+  case MINUS:
+  case PLUS:
+    return PREC_TERM;
+  case SLASH:
+  case STAR:
+    return PREC_FACTOR;
+  default:
+    return PREC_NONE;
   }
-
-  return expr;
 }
 
+// expression -> assignment ;
+// assignment -> IDENTIFIER "=" assignment | equality ;
 // equality -> comparison ( ( "!=" | "==" ) comparison )* ;
-Expr *Parser::equality() {
-  Expr *expr = comparison();
-
-  while (match({BANG_EQUAL, EQUAL_EQUAL})) {
-    Token op = previous();
-    Expr *right = comparison();
-    expr = new Binary(expr, op, right);
-  }
-  return expr;
-}
-
 // comparison -> term ( ( ">" | ">=" | "<" | "<=" ) term )* ;
-Expr *Parser::comparison() {
-  Expr *expr = term();
-
-  while (match({GREATER, GREATER_EQUAL, LESS, LESS_EQUAL})) {
-    Token op = previous();
-    Expr *right = term();
-    expr = new Binary(expr, op, right);
-  }
-
-  return expr;
-}
-
 // term -> factor ( ( "-" | "+" ) factor )* ;
-Expr *Parser::term() {
-  Expr *expr = factor();
+// factor -> unary ( ( "/" | "*" ) unary )* ;
+// unary -> ( "!" | "-" ) unary | call ;
+// call -> IDENTIFIER "(" ( expression ( "," expression )* )? ")" | primary ;
+//
+// These rules are parsed with explicit operand and operator stacks instead of
+// one native call per rule and nesting level, so generated expressions with
+// very deep nesting or millions of terms parse in flat native stack.
+Expr *Parser::expression() {
+  std::vector<Expr *> operands;
+  std::vector<PendingOp> ops;
+  int open_parens = 0;
 
-  while (match({MINUS, PLUS})) {
-    Token op = previous();
-    Expr *right = factor();
-    expr = new Binary(expr, op, right);
+  try {
+    while (true) {
+      // Prefix operators, "(" and calls in front of an operand. A call
+      // waits on the operator stack like a "(" while its arguments parse.
+      bool operand = false;
+      while (!operand && match({BANG, MINUS, LEFT_PAREN, IDENTIFIER})) {
+        Token op = previous();
+        if (op.type == IDENTIFIER) {
+          // Just a variable, unless a call.
+          if (!match({LEFT_PAREN})) {
+            operands.push_back(make_expr<Variable>(op));
+            operand = true;
+          } else if (match({RIGHT_PAREN})) {
+            operands.push_back(call({op, PREC_NONE, operands.size()}, operands));
+            operand = true;
+          } else {
+            ops.push_back({op, PREC_NONE, operands.size()});
+            open_parens++;
+          }
+        } else if (op.type == LEFT_PAREN) {
+          ops.push_back({op, PREC_NONE});
+          open_parens++;
+        } else {
+          ops.push_back({op, PREC_UNARY});
+        }
+      }
+      if (!operand)
+        operands.push_back(primary());
+
+      // What may follow an operand: an infix operator, which wants another
+      // operand, a ")" closing a group, or the end of the expression.
+      while (true) {
+        int precedence = binary_precedence(peek().type);
+        if (precedence != PREC_NONE) {
+          // Left associative: first reduce operators binding as tight.
+          reduce(operands, ops, precedence);
+          ops.push_back({advance(), precedence});
+          break;
+        }
+        if (check(EQUAL)) {
+          // Right associative: leave pending assignments on the stack.
+          reduce(operands, ops, PREC_ASSIGNMENT + 1);
+          ops.push_back({advance(), PREC_ASSIGNMENT});
+          break;
+        }
+
+        reduce(operands, ops, PREC_ASSIGNMENT);
+        if (open_parens == 0)
+          return operands.back();
+
+        if (ops.back().op.type == IDENTIFIER) {
+          // The next argument, or the end of the call.
+          if (match({COMMA}))
+            break;
+          consume(RIGHT_PAREN, "Expect \')\' after arguments.");
+          Expr *node = call(ops.back(), operands);
+          ops.pop_back();
+          open_parens--;
+          operands.push_back(node);
+          continue;
+        }
+        consume(RIGHT_PAREN, "Expect \')\' after expression.");
+        ops.pop_back();
+        open_parens--;
+        operands.back() = make_expr<Grouping>(operands.back());
+      }
+    }
+  } catch (...) {
+    Expr::destroy(operands);
+    throw;
   }
-
-  return expr;
 }
 
-// factor -> unary ( ( "/" | "*" ) unary )* ;
-Expr *Parser::factor() {
-  Expr *expr = unary();
+// reduce pops every operator binding at least as tight as precedence, down to
+// the innermost open "(", and replaces its operands by the node it builds.
+void Parser::reduce(std::vector<Expr *> &operands, std::vector<PendingOp> &ops,
+                    int precedence) {
+  while (!ops.empty() && ops.back().precedence != PREC_NONE &&
+         ops.back().precedence >= precedence) {
+    PendingOp pending = ops.back();
+    Expr *right = operands.back();
+    Expr *node;
+
+    if (pending.precedence == PREC_UNARY) {
+      node = make_expr<Unary>(pending.op, right);
+      ops.pop_back();
+      operands.back() = node;
+      continue;
+    }
 
-  while (match({SLASH, STAR})) {
-    Token op = previous();
-    Expr *right = unary();
-    expr = new Binary(expr, op, right);
+    Expr *left = operands[operands.size() - 2];
+    if (pending.precedence == PREC_ASSIGNMENT) {
+      if (left->get_type() != VARIABLE)
+        throw error(pending.op, "Invalid assignment target");
+      node = make<Assign>(dynamic_cast<Variable *>(left)->name, right);
+      Expr::destroy(left);
+    } else {
+      node = make_expr<Binary>(left, pending.op, right);
+    }
+    ops.pop_back();
+    operands.pop_back();
+    operands.back() = node;
   }
-
-  return expr;
 }
 
-// unary -> ( "!" | "-" ) unary | primary ;
-Expr *Parser::unary() {
-  if (match({BANG, MINUS})) {
-    Token op = previous();
-    Expr *right = unary();
-    return new Unary(op, right);
-  }
-
-  return primary();
+// call makes the call expression for open, the native's name waiting on
+// the operator stack, moving its arguments off the end of operands.
+Expr *Parser::call(const PendingOp &open, std::vector<Expr *> &operands) {
+  NativeFunction *native = Natives::find(open.op.lexeme);
+  if (native == nullptr)
+    throw error(open.op, "Undefined function \'" + open.op.lexeme + "\'.");
+  std::vector<Expr *> arguments(operands.begin() + open.operands,
+                                operands.end());
+  if ((int)arguments.size() != native->arity)
+    throw error(previous(), "Expected " + std::to_string(native->arity) +
+                                " arguments but got " +
+                                std::to_string(arguments.size()) + ".");
+  // A call may have effects, so it is never shared.
+  Expr *node = make<Call>(open.op, arguments, native);
+  operands.resize(open.operands);
+  return node;
 }
 
 // primary -> NUMBER | STRING
 //         | "true" | "false" | "nil"
 //         | "(" expression ")"
 //         | IDENTIFIER;
+// The "(" expression ")" form, names and calls are handled by expression().
 Expr *Parser::primary() {
   if (match({FALSE}))
-    return new PrimitiveBool(false);
+    return make_expr<PrimitiveBool>(false);
   if (match({TRUE}))
-    return new PrimitiveBool(true);
+    return make_expr<PrimitiveBool>(true);
   if (match({NIL}))
-    return new PrimitiveNil(nullptr);
+    return make_expr<PrimitiveNil>(nullptr);
   if (match({NUMBER})) {
     std::shared_ptr<LiteralNumber> ln =
         std::dynamic_pointer_cast<LiteralNumber>(previous().literal);
-    return new PrimitiveNumber(ln->value);
+    return make_expr<PrimitiveNumber>(ln->value);
   }
   if (match({STRING})) {
     std::shared_ptr<LiteralString> ls =
         std::dynamic_pointer_cast<LiteralString>(previous().literal);
-    return new PrimitiveString(ls->value);
-  }
-  if (match({LEFT_PAREN})) {
-    Expr *expr = expression();
-    consume(RIGHT_PAREN, "Expect \')\' after expression.");
-    return new Grouping(expr);
-  }
-  if (match({IDENTIFIER})) {
-    return new Variable(previous());
+    return make_expr<PrimitiveString>(ls->value, previous().line);
   }
 
   throw error(peek(), "Expect expression.");
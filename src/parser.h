@@ -3,18 +3,66 @@
 
 #include <memory>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 #include "expr.h"
+#include "expr_sharer.h"
+#include "heap.h"
+#include "scanner.h"
 #include "stmt.h"
 #include "token.h"
 
+class ScannerThread;
+
 class Parser {
 public:
   Parser(std::shared_ptr<std::vector<Token>> tokens)
-      : tokens(tokens), current(0) {}
+      : tokens(tokens), current(0), end(-1) {}
 
   std::vector<Stmt *> parse();
+  // Parses the top-level declaration starting at token index position and
+  // moves position past it. Returns null after a syntax error.
+  Stmt *parse_declaration(int &position);
+  // Parses the next top-level declaration, for a caller running each one
+  // before the next is parsed; see StreamRunner. With stream set and without
+  // lazy_blocks, the tokens of the declarations before are dropped first, so
+  // that only those of one declaration are held at a time. Returns null after
+  // a syntax error.
+  Stmt *next_declaration();
+  // Whether every top-level declaration has been parsed.
+  bool at_end() { return is_at_end(); }
+  // The source offset where the last token parsed starts.
+  int64_t last_offset() { return previous().offset; }
+  int error_count() { return errors; }
+  // The AST nodes made so far.
+  int node_count() { return nodes; }
+  // With share_exprs, the expression nodes replaced by an equal node made
+  // before, and the bytes they would have taken.
+  int shared_count() { return sharer.shared_nodes; }
+  size_t shared_bytes() { return shared_node_bytes; }
+  // Parses the body of a block left unparsed by a lazy parse into
+  // statements. Returns false after reporting a syntax error.
+  static bool parse_body(const TokenRange &body,
+                         std::vector<Stmt *> &statements);
+
+  // Only match the braces of blocks, leaving their bodies to parse_body.
+  bool lazy_blocks = false;
+  // With lazy_blocks, still check the syntax of every body up front.
+  bool strict_blocks = false;
+  // When set, tokens are pulled from this ring into tokens as parsing
+  // reaches them, up to EOF, while another thread still scans the rest.
+  // Syntax errors are held back until EOF arrives, so they are reported
+  // after every scanner error, just as when scanning comes first.
+  TokenRing *stream = nullptr;
+  // When set, the thread scanning stream holds its errors back, and syntax
+  // errors are reported at once instead, each after the scanner errors
+  // before it, for a caller printing as it parses; see StreamRunner.
+  ScannerThread *scanner_errors = nullptr;
+  // Let structurally equal expressions without side effects share one node,
+  // see ExprSharer. Passes rewriting expressions in place, like the Optimizer,
+  // must not run on the resulting tree.
+  bool share_exprs = false;
 
 private:
   class ParserError : public std::runtime_error {
@@ -24,21 +72,40 @@ private:
 
   std::shared_ptr<std::vector<Token>> tokens;
   int current;
+  // The index parsing stops at, or -1 to parse up to EOF.
+  int end;
+  int errors = 0;
+  int nodes = 0;
+  ExprSharer sharer;
+  size_t shared_node_bytes = 0;
+  // Syntax errors held back while stream is still open.
+  std::vector<std::pair<Token, std::string>> held_errors;
+
+  // An operator waiting on the operator stack of expression(). An open "("
+  // or call waits with PREC_NONE; a call holds the name of its native and
+  // the operand count before its first argument.
+  struct PendingOp {
+    Token op;
+    int precedence;
+    size_t operands = 0;
+  };
 
   Expr *expression();
-  Expr *assignment();
-  Expr *equality();
-  Expr *comparison();
-  Expr *term();
-  Expr *factor();
-  Expr *unary();
+  void reduce(std::vector<Expr *> &operands, std::vector<PendingOp> &ops,
+              int precedence);
   Expr *primary();
+  Expr *call(const PendingOp &open, std::vector<Expr *> &operands);
 
   Stmt *statement();
+  Stmt *for_statement();
+  Stmt *if_statement();
+  Stmt *while_statement();
   Stmt *print_statement();
   Stmt *expression_statement();
   Stmt *declaration();
   Stmt *var_declaration();
+  Stmt *import_declaration();
+  Stmt *block_statement();
   std::vector<Stmt *> block();
 
   bool match(std::vector<TokenType> types);
@@ -46,10 +113,33 @@ private:
   Token advance();
   bool is_at_end();
   Token peek();
+  void pull(int index);
   Token previous();
   Token consume(TokenType type, std::string message);
   ParserError error(Token token, std::string message);
   void synchronize();
+
+  // make allocates an AST node and charges it to the heap account.
+  template <typename T, typename... Args> T *make(Args &&...args) {
+    Heap::charge(HEAP_AST, sizeof(T), peek().line);
+    nodes++;
+    return new T(std::forward<Args>(args)...);
+  }
+  // make_expr makes an expression node, which with share_exprs may be an
+  // equal node made before.
+  template <typename T, typename... Args> Expr *make_expr(Args &&...args) {
+    T *node = make<T>(std::forward<Args>(args)...);
+    if (!share_exprs)
+      return node;
+    size_t shared = sharer.shared_nodes;
+    Expr *expr = sharer.share(node);
+    if (sharer.shared_nodes != shared) {
+      Heap::release(HEAP_AST, sizeof(T));
+      nodes--;
+      shared_node_bytes += sizeof(T);
+    }
+    return expr;
+  }
 };
 
 #endif // PARSER_H_
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char *PerfEventString[] = {"cycles", "instructions",
+                                        "branch misses", "L1D misses",
+                                        "LLC misses"};
+
+static perf_event_attr event_attr(PerfEvent event) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.disabled = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  const uint64_t read_miss =
+      PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+  switch (event) {
+  case PERF_CYCLES:
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    break;
+  case PERF_INSTRUCTIONS:
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    break;
+  case PERF_BRANCH_MISSES:
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+    break;
+  case PERF_L1D_MISSES:
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_L1D | read_miss;
+    break;
+  default:
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_LL | read_miss;
+    break;
+  }
+  return attr;
+}
+
+PerfSample &PerfSample::operator+=(const PerfSample &other) {
+  for (int e = 0; e < PERF_EVENTS; e++)
+    counts[e] = counts[e] < 0 || other.counts[e] < 0
+                    ? -1
+                    : counts[e] + other.counts[e];
+  return *this;
+}
+
+void PerfSample::print(std::ostream &out, size_t nodes) const {
+  for (int e = 0; e < PERF_EVENTS; e++) {
+    out << (e == 0 ? "" : ", ") << PerfEventString[e] << "=";
+    if (counts[e] < 0)
+      out << "n/a";
+    else
+      out << counts[e];
+  }
+  if (counts[PERF_CYCLES] > 0 && counts[PERF_INSTRUCTIONS] >= 0)
+    out << ", IPC=" << (double)counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES];
+  if (nodes != 0) {
+    for (int e : {PERF_BRANCH_MISSES, PERF_L1D_MISSES, PERF_LLC_MISSES}) {
+      if (counts[e] >= 0)
+        out << ", " << PerfEventString[e]
+            << "/node=" << (double)counts[e] / nodes;
+    }
+  }
+}
+
+PerfCounters::PerfCounters() {
+  for (int e = 0; e < PERF_EVENTS; e++) {
+    perf_event_attr attr = event_attr((PerfEvent)e);
+    fds[e] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fds[e] < 0 && open_error.empty())
+      open_error = std::string("perf_event_open: ") + strerror(errno);
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (int fd : fds) {
+    if (fd >= 0)
+      close(fd);
+  }
+}
+
+bool PerfCounters::available() const {
+  for (int fd : fds) {
+    if (fd >= 0)
+      return true;
+  }
+  return false;
+}
+
+void PerfCounters::start() {
+  for (int fd : fds) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+PerfSample PerfCounters::stop() {
+  PerfSample sample;
+  for (int e = 0; e < PERF_EVENTS; e++) {
+    if (fds[e] >= 0)
+      ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (int e = 0; e < PERF_EVENTS; e++) {
+    // The count, the time enabled and the time running.
+    uint64_t values[3];
+    if (fds[e] < 0 || read(fds[e], values, sizeof(values)) != sizeof(values)) {
+      sample.counts[e] = -1;
+      continue;
+    }
+    sample.counts[e] = values[2] == 0 ? 0
+                                      : (long long)((double)values[0] *
+                                                    values[1] / values[2]);
+  }
+  return sample;
+}
+
+void PerfPhases::enable() {
+  if (counters == nullptr)
+    counters = new PerfCounters();
+}
+
+void PerfPhases::add(const std::string &phase, const PerfSample &sample) {
+  for (auto &entry : phases) {
+    if (entry.first == phase) {
+      entry.second += sample;
+      return;
+    }
+  }
+  phases.push_back({phase, sample});
+}
+
+void PerfPhases::report(std::ostream &out) {
+  if (counters == nullptr)
+    return;
+  if (!counters->available()) {
+    out << "perf: no hardware counters (" << counters->error() << ")"
+        << std::endl;
+    return;
+  }
+  for (auto &entry : phases) {
+    out << "perf " << entry.first << ": ";
+    entry.second.print(out, nodes);
+    out << std::endl;
+  }
+}
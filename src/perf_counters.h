@@ -0,0 +1,92 @@
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The hardware events PerfCounters counts.
+enum PerfEvent {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_BRANCH_MISSES,
+  PERF_L1D_MISSES,
+  PERF_LLC_MISSES,
+  PERF_EVENTS
+};
+
+// PerfSample holds one count per PerfEvent, or -1 for an event the CPU or
+// the kernel does not provide.
+struct PerfSample {
+  long long counts[PERF_EVENTS] = {};
+
+  PerfSample &operator+=(const PerfSample &other);
+  // Prints the counts with the IPC and, when nodes is not 0, the misses per
+  // node.
+  void print(std::ostream &out, size_t nodes) const;
+};
+
+// PerfCounters counts hardware events of the calling thread, and of the
+// threads it starts, with perf_event_open. Events that cannot be opened,
+// e.g. in most virtual machines, are reported as unavailable.
+class PerfCounters {
+public:
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  // Whether any event could be opened; why not otherwise.
+  bool available() const;
+  const std::string &error() const { return open_error; }
+
+  void start();
+  // The events since start(), scaled up when the kernel had to multiplex
+  // the counters.
+  PerfSample stop();
+
+private:
+  int fds[PERF_EVENTS];
+  std::string open_error;
+};
+
+// PerfPhases sums the counters of the phases of a run for --perf-counters.
+// While it is not enabled, a PerfScope costs one check of a flag.
+class PerfPhases {
+public:
+  static void enable();
+  static bool enabled() { return counters != nullptr; }
+
+  static void add(const std::string &phase, const PerfSample &sample);
+  // The AST nodes the misses are divided by.
+  static void add_nodes(size_t count) { nodes += count; }
+  static void report(std::ostream &out);
+
+private:
+  friend class PerfScope;
+
+  inline static PerfCounters *counters = nullptr;
+  // In the order the phases first ran.
+  inline static std::vector<std::pair<std::string, PerfSample>> phases;
+  inline static size_t nodes = 0;
+};
+
+// PerfScope counts the events from its construction to its destruction as
+// part of phase. Scopes must not nest.
+class PerfScope {
+public:
+  PerfScope(const char *phase) : phase(PerfPhases::enabled() ? phase : nullptr) {
+    if (this->phase != nullptr)
+      PerfPhases::counters->start();
+  }
+  ~PerfScope() {
+    if (phase != nullptr)
+      PerfPhases::add(phase, PerfPhases::counters->stop());
+  }
+
+private:
+  const char *phase;
+};
+
+#endif // PERF_COUNTERS_H_
@@ -0,0 +1,237 @@
+#include "rows.h"
+#include "interpreter.h"
+#include "runtime_error.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <fcntl.h>
+#include <mutex>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// Rows a worker takes at a time: enough to amortize the hand-off, few enough
+// to keep the threads balanced and the buffered output small.
+const size_t CHUNK_ROWS = 256;
+
+// MappedFile maps a whole file read-only.
+class MappedFile {
+public:
+  explicit MappedFile(const char *path) : data(nullptr), size(0), mapped(false) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+      return;
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+      size = st.st_size;
+      if (size == 0) {
+        data = "";
+      } else {
+        void *memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (memory != MAP_FAILED) {
+          data = static_cast<const char *>(memory);
+          mapped = true;
+        }
+      }
+    }
+    close(fd);
+  }
+  ~MappedFile() {
+    if (mapped)
+      munmap(const_cast<char *>(data), size);
+  }
+
+  const char *data;
+  size_t size;
+
+private:
+  bool mapped;
+};
+
+struct Row {
+  const char *begin;
+  const char *end;
+};
+
+// Splits data into lines, except for newlines inside quoted fields. Empty
+// lines are skipped.
+std::vector<Row> split_rows(const char *data, size_t size) {
+  std::vector<Row> rows;
+  const char *begin = data;
+  const char *end = data + size;
+  bool quoted = false;
+  for (const char *c = data; c <= end; c++) {
+    if (c < end && *c == '"')
+      quoted = !quoted;
+    if (c < end && (*c != '\n' || quoted))
+      continue;
+    const char *line_end = c;
+    if (line_end > begin && line_end[-1] == '\r')
+      line_end--;
+    if (line_end > begin)
+      rows.push_back({begin, line_end});
+    begin = c + 1;
+  }
+  return rows;
+}
+
+void split_fields(Row row, char delimiter, std::vector<std::string> &fields) {
+  fields.clear();
+  const char *c = row.begin;
+  while (true) {
+    std::string field;
+    if (c < row.end && *c == '"') {
+      for (c++; c < row.end; c++) {
+        if (*c == '"' && c + 1 < row.end && c[1] == '"')
+          field += *c++;
+        else if (*c == '"')
+          break;
+        else
+          field += *c;
+      }
+      // Skip the closing quote and anything up to the delimiter.
+      while (c < row.end && *c != delimiter)
+        c++;
+    } else {
+      const char *start = c;
+      while (c < row.end && *c != delimiter)
+        c++;
+      field.assign(start, c);
+    }
+    fields.push_back(std::move(field));
+    if (c >= row.end)
+      break;
+    c++;
+  }
+}
+
+// Numbers are written as in Lox, with an optional leading minus.
+bool is_number(const std::string &field) {
+  size_t i = field[0] == '-' ? 1 : 0;
+  size_t digits = i;
+  while (i < field.size() && isdigit(field[i]))
+    i++;
+  if (i == digits)
+    return false;
+  if (i < field.size() && field[i] == '.') {
+    size_t fraction = ++i;
+    while (i < field.size() && isdigit(field[i]))
+      i++;
+    if (i == fraction)
+      return false;
+  }
+  return i == field.size();
+}
+
+ExprValue field_value(const std::string &field) {
+  ExprValue val;
+  if (field.empty()) {
+    val.type = VALNIL;
+  } else if (is_number(field)) {
+    val.type = VALNUMBER;
+    val.number = strtod(field.c_str(), nullptr);
+  } else {
+    val.type = VALSTRING;
+    val.string = field;
+  }
+  return val;
+}
+
+struct Chunk {
+  std::string out;
+  std::string err;
+  size_t failed_rows = 0;
+  bool done = false;
+};
+
+} // namespace
+
+bool RowRunner::run(const char *path, std::ostream &out, std::ostream &err) {
+  MappedFile file(path);
+  if (file.data == nullptr)
+    return false;
+
+  std::vector<Row> lines = split_rows(file.data, file.size);
+  rows = lines.empty() ? 0 : lines.size() - 1;
+  failed_rows = 0;
+  if (rows == 0)
+    return true;
+
+  std::vector<std::string> columns;
+  split_fields(lines[0], delimiter, columns);
+
+  std::vector<Chunk> chunks((rows + CHUNK_ROWS - 1) / CHUNK_ROWS);
+  std::atomic<size_t> next_chunk(0);
+  std::mutex mutex;
+  std::condition_variable chunk_done;
+
+  auto worker = [&]() {
+    Interpreter interpreter;
+    if (jit)
+      interpreter.enable_jit();
+    interpreter.set_budget(budget);
+    std::vector<std::string> fields;
+
+    for (size_t c = next_chunk++; c < chunks.size(); c = next_chunk++) {
+      std::ostringstream chunk_out, chunk_err;
+      size_t failed = 0;
+      interpreter.set_output(chunk_out);
+
+      size_t end = std::min(rows, (c + 1) * CHUNK_ROWS);
+      for (size_t row = c * CHUNK_ROWS; row < end; row++) {
+        split_fields(lines[row + 1], delimiter, fields);
+        try {
+          interpreter.reset_globals();
+          interpreter.restart_budget();
+          for (size_t i = 0; i < columns.size(); i++) {
+            std::string field = i < fields.size() ? fields[i] : "";
+            interpreter.set_global(columns[i], field_value(field));
+          }
+          interpreter.execute_statements(statements);
+        } catch (RuntimeError e) {
+          chunk_err << "[row " << row + 1 << "] [line " << e.op.line
+                    << "] RuntimeError: " << e.what() << std::endl;
+          failed++;
+        }
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      chunks[c].out = chunk_out.str();
+      chunks[c].err = chunk_err.str();
+      chunks[c].failed_rows = failed;
+      chunks[c].done = true;
+      chunk_done.notify_all();
+    }
+    interpreter.release_code();
+  };
+
+  unsigned workers = std::max(1u, std::min<unsigned>(threads, chunks.size()));
+  std::vector<std::thread> pool;
+  for (unsigned i = 0; i < workers; i++)
+    pool.emplace_back(worker);
+
+  // Write each chunk as soon as it and every chunk before it are done.
+  for (Chunk &chunk : chunks) {
+    std::string chunk_out, chunk_err;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      chunk_done.wait(lock, [&]() { return chunk.done; });
+      chunk_out.swap(chunk.out);
+      chunk_err.swap(chunk.err);
+      failed_rows += chunk.failed_rows;
+    }
+    out << chunk_out;
+    err << chunk_err;
+  }
+  out.flush();
+
+  for (std::thread &thread : pool)
+    thread.join();
+  return true;
+}
@@ -0,0 +1,45 @@
+#ifndef ROWS_H_
+#define ROWS_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+#include "stmt.h"
+
+// RowRunner runs one parsed script once per row of a delimited file, which
+// replaces re-running cclox, and re-parsing the script, for every row.
+//
+// The first line of the file names the columns. For each following row every
+// column is defined as a global before the script runs: a number when the
+// field is one, nil when it is empty, and a string otherwise. Fields may be
+// quoted with '"', with "" standing for a quote inside.
+//
+// Rows are handed out in chunks to worker threads, each with its own
+// Interpreter. Every row starts from fresh globals, so rows are independent
+// and the output is written in row order whichever thread ran them.
+class RowRunner {
+public:
+  RowRunner(const std::vector<Stmt *> &statements) : statements(statements) {}
+
+  // Runs the script over the rows of path, writing printed values to out and
+  // runtime errors, tagged with their row, to err. Returns false if the file
+  // cannot be read.
+  bool run(const char *path, std::ostream &out, std::ostream &err);
+
+  unsigned threads = 1;
+  char delimiter = ',';
+  // Give every worker's Interpreter the JIT.
+  bool jit = false;
+  // The budget of every row.
+  Budget budget;
+
+  size_t rows = 0;
+  size_t failed_rows = 0;
+
+private:
+  const std::vector<Stmt *> &statements;
+};
+
+#endif // ROWS_H_
@@ -1,13 +1,16 @@
 #ifndef RUNTIME_ERROR_H_
 #define RUNTIME_ERROR_H_
 
-#include "token_type.h"
+#include "token.h"
 #include <stdexcept>
 
 class RuntimeError : public std::runtime_error {
 public:
   RuntimeError(Token op, const std::string &what_arg)
       : op(op), std::runtime_error(what_arg){};
+  // For errors that are not tied to an operator token, only to a line.
+  RuntimeError(int line, const std::string &what_arg)
+      : op(EOFL, "", nullptr, line), std::runtime_error(what_arg){};
 
   Token op;
 };
@@ -1,11 +1,14 @@
 #include "scanner.h"
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
+#include "heap.h"
 #include "lox.h"
 #include "token.h"
 #include "token_type.h"
+#include "utf8.h"
 
 bool Lox::had_error;
 
@@ -33,9 +36,73 @@ bool Scanner::is_alpha(char c) {
 
 bool Scanner::is_alpha_numeric(char c) { return is_alpha(c) || is_digit(c); }
 
+int Scanner::unicode_identifier(bool start) {
+  if (invalid_length(current) != 0)
+    return 0;
+  int length;
+  IdentifierClass cls =
+      unicode_identifier_class(utf8_decode(&source[current], length));
+  if (cls == ID_START || (cls == ID_CONTINUE && !start))
+    return length;
+  return 0;
+}
+
+void Scanner::check_encoding() {
+  encoding_checked = true;
+  size_t offset = current;
+  while (true) {
+    offset += utf8_error_offset(&source[offset], source.size() - offset);
+    if (offset == source.size())
+      return;
+    // A sequence is the bad byte and the continuation bytes after it, as
+    // many as a code point can take.
+    int length = 1;
+    while (length < 4 && offset + length < source.size() &&
+           (static_cast<unsigned char>(source[offset + length]) & 0xC0) == 0x80)
+      length++;
+    error(offset, "Invalid UTF-8.");
+    invalid.push_back({offset, length});
+    offset += length;
+  }
+}
+
+int Scanner::invalid_length(int64_t offset) {
+  auto found = std::lower_bound(
+      invalid.begin(), invalid.end(), offset,
+      [](const auto &sequence, int64_t at) { return sequence.first < at; });
+  if (found == invalid.end() || found->first != offset)
+    return 0;
+  return found->second;
+}
+
+std::string Scanner::text(int64_t from, int64_t to) {
+  auto found = std::lower_bound(
+      invalid.begin(), invalid.end(), from,
+      [](const auto &sequence, int64_t at) { return sequence.first < at; });
+  if (found == invalid.end() || found->first >= to)
+    return source.substr(from, to - from);
+  std::string text;
+  for (; found != invalid.end() && found->first < to; ++found) {
+    text.append(source, from, found->first - from);
+    text += "\xef\xbf\xbd";
+    from = found->first + found->second;
+  }
+  return text.append(source, from, to - from);
+}
+
 void Scanner::identifier() {
-  while (is_alpha_numeric(peek()))
-    advance();
+  while (true) {
+    if (is_alpha_numeric(peek())) {
+      advance();
+    } else if (static_cast<unsigned char>(peek()) >= 0x80) {
+      int length = unicode_identifier(false);
+      if (length == 0)
+        break;
+      current += length;
+    } else {
+      break;
+    }
+  }
 
   std::string text = source.substr(start, current - start);
   auto mit = keywords.find(text);
@@ -49,7 +116,11 @@ void Scanner::add_token(TokenType type) { add_token(type, nullptr); }
 
 void Scanner::add_token(TokenType type, std::shared_ptr<Literal> literal) {
   std::string text = source.substr(start, current - start);
-  tokens->push_back(Token(type, text, literal, line));
+  // The line of a token is where it ends, e.g. for multi-line strings.
+  int line = line_at(current);
+  Heap::charge(HEAP_TOKENS, sizeof(Token) + text.size(), line);
+  tokens->push_back(Token(type, text, literal, line, start));
+  starts.push_back({start});
 }
 
 bool Scanner::match(char expected) {
@@ -63,13 +134,10 @@ bool Scanner::match(char expected) {
 }
 
 void Scanner::string() {
-  while (peek() != '"' && !is_at_end()) {
-    if (peek() == '\n')
-      line++;
+  while (peek() != '"' && !is_at_end())
     advance();
-  }
   if (is_at_end()) {
-    Lox::error(line, "Unterminated string");
+    error("Unterminated string");
     return;
   }
 
@@ -77,7 +145,9 @@ void Scanner::string() {
   advance();
 
   // Trim the surrounding quotes.
-  std::string value = source.substr(start + 1, current - 1 - (start + 1));
+  std::string value = text(start + 1, current - 1);
+  Heap::charge(HEAP_TOKENS, sizeof(LiteralString) + value.size(),
+               line_at(start));
   add_token(STRING, std::shared_ptr<LiteralString>(new LiteralString(value)));
 }
 
@@ -94,7 +164,8 @@ void Scanner::number() {
       advance();
   }
 
-  double value = std::stod(source.substr(start, current));
+  double value = std::stod(source.substr(start, current - start));
+  Heap::charge(HEAP_TOKENS, sizeof(LiteralNumber), line_at(start));
   add_token(NUMBER, std::shared_ptr<LiteralNumber>(new LiteralNumber(value)));
 }
 
@@ -157,11 +228,8 @@ void Scanner::scan_token() {
   case ' ':
   case '\r':
   case '\t':
-    // Ignore whitespace.
-    break;
-
   case '\n':
-    line++;
+    // Ignore whitespace; lines come from the LineIndex.
     break;
 
   case '"':
@@ -173,19 +241,102 @@ void Scanner::scan_token() {
       number();
     } else if (is_alpha(c)) {
       identifier();
+    } else if (int length = invalid_length(start)) {
+      // Reported by check_encoding already.
+      current = start + length;
+    } else if (static_cast<unsigned char>(c) >= 0x80) {
+      // Whole code points, as the rest of the source is valid UTF-8.
+      current = start;
+      length = unicode_identifier(true);
+      if (length != 0) {
+        current += length;
+        identifier();
+      } else {
+        utf8_decode(&source[start], length);
+        current += length;
+        error("Unexpected character.");
+      }
     } else {
-      Lox::error(line, "Unexpected character.");
+      error("Unexpected character.");
     }
     break;
   }
 }
 
+void Scanner::error(int64_t offset, const std::string &message) {
+  // An encoding error is found before the errors at the offsets before it.
+  int64_t first = first_error_offset.load(std::memory_order_relaxed);
+  if (errors++ == 0 || offset < first)
+    first_error_offset.store(offset, std::memory_order_release);
+  if (hold_errors) {
+    std::lock_guard<std::mutex> lock(held_mutex);
+    auto later = std::upper_bound(
+        held_errors.begin(), held_errors.end(), offset,
+        [](int64_t at, const auto &held) { return at < held.first; });
+    held_errors.insert(later, {offset, message});
+    return;
+  }
+  Lox::report(positions->line(offset), positions->column(offset), "",
+              message);
+}
+
+void Scanner::report_held_errors(int64_t offset) {
+  std::vector<std::pair<int64_t, std::string>> due;
+  {
+    std::lock_guard<std::mutex> lock(held_mutex);
+    auto later = std::lower_bound(
+        held_errors.begin(), held_errors.end(), offset,
+        [](const auto &held, int64_t at) { return held.first < at; });
+    due.assign(held_errors.begin(), later);
+    held_errors.erase(held_errors.begin(), later);
+  }
+  for (auto &[at, message] : due)
+    Lox::report(positions->line(at), positions->column(at), "", message);
+}
+
 std::shared_ptr<std::vector<Token>> Scanner::scanTokens() {
+  if (!encoding_checked)
+    check_encoding();
   while (!is_at_end()) {
     start = current;
     scan_token();
   }
 
-  tokens->push_back(Token(EOFL, "", nullptr, line));
+  int line = line_at(current);
+  tokens->push_back(Token(EOFL, "", nullptr, line, current));
+  starts.push_back({current});
   return tokens;
 }
+
+void Scanner::scan_into(TokenRing &ring) {
+  if (!encoding_checked)
+    check_encoding();
+  while (!is_at_end()) {
+    start = current;
+    scan_token();
+    for (Token &token : *tokens)
+      ring.push(std::move(token));
+    tokens->clear();
+    starts.clear();
+  }
+
+  ring.push(Token(EOFL, "", nullptr, line_at(current), current));
+}
+
+bool Scanner::scan_until(const std::function<bool(int64_t offset)> &sync,
+                         TokenStart &stop) {
+  if (!encoding_checked)
+    check_encoding();
+  while (!is_at_end()) {
+    start = current;
+    size_t scanned = tokens->size();
+    scan_token();
+    if (tokens->size() > scanned && sync(start)) {
+      stop = starts.back();
+      tokens->pop_back();
+      starts.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
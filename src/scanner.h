@@ -1,21 +1,60 @@
 #ifndef SCANNER_H_
 #define SCANNER_H_
 
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "line_index.h"
+#include "spsc_ring.h"
 #include "token.h"
 
+// The tokens handed from a scanning thread to a parsing one.
+typedef SpscRing<Token, 1024> TokenRing;
+
 class Scanner {
 public:
-  Scanner(const std::string &source)
-      : source(source), start(0), current(0), line(1) {
+  Scanner(const std::string &source) : Scanner(source, 0) {}
+  // Starts scanning source at offset, which must be where a token or the
+  // whitespace before one starts.
+  Scanner(const std::string &source, int64_t offset)
+      : source(source), start(offset), current(offset),
+        positions(std::make_shared<LineIndex>(source)) {
     tokens = std::make_shared<std::vector<Token>>();
   }
 
   std::shared_ptr<std::vector<Token>> scanTokens();
+  // Like scanTokens, but pushes each token into ring as soon as it is
+  // scanned instead of keeping them.
+  void scan_into(TokenRing &ring);
+  // Scans until the next token would start at an offset for which sync
+  // returns true, leaving that token unscanned and its start in stop. Returns
+  // false if it reached the end instead, without adding an EOF token.
+  bool scan_until(const std::function<bool(int64_t offset)> &sync,
+                  TokenStart &stop);
+
+  // The tokens scanned so far and where each of them starts.
+  const std::vector<Token> &scanned_tokens() { return *tokens; }
+  const std::vector<TokenStart> &token_starts() { return starts; }
+  int error_count() { return errors; }
+  // The lowest offset of an error reported so far, or -1 if there was none
+  // yet. May be read by another thread while scan_into runs.
+  int64_t first_error() {
+    return first_error_offset.load(std::memory_order_acquire);
+  }
+  // While set, errors are held back instead of reported, for another thread
+  // to report with report_held_errors.
+  bool hold_errors = false;
+  // Reports the held errors at offsets before offset, in offset order. May
+  // be called by another thread while scan_into runs.
+  void report_held_errors(int64_t offset);
+  // The lines and columns of the offsets in source, which stay valid after
+  // the scanner is gone.
+  std::shared_ptr<const LineIndex> line_index() { return positions; }
 
 private:
   bool is_at_end();
@@ -26,27 +65,57 @@ private:
   bool is_digit(char c);
   bool is_alpha(char c);
   bool is_alpha_numeric(char c);
+  // The bytes taken by the non-ASCII code point at current when it may start
+  // an identifier, or with start unset, continue one; otherwise 0.
+  int unicode_identifier(bool start);
+  // Reports each invalid UTF-8 sequence from current on, once, and notes
+  // where it is so that the rest of the scanner skips it and can otherwise
+  // assume valid UTF-8.
+  void check_encoding();
+  // The bytes taken by the invalid sequence at offset, or 0 if none is there.
+  int invalid_length(int64_t offset);
+  // The source from offset from to offset to, with each invalid sequence
+  // replaced by U+FFFD. Lexemes keep the bytes of the source, as their size
+  // is the span they take in it.
+  std::string text(int64_t from, int64_t to);
   void string();
   void number();
   void identifier();
 
   void scan_token();
+  // The line of offset, which mostly grows from one call to the next.
+  int line_at(int64_t offset) { return positions->line(offset, line_hint); }
+  // Reports an error at offset, by default where the current token starts.
+  void error(const std::string &message) { error(start, message); }
+  void error(int64_t offset, const std::string &message);
   void add_token(TokenType type);
   void add_token(TokenType type, std::shared_ptr<Literal> literal);
 
 private:
   std::string source;
   std::shared_ptr<std::vector<Token>> tokens;
-  int start;
-  int current;
-  int line;
+  int64_t start;
+  int64_t current;
+  std::shared_ptr<const LineIndex> positions;
+  size_t line_hint = 0;
+  std::vector<TokenStart> starts;
+  int errors = 0;
+  std::atomic<int64_t> first_error_offset{-1};
+  // The errors held back, by offset, and their message.
+  std::mutex held_mutex;
+  std::vector<std::pair<int64_t, std::string>> held_errors;
+  bool encoding_checked = false;
+  // The offsets of the invalid UTF-8 sequences, in order, and their length.
+  std::vector<std::pair<int64_t, int>> invalid;
 
 private:
   inline static std::map<std::string, TokenType> keywords = {
-      {"and", AND},   {"class", CLASS}, {"else", ELSE},     {"false", FALSE},
-      {"for", FOR},   {"fun", FUN},     {"if", IF},         {"nil", NIL},
-      {"or", OR},     {"print", PRINT}, {"return", RETURN}, {"super", SUPER},
-      {"this", THIS}, {"true", TRUE},   {"var", VAR},       {"while", WHILE},
+      {"and", AND},       {"class", CLASS},   {"else", ELSE},
+      {"false", FALSE},   {"for", FOR},       {"fun", FUN},
+      {"if", IF},         {"import", IMPORT}, {"nil", NIL},
+      {"or", OR},         {"print", PRINT},   {"return", RETURN},
+      {"super", SUPER},   {"this", THIS},     {"true", TRUE},
+      {"var", VAR},       {"while", WHILE},
   };
 };
 
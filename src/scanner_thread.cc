@@ -0,0 +1,37 @@
+#include "scanner_thread.h"
+#include "runtime_error.h"
+#include "trace.h"
+
+ScannerThread::ScannerThread(const std::string &source, bool hold_errors)
+    : scanner(source) {
+  scanner.hold_errors = hold_errors;
+  thread = std::thread([this]() {
+    TraceSpan span("scan");
+    try {
+      scanner.scan_into(ring);
+    } catch (RuntimeError e) {
+      error = std::current_exception();
+      ring.push(Token(EOFL, "", nullptr, e.op.line));
+    }
+    finished.store(true, std::memory_order_release);
+  });
+}
+
+ScannerThread::~ScannerThread() {
+  while (!finished.load(std::memory_order_acquire)) {
+    if (!ring.try_pop())
+      std::this_thread::yield();
+  }
+  if (thread.joinable())
+    thread.join();
+}
+
+void ScannerThread::join() {
+  if (thread.joinable())
+    thread.join();
+  if (error) {
+    std::exception_ptr rethrown = error;
+    error = nullptr;
+    std::rethrow_exception(rethrown);
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef SCANNER_THREAD_H_
+#define SCANNER_THREAD_H_
+
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+
+#include "scanner.h"
+#include "spsc_ring.h"
+#include "token.h"
+
+// ScannerThread scans a source on a thread of its own, handing each token to
+// the consumer through a TokenRing as soon as it is scanned, so that a Parser
+// reading the ring (see Parser::stream) overlaps with the scanning. The ring
+// always ends with an EOF token, also when scanning stopped at a RuntimeError.
+class ScannerThread {
+public:
+  // With hold_errors, scanner errors are held back for report_errors instead
+  // of being printed by the scanning thread, in between whatever the
+  // consumer prints meanwhile.
+  ScannerThread(const std::string &source, bool hold_errors = false);
+  // Drains the tokens left over if the parser stopped early, and waits for
+  // the thread.
+  ~ScannerThread();
+
+  TokenRing &tokens() { return ring; }
+  std::shared_ptr<const LineIndex> line_index() {
+    return scanner.line_index();
+  }
+  // The offset of the first scanner error so far, or -1; see
+  // Scanner::first_error.
+  int64_t first_error() { return scanner.first_error(); }
+  // Reports the held errors at offsets before offset, in offset order, on
+  // the calling thread. All errors before a token popped from the ring have
+  // been found.
+  void report_errors(int64_t offset) { scanner.report_held_errors(offset); }
+  // Waits for the scanner to finish and rethrows the RuntimeError that
+  // stopped it, if any.
+  void join();
+
+private:
+  Scanner scanner;
+  TokenRing ring;
+  std::atomic<bool> finished{false};
+  std::exception_ptr error;
+  std::thread thread;
+};
+
+#endif // SCANNER_THREAD_H_
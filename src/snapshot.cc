@@ -0,0 +1,150 @@
+#include "snapshot.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "environment.h"
+#include "heap.h"
+#include "trace.h"
+
+static const char MAGIC[8] = {'c', 'c', 'l', 'o', 'x', 's', 'n', 'p'};
+static const uint32_t VERSION = 1;
+static_assert(sizeof(Snapshot::Entry) == 32, "entries are read in place");
+
+bool Snapshot::save(const Interpreter &interpreter, const std::string &path,
+                    std::string &error) {
+  TraceSpan span("save snapshot");
+  const auto &globals = interpreter.global_environment().bindings();
+
+  Header header;
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.count = globals.size();
+
+  std::vector<Entry> entries;
+  std::string strings;
+  size_t base = sizeof(Header) + globals.size() * sizeof(Entry);
+  for (auto &global : globals) {
+    const ExprValue &value = global.second;
+    Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.name = base + strings.size();
+    entry.name_length = global.first.size();
+    strings += global.first;
+    entry.type = value.type;
+    entry.number = value.number;
+    entry.boolean = value.boolean;
+    if (value.type == VALSTRING) {
+      entry.string = base + strings.size();
+      entry.string_length = value.string.size();
+      strings += value.string;
+    }
+    entries.push_back(entry);
+  }
+  if (base + strings.size() > UINT32_MAX) {
+    error = "the globals do not fit in a snapshot";
+    return false;
+  }
+  header.bytes = base + strings.size();
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(entries.data()),
+            entries.size() * sizeof(Entry));
+  out.write(strings.data(), strings.size());
+  out.close();
+  if (!out) {
+    error = "could not write the file";
+    return false;
+  }
+  span.count("globals", globals.size());
+  span.count("bytes", header.bytes);
+  return true;
+}
+
+// Checks that the bytes [offset, offset + length) lie within a file of size
+// bytes.
+static bool within(uint64_t offset, uint64_t length, uint64_t bytes) {
+  return offset <= bytes && length <= bytes - offset;
+}
+
+bool Snapshot::load(Interpreter &interpreter, const std::string &path,
+                    std::string &error) {
+  TraceSpan span("load snapshot");
+  error.clear();
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+    close(fd);
+    error = "not a snapshot";
+    return false;
+  }
+  size_t bytes = st.st_size;
+  void *mapped = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    error = strerror(errno);
+    return false;
+  }
+  const char *file = static_cast<const char *>(mapped);
+
+  // Check everything before defining anything.
+  const Header *header = reinterpret_cast<const Header *>(file);
+  const Entry *entries = reinterpret_cast<const Entry *>(file + sizeof(Header));
+  if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+    error = "not a snapshot";
+  else if (header->version != VERSION)
+    error = "snapshot version " + std::to_string(header->version) +
+            " is not supported";
+  else if (header->bytes != bytes ||
+           !within(sizeof(Header), (uint64_t)header->count * sizeof(Entry),
+                   bytes))
+    error = "the snapshot is truncated";
+  for (uint32_t i = 0; error.empty() && i < header->count; i++) {
+    const Entry &entry = entries[i];
+    if (entry.type > VALNIL || !within(entry.name, entry.name_length, bytes) ||
+        (entry.type == VALSTRING &&
+         !within(entry.string, entry.string_length, bytes)))
+      error = "entry " + std::to_string(i) + " of the snapshot is corrupt";
+  }
+  // When the charges of all the globals fit in the heap limit, defining them
+  // cannot fail halfway through; overwriting one charges less than defining.
+  size_t charges = 0;
+  for (uint32_t i = 0; error.empty() && i < header->count; i++) {
+    charges += Environment::entry_bytes(entries[i].name_length);
+    if (entries[i].type == VALSTRING)
+      charges += entries[i].string_length;
+  }
+  if (error.empty() && Heap::get_limit() != 0 &&
+      Heap::total() + charges > Heap::get_limit())
+    error = "its globals take more than the heap limit of " +
+            std::to_string(Heap::get_limit()) + " bytes";
+
+  if (error.empty()) {
+    for (uint32_t i = 0; i < header->count; i++) {
+      const Entry &entry = entries[i];
+      ExprValue value;
+      value.type = (ValueType)entry.type;
+      value.number = entry.number;
+      value.boolean = entry.boolean;
+      if (value.type == VALSTRING)
+        value.string.assign(file + entry.string, entry.string_length);
+      interpreter.set_global(std::string(file + entry.name, entry.name_length),
+                             value);
+    }
+    span.count("globals", header->count);
+    span.count("bytes", bytes);
+  }
+  munmap(mapped, bytes);
+  return error.empty();
+}
@@ -0,0 +1,46 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <cstdint>
+#include <string>
+
+#include "interpreter.h"
+
+// A snapshot holds the globals of an interpreter, so that a long preamble of
+// definitions runs once and later runs start from its result. The file is
+// laid out to be mapped into memory and read in place: a header, one
+// fixed-size entry per global in name order, then the names and strings.
+// Offsets are from the start of the file, in the byte order of the machine
+// that wrote it.
+class Snapshot {
+public:
+  // Writes the globals of interpreter to path. On failure, returns false and
+  // says why in error.
+  static bool save(const Interpreter &interpreter, const std::string &path,
+                   std::string &error);
+  // Defines the globals saved in path in interpreter, overwriting globals of
+  // the same names. On failure, returns false with interpreter unchanged.
+  static bool load(Interpreter &interpreter, const std::string &path,
+                   std::string &error);
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    // The size of the whole file.
+    uint64_t bytes;
+  };
+
+  struct Entry {
+    uint32_t name;
+    uint32_t name_length;
+    uint32_t string;
+    uint32_t string_length;
+    double number;
+    uint8_t type;
+    uint8_t boolean;
+    uint8_t padding[6];
+  };
+};
+
+#endif // SNAPSHOT_H_
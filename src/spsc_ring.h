@@ -0,0 +1,80 @@
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+
+// SpscRing is a bounded queue between exactly one producer thread and one
+// consumer thread, without locks: each side owns one index and publishes it
+// with a release store. Each side also caches the other's index, so most
+// calls touch only its own cache line. A full push and an empty pop wait
+// with yields, which keeps the ring usable on a single core.
+template <typename T, size_t Capacity = 4096> class SpscRing {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+public:
+  SpscRing() = default;
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+  ~SpscRing() {
+    while (try_pop()) {
+    }
+  }
+
+  // Producer side.
+  void push(T &&value) {
+    size_t tail = producer.index.load(std::memory_order_relaxed);
+    while (tail - producer.other >= Capacity) {
+      producer.other = consumer.index.load(std::memory_order_acquire);
+      if (tail - producer.other >= Capacity)
+        std::this_thread::yield();
+    }
+    new (slot(tail)) T(std::move(value));
+    producer.index.store(tail + 1, std::memory_order_release);
+  }
+
+  // Consumer side.
+  T pop() {
+    std::optional<T> value;
+    while (!(value = try_pop()))
+      std::this_thread::yield();
+    return std::move(*value);
+  }
+
+  std::optional<T> try_pop() {
+    size_t head = consumer.index.load(std::memory_order_relaxed);
+    if (head == consumer.other) {
+      consumer.other = producer.index.load(std::memory_order_acquire);
+      if (head == consumer.other)
+        return std::nullopt;
+    }
+    T *item = slot(head);
+    std::optional<T> value(std::move(*item));
+    item->~T();
+    consumer.index.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+private:
+  T *slot(size_t index) {
+    return std::launder(reinterpret_cast<T *>(&slots[index & (Capacity - 1)]));
+  }
+
+  // The index one side advances, and its cached copy of the other side's.
+  struct alignas(64) Side {
+    std::atomic<size_t> index{0};
+    size_t other = 0;
+  };
+
+  Side producer;
+  Side consumer;
+  alignas(64) typename std::aligned_storage<sizeof(T), alignof(T)>::type
+      slots[Capacity];
+};
+
+#endif // SPSC_RING_H_
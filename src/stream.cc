@@ -0,0 +1,65 @@
+#include "stream.h"
+#include "heap.h"
+#include "lox.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner_thread.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+void StreamRunner::run(const std::string &source) {
+  TraceSpan span("stream");
+  std::unique_ptr<ScannerThread> scanner_thread;
+  std::shared_ptr<const LineIndex> positions;
+  try {
+    scanner_thread = std::make_unique<ScannerThread>(source, true);
+    positions = scanner_thread->line_index();
+    Lox::source_positions = positions.get();
+
+    Parser parser(std::make_shared<std::vector<Token>>());
+    parser.stream = &scanner_thread->tokens();
+    parser.scanner_errors = scanner_thread.get();
+    bool running = true;
+    while (!parser.at_end()) {
+      size_t charged = Heap::used(HEAP_AST);
+      std::unique_ptr<Stmt> stmt(parser.next_declaration());
+      size_t ast_bytes = Heap::used(HEAP_AST) - charged;
+      max_ast_bytes = std::max(max_ast_bytes, ast_bytes);
+      declarations++;
+
+      // Scanner errors past the end of the declaration do not stop it. Those
+      // before are reported here, in order with the output.
+      scanner_thread->report_errors(parser.last_offset() + 1);
+      int64_t scan_error = scanner_thread->first_error();
+      running = running && stmt != nullptr && parser.error_count() == 0 &&
+                (scan_error < 0 || scan_error > parser.last_offset());
+      if (running && modules != nullptr)
+        running = modules->load({stmt.get()}, module_directory);
+      if (running) {
+        interpreter.execute_statements({stmt.get()});
+        statements_run++;
+      }
+      interpreter.release_code();
+      stmt.reset();
+      Heap::release(HEAP_AST, ast_bytes);
+    }
+    scanner_thread->join();
+    scanner_thread->report_errors(INT64_MAX);
+  } catch (RuntimeError e) {
+    Lox::runtime_error(e);
+  }
+  Lox::source_positions = nullptr;
+  interpreter.release_code();
+  span.count("declarations", declarations);
+  span.count("max_ast_bytes", max_ast_bytes);
+
+  // Drains the tokens left after a runtime error before the account is
+  // cleared.
+  scanner_thread.reset();
+  Heap::clear(HEAP_AST);
+  Heap::clear(HEAP_TOKENS);
+}
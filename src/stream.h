@@ -0,0 +1,44 @@
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <cstddef>
+#include <string>
+
+#include "interpreter.h"
+#include "modules.h"
+
+// StreamRunner runs a script while it is still being parsed, for generated
+// scripts too large to hold as one AST. Each top-level declaration is parsed,
+// run and freed before the next is parsed, while a ScannerThread scans ahead,
+// so the first output comes as soon as the first statement has run, and the
+// AST and tokens held at any time are those of a single declaration. The
+// source is not streamed: it is held whole, along with the scanner's copy of
+// it and the offsets of its newlines, more than twice its size in all.
+//
+// A statement runs only if no syntax error comes before its end. After one,
+// the rest is still parsed to report every syntax error, but nothing more
+// runs. Syntax errors, the scanner's too, are printed by the running thread
+// as parsing reaches them, in source order, after the output of the
+// statements before them. A runtime error ends the run. The whole-program
+// passes (the optimizer, type inference) and lazy blocks do not apply.
+class StreamRunner {
+public:
+  StreamRunner(Interpreter &interpreter) : interpreter(interpreter) {}
+
+  // Runs source, reporting errors like Lox::run.
+  void run(const std::string &source);
+
+  // Where imports are loaded from, if anywhere; see ModuleCache.
+  ModuleCache *modules = nullptr;
+  std::string module_directory = ".";
+
+  // The declarations parsed and run, and the most AST bytes one of them took.
+  size_t declarations = 0;
+  size_t statements_run = 0;
+  size_t max_ast_bytes = 0;
+
+private:
+  Interpreter &interpreter;
+};
+
+#endif // STREAM_H_
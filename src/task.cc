@@ -0,0 +1,27 @@
+#include "task.h"
+
+Task::Task(const std::vector<Stmt *> &statements)
+    : globals(new Environment()) {
+  push(statements.data(), statements.data() + statements.size(), globals,
+       nullptr);
+}
+
+Task::~Task() {
+  abandon();
+  delete globals;
+}
+
+void Task::push(Stmt *const *begin, Stmt *const *end, Environment *environment,
+                Environment *owned) {
+  frames.push_back({begin, end, environment, owned, nullptr, false});
+}
+
+void Task::pop() {
+  delete frames.back().owned;
+  frames.pop_back();
+}
+
+void Task::abandon() {
+  while (!frames.empty())
+    pop();
+}
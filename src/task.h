@@ -0,0 +1,63 @@
+#ifndef TASK_H_
+#define TASK_H_
+
+#include <set>
+#include <vector>
+
+#include "environment.h"
+#include "stmt.h"
+
+// A Task is a program run that Interpreter::resume() executes a slice at a
+// time, suspending between any two statements, also inside nested blocks
+// and loops. Its position is an explicit stack of frames rather than native
+// calls, and it has globals of its own, so many tasks can be multiplexed on
+// a few interpreters, and a task suspended on one thread can be resumed on
+// another, as long as one thread at a time runs it.
+//
+// An import runs its module into the task's globals in a frame of its own,
+// so it may suspend there too. The statements, and those of the modules,
+// must outlive the task. Blocks left unparsed by a lazy parse are parsed
+// when first reached, so tasks sharing statements must not run concurrently
+// unless those were parsed eagerly.
+class Task {
+public:
+  explicit Task(const std::vector<Stmt *> &statements);
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  ~Task();
+
+  // done reports whether the program ran to its end or raised an error.
+  bool done() const { return frames.empty(); }
+  const Environment &global_environment() const { return *globals; }
+
+private:
+  friend class Interpreter;
+
+  // A list of statements being run, or a loop between two iterations.
+  struct Frame {
+    // The statements still to run.
+    Stmt *const *next;
+    Stmt *const *end;
+    // The environment they run in, and the one the frame made for them,
+    // deleted along with it.
+    Environment *environment;
+    Environment *owned;
+    // For a loop, its statement and whether its first iteration started.
+    // The body runs in a frame of its own on top of this one.
+    While *loop;
+    bool iterating;
+  };
+
+  void push(Stmt *const *begin, Stmt *const *end, Environment *environment,
+            Environment *owned);
+  void pop();
+  // Drops every frame, after a RuntimeError.
+  void abandon();
+
+  Environment *globals;
+  std::vector<Frame> frames;
+  // The modules run into globals.
+  std::set<const Module *> imported;
+};
+
+#endif // TASK_H_
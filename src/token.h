@@ -1,7 +1,10 @@
 #ifndef TOKEN_H_
 #define TOKEN_H_
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "token_type.h"
 
@@ -33,8 +36,9 @@ public:
 class Token {
 public:
   Token(TokenType type, std::string lexeme, std::shared_ptr<Literal> literal,
-        int line)
-      : type(type), lexeme(lexeme), literal(literal), line(line){};
+        int line, int64_t offset = -1)
+      : type(type), lexeme(lexeme), literal(literal), line(line),
+        offset(offset){};
 
   std::string to_string() {
     std::string literal_str;
@@ -49,6 +53,24 @@ public:
   std::string lexeme;
   std::shared_ptr<Literal> literal;
   int line;
+  // The byte offset where the token starts in its source, or -1 for tokens
+  // made up outside of a scanner.
+  int64_t offset;
+};
+
+// TokenStart is the byte offset at which a token starts. The line of the token
+// itself is where it ends; the line it starts on is looked up in the
+// LineIndex of its source where it is needed.
+struct TokenStart {
+  int64_t offset;
+};
+
+// TokenRange is the slice [begin, end) of a token vector, such as the body of
+// a block left unparsed by the parser.
+struct TokenRange {
+  std::shared_ptr<std::vector<Token>> tokens;
+  int begin = 0;
+  int end = 0;
 };
 
 #endif // TOKEN_H_
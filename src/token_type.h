@@ -17,7 +17,7 @@ enum TokenType {
   IDENTIFIER, STRING, NUMBER,
 
   // Keywords.
-  AND, CLASS, ELSE, FALSE, FUN, FOR, IF, NIL, OR,
+  AND, CLASS, ELSE, FALSE, FUN, FOR, IF, IMPORT, NIL, OR,
   PRINT, RETURN ,SUPER, THIS, TRUE, VAR, WHILE,
 
   EOFL
@@ -35,9 +35,10 @@ static const char *TokenTypeString[] = {
     "IDENTIFIER", "STRING",        "NUMBER",
 
     "AND",        "CLASS",         "ELSE",       "FALSE",
-    "FUN",        "FOR",           "IF",         "NIL",
-    "OR",         "PRINT",         "RETURN",     "SUPER",
-    "THIS",       "TRUE",          "VAR",        "WHILE",
+    "FUN",        "FOR",           "IF",         "IMPORT",
+    "NIL",        "OR",            "PRINT",      "RETURN",
+    "SUPER",      "THIS",          "TRUE",       "VAR",
+    "WHILE",
 
     "EOFL"};
 
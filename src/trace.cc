@@ -0,0 +1,90 @@
+#include "trace.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static std::string json_string(const std::string &text) {
+  std::string quoted = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if ((unsigned char)c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      quoted += escaped;
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+bool Trace::start(const std::string &path) {
+  if (!std::ofstream(path).good())
+    return false;
+  Trace::path = path;
+  epoch = std::chrono::steady_clock::now();
+  if (!on)
+    std::atexit(write);
+  on = true;
+  return true;
+}
+
+double Trace::now() {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+void Trace::complete(const std::string &name, const char *category,
+                     double begin, double end,
+                     const std::vector<std::pair<const char *, double>> &args) {
+  int thread = syscall(SYS_gettid);
+  std::lock_guard<std::mutex> lock(mutex);
+  events.push_back({name, category, begin, end, thread, args});
+}
+
+long Trace::peak_rss_kib() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+void Trace::write() {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::ofstream out(path);
+  int process = getpid();
+  out.precision(15);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  for (size_t i = 0; i < events.size(); i++) {
+    const Event &event = events[i];
+    out << (i == 0 ? "\n" : ",\n") << "{\"name\":" << json_string(event.name)
+        << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"ts\":"
+        << event.begin << ",\"dur\":" << event.end - event.begin
+        << ",\"pid\":" << process << ",\"tid\":" << event.thread
+        << ",\"args\":{";
+    for (size_t a = 0; a < event.args.size(); a++)
+      out << (a == 0 ? "" : ",") << "\"" << event.args[a].first
+          << "\":" << event.args[a].second;
+    out << "}}";
+    // The counters of phases also as counter tracks, plotted over time: the
+    // peak RSS as one track, the others per phase.
+    if (strcmp(event.category, "phase") != 0)
+      continue;
+    for (auto &arg : event.args) {
+      std::string track = arg.first;
+      if (track != "peak_rss_kib")
+        track = event.name + " " + track;
+      out << ",\n{\"name\":" << json_string(track)
+          << ",\"ph\":\"C\",\"ts\":" << event.end << ",\"pid\":" << process
+          << ",\"args\":{\"" << arg.first << "\":" << arg.second << "}}";
+    }
+  }
+  out << "\n]}\n";
+}
@@ -0,0 +1,79 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Trace records timed spans of a run and writes them at exit as a JSON trace
+// in the Chrome trace-event format, which Perfetto and chrome://tracing load.
+// While no trace is started, spans cost one check of a flag.
+class Trace {
+public:
+  // Starts recording; the trace is written to path when the process exits.
+  // Returns false if path cannot be written.
+  static bool start(const std::string &path);
+  static bool enabled() { return on; }
+
+  // Microseconds since the trace started.
+  static double now();
+  // Records a span of the calling thread with its counters.
+  static void complete(const std::string &name, const char *category,
+                       double begin, double end,
+                       const std::vector<std::pair<const char *, double>> &args);
+  // The peak resident set size of the process so far.
+  static long peak_rss_kib();
+
+  static void write();
+
+private:
+  struct Event {
+    std::string name;
+    const char *category;
+    double begin;
+    double end;
+    int thread;
+    std::vector<std::pair<const char *, double>> args;
+  };
+
+  inline static bool on = false;
+  inline static std::string path;
+  inline static std::chrono::steady_clock::time_point epoch;
+  inline static std::mutex mutex;
+  inline static std::vector<Event> events;
+};
+
+// TraceSpan records the time from its construction to its destruction as one
+// span, carrying the counters added in between and the peak RSS at its end.
+class TraceSpan {
+public:
+  TraceSpan(std::string name, const char *category = "phase")
+      : active(Trace::enabled()), category(category) {
+    if (active) {
+      this->name = std::move(name);
+      begin = Trace::now();
+    }
+  }
+  ~TraceSpan() {
+    if (!active)
+      return;
+    args.push_back({"peak_rss_kib", (double)Trace::peak_rss_kib()});
+    Trace::complete(name, category, begin, Trace::now(), args);
+  }
+
+  void count(const char *counter, double value) {
+    if (active)
+      args.push_back({counter, value});
+  }
+
+private:
+  bool active;
+  std::string name;
+  const char *category;
+  double begin = 0;
+  std::vector<std::pair<const char *, double>> args;
+};
+
+#endif // TRACE_H_
@@ -0,0 +1,278 @@
+#include "type_inference.h"
+#include "natives.h"
+#include "trace.h"
+
+namespace {
+
+const int UNKNOWN = -1;
+// No value seen yet.
+const int NONE = -2;
+
+int join(int a, int b) {
+  if (a == NONE)
+    return b;
+  if (b == NONE)
+    return a;
+  return a == b ? a : UNKNOWN;
+}
+
+// The type of a successful evaluation of op on operands of types left and
+// right.
+int binary_type(TokenType op, int left, int right) {
+  switch (op) {
+  case MINUS:
+  case SLASH:
+  case STAR:
+    return VALNUMBER;
+  case PLUS:
+    // The other operand must match, or the operator raises.
+    if (left == VALNUMBER || right == VALNUMBER)
+      return VALNUMBER;
+    if (left == VALSTRING || right == VALSTRING)
+      return VALSTRING;
+    return UNKNOWN;
+  default:
+    return VALBOOL;
+  }
+}
+
+} // namespace
+
+void TypeInference::infer(const std::vector<Stmt *> &statements) {
+  TraceSpan span("infer types");
+  int walks = 0;
+  do {
+    changed = false;
+    scopes.assign(1, {});
+    for (Stmt *stmt : statements)
+      stmt->accept(this);
+    walks++;
+  } while (changed);
+
+  annotating = true;
+  scopes.assign(1, {});
+  for (Stmt *stmt : statements)
+    stmt->accept(this);
+  annotating = false;
+  annotated.clear();
+
+  for (auto &entry : declarations) {
+    variables++;
+    number_variables += entry.second.type == VALNUMBER;
+    string_variables += entry.second.type == VALSTRING;
+  }
+  span.count("walks", walks);
+  span.count("specialized", specialized);
+}
+
+void TypeInference::report(std::ostream &out) {
+  out << "types: " << number_variables << " of " << variables
+      << " variables are numbers, " << string_variables << " strings; "
+      << specialized << " of " << operations << " operations specialized"
+      << std::endl;
+}
+
+void TypeInference::visit_ExpressionStmt(Expression *expression) {
+  type_of(expression->expression);
+}
+
+void TypeInference::visit_PrintStmt(Print *print) {
+  type_of(print->expression);
+}
+
+void TypeInference::visit_VarStmt(Var *var) {
+  int type = var->initializer != nullptr ? type_of(var->initializer) : VALNIL;
+  declare(var, type);
+}
+
+void TypeInference::visit_BlockStmt(Block *block) {
+  if (block->body.tokens != nullptr) {
+    escape_all();
+    return;
+  }
+  scopes.push_back({});
+  for (Stmt *stmt : block->statements)
+    stmt->accept(this);
+  scopes.pop_back();
+}
+
+void TypeInference::visit_IfStmt(If *stmt) {
+  type_of(stmt->condition);
+  if (stmt->then_branch != nullptr)
+    stmt->then_branch->accept(this);
+  if (stmt->else_branch != nullptr)
+    stmt->else_branch->accept(this);
+}
+
+void TypeInference::visit_WhileStmt(While *stmt) {
+  type_of(stmt->condition);
+  if (stmt->body != nullptr)
+    stmt->body->accept(this);
+  if (stmt->increment != nullptr)
+    type_of(stmt->increment);
+}
+
+void TypeInference::visit_ImportStmt(Import *) {
+  // The module may store anything to the variables in scope.
+  escape_all();
+}
+
+// type_of walks expr in post-order with explicit stacks, as deeply nested
+// generated expressions would overflow the native stack.
+int TypeInference::type_of(Expr *expr) {
+  struct Work {
+    Expr *expr;
+    bool operands_done;
+  };
+  std::vector<Work> work{{expr, false}};
+  std::vector<int> types;
+
+  while (!work.empty()) {
+    Work w = work.back();
+    work.pop_back();
+    int type;
+    switch (w.expr->get_type()) {
+    case BINARY: {
+      Binary *binary = static_cast<Binary *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({binary, true});
+        work.push_back({binary->right, false});
+        work.push_back({binary->left, false});
+        continue;
+      }
+      int right = types.back();
+      types.pop_back();
+      int left = types.back();
+      types.pop_back();
+      type = binary_type(binary->op.type, left, right);
+      if (annotating && binary->op.type != EQUAL_EQUAL &&
+          binary->op.type != BANG_EQUAL) {
+        operations++;
+        specialized += left == VALNUMBER && right == VALNUMBER;
+      }
+      break;
+    }
+    case UNARY: {
+      Unary *unary = static_cast<Unary *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({unary, true});
+        work.push_back({unary->right, false});
+        continue;
+      }
+      int right = types.back();
+      types.pop_back();
+      type = unary->op.type == MINUS ? VALNUMBER : VALBOOL;
+      if (annotating && unary->op.type == MINUS) {
+        operations++;
+        specialized += right == VALNUMBER;
+      }
+      break;
+    }
+    case GROUPING: {
+      Grouping *grouping = static_cast<Grouping *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({grouping, true});
+        work.push_back({grouping->expression, false});
+        continue;
+      }
+      type = types.back();
+      types.pop_back();
+      break;
+    }
+    case ASSIGN: {
+      Assign *assign = static_cast<Assign *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({assign, true});
+        work.push_back({assign->value, false});
+        continue;
+      }
+      type = types.back();
+      types.pop_back();
+      store(resolve(assign->name.lexeme), type);
+      break;
+    }
+    case CALL: {
+      Call *call = static_cast<Call *>(w.expr);
+      if (!w.operands_done) {
+        work.push_back({call, true});
+        for (auto it = call->arguments.rbegin(); it != call->arguments.rend();
+             ++it)
+          work.push_back({*it, false});
+        continue;
+      }
+      types.resize(types.size() - call->arguments.size());
+      // The binding of the native knows its C++ result type.
+      type = call->native->result_type;
+      break;
+    }
+    case VARIABLE:
+      type = resolve(static_cast<Variable *>(w.expr)->name.lexeme)->type;
+      break;
+    case PRIMITIVENUMBER:
+      type = VALNUMBER;
+      break;
+    case PRIMITIVESTRING:
+      type = VALSTRING;
+      break;
+    case PRIMITIVEBOOL:
+      type = VALBOOL;
+      break;
+    default:
+      type = VALNIL;
+      break;
+    }
+    if (annotating)
+      annotate(w.expr, type);
+    types.push_back(type);
+  }
+  return types.back();
+}
+
+void TypeInference::annotate(Expr *expr, int type) {
+  if (type == NONE)
+    type = UNKNOWN;
+  if (annotated.insert(expr).second)
+    expr->static_type = type;
+  else if (expr->static_type != type)
+    expr->static_type = UNKNOWN;
+}
+
+void TypeInference::declare(Var *var, int type) {
+  auto &scope = scopes.back();
+  auto found = scope.find(var->name.lexeme);
+  Declaration *declaration;
+  if (found != scope.end()) {
+    // Environment::define keeps the first definition, and which one that is
+    // is not tracked, so the two are joined.
+    declaration = found->second;
+  } else {
+    declaration = &declarations.emplace(var, Declaration{NONE}).first->second;
+    scope[var->name.lexeme] = declaration;
+  }
+  store(declaration, type);
+  if (scopes.size() == 1 && !closed_globals)
+    store(declaration, UNKNOWN);
+}
+
+TypeInference::Declaration *TypeInference::resolve(const std::string &name) {
+  for (auto scope = scopes.rbegin(); scope != scopes.rend(); scope++) {
+    auto found = scope->find(name);
+    if (found != scope->end())
+      return found->second;
+  }
+  return &unknown;
+}
+
+void TypeInference::store(Declaration *declaration, int type) {
+  int joined = join(declaration->type, type);
+  if (joined != declaration->type) {
+    declaration->type = joined;
+    changed = true;
+  }
+}
+
+void TypeInference::escape_all() {
+  for (auto &scope : scopes)
+    for (auto &entry : scope)
+      store(entry.second, UNKNOWN);
+}
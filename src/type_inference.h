@@ -0,0 +1,81 @@
+#ifndef TYPE_INFERENCE_H_
+#define TYPE_INFERENCE_H_
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "expr.h"
+#include "stmt.h"
+
+// TypeInference proves which variables only ever hold numbers, or only
+// strings, and sets Expr::static_type on every expression whose value it
+// knows. The interpreter evaluates expressions proven to be numbers as raw
+// doubles, reads and writes their variables' numbers in place and skips
+// check_number_operands for them; everything else takes the dynamic path.
+//
+// A variable's type joins every value stored to it, wherever in its scope,
+// and the walk repeats until no type changes, so loops need no special
+// care. Reads resolve names the way the Environment chain does at that
+// point: to the innermost declaration already made. A block left unparsed
+// by a lazy parse may store anything to the variables in scope, and so may
+// whatever ran before, unless closed_globals, into globals.
+class TypeInference : public StmtVisitor {
+public:
+  // closed_globals means the program starts from empty globals, as when
+  // running a file. Otherwise, as in the REPL, nothing is known of globals.
+  TypeInference(bool closed_globals) : closed_globals(closed_globals) {}
+
+  virtual void visit_ExpressionStmt(Expression *expression);
+  virtual void visit_PrintStmt(Print *print);
+  virtual void visit_VarStmt(Var *var);
+  virtual void visit_BlockStmt(Block *block);
+  virtual void visit_IfStmt(If *stmt);
+  virtual void visit_WhileStmt(While *stmt);
+  virtual void visit_ImportStmt(Import *stmt);
+
+  void infer(const std::vector<Stmt *> &statements);
+  // Writes how many variables and operations were specialized.
+  void report(std::ostream &out);
+
+  // Declared variables, and those proven to hold numbers or strings.
+  size_t variables = 0;
+  size_t number_variables = 0;
+  size_t string_variables = 0;
+  // Operators checking the types of their operands, and those whose
+  // operands are proven numbers, which skip the checks.
+  size_t operations = 0;
+  size_t specialized = 0;
+
+private:
+  struct Declaration {
+    // A ValueType, -1 when unknown, or -2 before any store.
+    int type;
+  };
+
+  int type_of(Expr *expr);
+  void annotate(Expr *expr, int type);
+  void declare(Var *var, int type);
+  Declaration *resolve(const std::string &name);
+  void store(Declaration *declaration, int type);
+  void escape_all();
+
+  bool closed_globals;
+  // Declarations by the statement making them, which stays the same from
+  // one walk to the next.
+  std::map<Var *, Declaration> declarations;
+  // Names not declared by the program, or read before their declaration.
+  Declaration unknown{-1};
+  std::vector<std::map<std::string, Declaration *>> scopes;
+  bool changed = false;
+
+  // Set on the last walk, which annotates the tree.
+  bool annotating = false;
+  // Nodes annotated so far; a node shared by several parents is typed by
+  // the join over all of them.
+  std::set<Expr *> annotated;
+};
+
+#endif // TYPE_INFERENCE_H_
@@ -0,0 +1,305 @@
+// Auto generated by tool/generate_unicode.py from Unicode 14.0.0, don't
+// modify manually.
+#include "utf8.h"
+
+// Each entry (first << 2) | class starts a run of code points of one
+// IdentifierClass, which lasts up to the next entry.
+const uint32_t unicode_identifier_runs[] = {
+    0x0000200, 0x00002aa, 0x00002ac, 0x00002d6, 0x00002d8, 0x00002ea,
+    0x00002ec, 0x0000302, 0x000035c, 0x0000362, 0x00003dc, 0x00003e2,
+    0x0000b08, 0x0000b1a, 0x0000b48, 0x0000b82, 0x0000b94, 0x0000bb2,
+    0x0000bb4, 0x0000bba, 0x0000bbc, 0x0000c01, 0x0000dc2, 0x0000dd4,
+    0x0000dda, 0x0000de0, 0x0000dea, 0x0000df8, 0x0000dfe, 0x0000e00,
+    0x0000e1a, 0x0000e1c, 0x0000e22, 0x0000e2c, 0x0000e32, 0x0000e34,
+    0x0000e3a, 0x0000e88, 0x0000e8e, 0x0000fd8, 0x0000fde, 0x0001208,
+    0x000120d, 0x0001220, 0x000122a, 0x00014c0, 0x00014c6, 0x000155c,
+    0x0001566, 0x0001568, 0x0001582, 0x0001624, 0x0001645, 0x00016f8,
+    0x00016fd, 0x0001700, 0x0001705, 0x000170c, 0x0001711, 0x0001718,
+    0x000171d, 0x0001720, 0x0001742, 0x00017ac, 0x00017be, 0x00017cc,
+    0x0001841, 0x000186c, 0x0001882, 0x000192d, 0x00019a8, 0x00019ba,
+    0x00019c1, 0x00019c6, 0x0001b50, 0x0001b56, 0x0001b59, 0x0001b74,
+    0x0001b7d, 0x0001b96, 0x0001b9d, 0x0001ba4, 0x0001ba9, 0x0001bba,
+    0x0001bc1, 0x0001bea, 0x0001bf4, 0x0001bfe, 0x0001c00, 0x0001c42,
+    0x0001c45, 0x0001c4a, 0x0001cc1, 0x0001d2c, 0x0001d36, 0x0001e99,
+    0x0001ec6, 0x0001ec8, 0x0001f01, 0x0001f2a, 0x0001fad, 0x0001fd2,
+    0x0001fd8, 0x0001fea, 0x0001fec, 0x0001ff5, 0x0001ff8, 0x0002002,
+    0x0002059, 0x000206a, 0x000206d, 0x0002092, 0x0002095, 0x00020a2,
+    0x00020a5, 0x00020b8, 0x0002102, 0x0002165, 0x0002170, 0x0002182,
+    0x00021ac, 0x00021c2, 0x0002220, 0x0002226, 0x000223c, 0x0002261,
+    0x0002282, 0x0002329, 0x0002388, 0x000238d, 0x0002412, 0x00024e9,
+    0x00024f6, 0x00024f9, 0x0002542, 0x0002545, 0x0002562, 0x0002589,
+    0x0002590, 0x0002599, 0x00025c0, 0x00025c6, 0x0002605, 0x0002610,
+    0x0002616, 0x0002634, 0x000263e, 0x0002644, 0x000264e, 0x00026a4,
+    0x00026aa, 0x00026c4, 0x00026ca, 0x00026cc, 0x00026da, 0x00026e8,
+    0x00026f1, 0x00026f6, 0x00026f9, 0x0002714, 0x000271d, 0x0002724,
+    0x000272d, 0x000273a, 0x000273c, 0x000275d, 0x0002760, 0x0002772,
+    0x0002778, 0x000277e, 0x0002789, 0x0002790, 0x0002799, 0x00027c2,
+    0x00027c8, 0x00027f2, 0x00027f4, 0x00027f9, 0x00027fc, 0x0002805,
+    0x0002810, 0x0002816, 0x000282c, 0x000283e, 0x0002844, 0x000284e,
+    0x00028a4, 0x00028aa, 0x00028c4, 0x00028ca, 0x00028d0, 0x00028d6,
+    0x00028dc, 0x00028e2, 0x00028e8, 0x00028f1, 0x00028f4, 0x00028f9,
+    0x000290c, 0x000291d, 0x0002924, 0x000292d, 0x0002938, 0x0002945,
+    0x0002948, 0x0002966, 0x0002974, 0x000297a, 0x000297c, 0x0002999,
+    0x00029ca, 0x00029d5, 0x00029d8, 0x0002a05, 0x0002a10, 0x0002a16,
+    0x0002a38, 0x0002a3e, 0x0002a48, 0x0002a4e, 0x0002aa4, 0x0002aaa,
+    0x0002ac4, 0x0002aca, 0x0002ad0, 0x0002ad6, 0x0002ae8, 0x0002af1,
+    0x0002af6, 0x0002af9, 0x0002b18, 0x0002b1d, 0x0002b28, 0x0002b2d,
+    0x0002b38, 0x0002b42, 0x0002b44, 0x0002b82, 0x0002b89, 0x0002b90,
+    0x0002b99, 0x0002bc0, 0x0002be6, 0x0002be9, 0x0002c00, 0x0002c05,
+    0x0002c10, 0x0002c16, 0x0002c34, 0x0002c3e, 0x0002c44, 0x0002c4e,
+    0x0002ca4, 0x0002caa, 0x0002cc4, 0x0002cca, 0x0002cd0, 0x0002cd6,
+    0x0002ce8, 0x0002cf1, 0x0002cf6, 0x0002cf9, 0x0002d14, 0x0002d1d,
+    0x0002d24, 0x0002d2d, 0x0002d38, 0x0002d55, 0x0002d60, 0x0002d72,
+    0x0002d78, 0x0002d7e, 0x0002d89, 0x0002d90, 0x0002d99, 0x0002dc0,
+    0x0002dc6, 0x0002dc8, 0x0002e09, 0x0002e0e, 0x0002e10, 0x0002e16,
+    0x0002e2c, 0x0002e3a, 0x0002e44, 0x0002e4a, 0x0002e58, 0x0002e66,
+    0x0002e6c, 0x0002e72, 0x0002e74, 0x0002e7a, 0x0002e80, 0x0002e8e,
+    0x0002e94, 0x0002ea2, 0x0002eac, 0x0002eba, 0x0002ee8, 0x0002ef9,
+    0x0002f0c, 0x0002f19, 0x0002f24, 0x0002f29, 0x0002f38, 0x0002f42,
+    0x0002f44, 0x0002f5d, 0x0002f60, 0x0002f99, 0x0002fc0, 0x0003001,
+    0x0003016, 0x0003034, 0x000303a, 0x0003044, 0x000304a, 0x00030a4,
+    0x00030aa, 0x00030e8, 0x00030f1, 0x00030f6, 0x00030f9, 0x0003114,
+    0x0003119, 0x0003124, 0x0003129, 0x0003138, 0x0003155, 0x000315c,
+    0x0003162, 0x000316c, 0x0003176, 0x0003178, 0x0003182, 0x0003189,
+    0x0003190, 0x0003199, 0x00031c0, 0x0003202, 0x0003205, 0x0003210,
+    0x0003216, 0x0003234, 0x000323a, 0x0003244, 0x000324a, 0x00032a4,
+    0x00032aa, 0x00032d0, 0x00032d6, 0x00032e8, 0x00032f1, 0x00032f6,
+    0x00032f9, 0x0003314, 0x0003319, 0x0003324, 0x0003329, 0x0003338,
+    0x0003355, 0x000335c, 0x0003376, 0x000337c, 0x0003382, 0x0003389,
+    0x0003390, 0x0003399, 0x00033c0, 0x00033c6, 0x00033cc, 0x0003401,
+    0x0003412, 0x0003434, 0x000343a, 0x0003444, 0x000344a, 0x00034ed,
+    0x00034f6, 0x00034f9, 0x0003514, 0x0003519, 0x0003524, 0x0003529,
+    0x000353a, 0x000353c, 0x0003552, 0x000355d, 0x0003560, 0x000357e,
+    0x0003589, 0x0003590, 0x0003599, 0x00035c0, 0x00035ea, 0x0003600,
+    0x0003605, 0x0003610, 0x0003616, 0x000365c, 0x000366a, 0x00036c8,
+    0x00036ce, 0x00036f0, 0x00036f6, 0x00036f8, 0x0003702, 0x000371c,
+    0x0003729, 0x000372c, 0x000373d, 0x0003754, 0x0003759, 0x000375c,
+    0x0003761, 0x0003780, 0x0003799, 0x00037c0, 0x00037c9, 0x00037d0,
+    0x0003806, 0x00038c5, 0x00038ca, 0x00038d1, 0x00038ec, 0x0003902,
+    0x000391d, 0x000393c, 0x0003941, 0x0003968, 0x0003a06, 0x0003a0c,
+    0x0003a12, 0x0003a14, 0x0003a1a, 0x0003a2c, 0x0003a32, 0x0003a90,
+    0x0003a96, 0x0003a98, 0x0003a9e, 0x0003ac5, 0x0003aca, 0x0003ad1,
+    0x0003af6, 0x0003af8, 0x0003b02, 0x0003b14, 0x0003b1a, 0x0003b1c,
+    0x0003b21, 0x0003b38, 0x0003b41, 0x0003b68, 0x0003b72, 0x0003b80,
+    0x0003c02, 0x0003c04, 0x0003c61, 0x0003c68, 0x0003c81, 0x0003ca8,
+    0x0003cd5, 0x0003cd8, 0x0003cdd, 0x0003ce0, 0x0003ce5, 0x0003ce8,
+    0x0003cf9, 0x0003d02, 0x0003d20, 0x0003d26, 0x0003db4, 0x0003dc5,
+    0x0003e14, 0x0003e19, 0x0003e22, 0x0003e35, 0x0003e60, 0x0003e65,
+    0x0003ef4, 0x0003f19, 0x0003f1c, 0x0004002, 0x00040ad, 0x00040fe,
+    0x0004101, 0x0004128, 0x0004142, 0x0004159, 0x000416a, 0x0004179,
+    0x0004186, 0x0004189, 0x0004196, 0x000419d, 0x00041ba, 0x00041c5,
+    0x00041d6, 0x0004209, 0x000423a, 0x000423d, 0x0004278, 0x0004282,
+    0x0004318, 0x000431e, 0x0004320, 0x0004336, 0x0004338, 0x0004342,
+    0x00043ec, 0x00043f2, 0x0004924, 0x000492a, 0x0004938, 0x0004942,
+    0x000495c, 0x0004962, 0x0004964, 0x000496a, 0x0004978, 0x0004982,
+    0x0004a24, 0x0004a2a, 0x0004a38, 0x0004a42, 0x0004ac4, 0x0004aca,
+    0x0004ad8, 0x0004ae2, 0x0004afc, 0x0004b02, 0x0004b04, 0x0004b0a,
+    0x0004b18, 0x0004b22, 0x0004b5c, 0x0004b62, 0x0004c44, 0x0004c4a,
+    0x0004c58, 0x0004c62, 0x0004d6c, 0x0004d75, 0x0004d80, 0x0004e02,
+    0x0004e40, 0x0004e82, 0x0004fd8, 0x0004fe2, 0x0004ff8, 0x0005006,
+    0x00059b4, 0x00059be, 0x0005a00, 0x0005a06, 0x0005a6c, 0x0005a82,
+    0x0005bac, 0x0005bba, 0x0005be4, 0x0005c02, 0x0005c49, 0x0005c58,
+    0x0005c7e, 0x0005cc9, 0x0005cd4, 0x0005d02, 0x0005d49, 0x0005d50,
+    0x0005d82, 0x0005db4, 0x0005dba, 0x0005dc4, 0x0005dc9, 0x0005dd0,
+    0x0005e02, 0x0005ed1, 0x0005f50, 0x0005f5e, 0x0005f60, 0x0005f72,
+    0x0005f75, 0x0005f78, 0x0005f81, 0x0005fa8, 0x000602d, 0x0006038,
+    0x000603d, 0x0006068, 0x0006082, 0x00061e4, 0x0006202, 0x0006215,
+    0x000621e, 0x00062a5, 0x00062aa, 0x00062ac, 0x00062c2, 0x00063d8,
+    0x0006402, 0x000647c, 0x0006481, 0x00064b0, 0x00064c1, 0x00064f0,
+    0x0006519, 0x0006542, 0x00065b8, 0x00065c2, 0x00065d4, 0x0006602,
+    0x00066b0, 0x00066c2, 0x0006728, 0x0006741, 0x0006768, 0x0006802,
+    0x000685d, 0x0006870, 0x0006882, 0x0006955, 0x000697c, 0x0006981,
+    0x00069f4, 0x00069fd, 0x0006a28, 0x0006a41, 0x0006a68, 0x0006a9e,
+    0x0006aa0, 0x0006ac1, 0x0006af8, 0x0006afd, 0x0006b3c, 0x0006c01,
+    0x0006c16, 0x0006cd1, 0x0006d16, 0x0006d34, 0x0006d41, 0x0006d68,
+    0x0006dad, 0x0006dd0, 0x0006e01, 0x0006e0e, 0x0006e85, 0x0006eba,
+    0x0006ec1, 0x0006eea, 0x0006f99, 0x0006fd0, 0x0007002, 0x0007091,
+    0x00070e0, 0x0007101, 0x0007128, 0x0007136, 0x0007141, 0x000716a,
+    0x00071f8, 0x0007202, 0x0007224, 0x0007242, 0x00072ec, 0x00072f6,
+    0x0007300, 0x0007341, 0x000734c, 0x0007351, 0x00073a6, 0x00073b5,
+    0x00073ba, 0x00073d1, 0x00073d6, 0x00073dd, 0x00073ea, 0x00073ec,
+    0x0007402, 0x0007701, 0x0007802, 0x0007c58, 0x0007c62, 0x0007c78,
+    0x0007c82, 0x0007d18, 0x0007d22, 0x0007d38, 0x0007d42, 0x0007d60,
+    0x0007d66, 0x0007d68, 0x0007d6e, 0x0007d70, 0x0007d76, 0x0007d78,
+    0x0007d7e, 0x0007df8, 0x0007e02, 0x0007ed4, 0x0007eda, 0x0007ef4,
+    0x0007efa, 0x0007efc, 0x0007f0a, 0x0007f14, 0x0007f1a, 0x0007f34,
+    0x0007f42, 0x0007f50, 0x0007f5a, 0x0007f70, 0x0007f82, 0x0007fb4,
+    0x0007fca, 0x0007fd4, 0x0007fda, 0x0007ff4, 0x00080fd, 0x0008104,
+    0x0008151, 0x0008154, 0x00081c6, 0x00081c8, 0x00081fe, 0x0008200,
+    0x0008242, 0x0008274, 0x0008341, 0x0008374, 0x0008385, 0x0008388,
+    0x0008395, 0x00083c4, 0x000840a, 0x000840c, 0x000841e, 0x0008420,
+    0x000842a, 0x0008450, 0x0008456, 0x0008458, 0x0008466, 0x0008478,
+    0x0008492, 0x0008494, 0x000849a, 0x000849c, 0x00084a2, 0x00084a4,
+    0x00084aa, 0x00084b8, 0x00084be, 0x00084e8, 0x00084f2, 0x0008500,
+    0x0008516, 0x0008528, 0x000853a, 0x000853c, 0x0008582, 0x0008624,
+    0x000b002, 0x000b394, 0x000b3ae, 0x000b3bd, 0x000b3ca, 0x000b3d0,
+    0x000b402, 0x000b498, 0x000b49e, 0x000b4a0, 0x000b4b6, 0x000b4b8,
+    0x000b4c2, 0x000b5a0, 0x000b5be, 0x000b5c0, 0x000b5fd, 0x000b602,
+    0x000b65c, 0x000b682, 0x000b69c, 0x000b6a2, 0x000b6bc, 0x000b6c2,
+    0x000b6dc, 0x000b6e2, 0x000b6fc, 0x000b702, 0x000b71c, 0x000b722,
+    0x000b73c, 0x000b742, 0x000b75c, 0x000b762, 0x000b77c, 0x000b781,
+    0x000b800, 0x000b8be, 0x000b8c0, 0x000c016, 0x000c020, 0x000c086,
+    0x000c0a9, 0x000c0c0, 0x000c0c6, 0x000c0d8, 0x000c0e2, 0x000c0f4,
+    0x000c106, 0x000c25c, 0x000c265, 0x000c26c, 0x000c276, 0x000c280,
+    0x000c286, 0x000c3ec, 0x000c3f2, 0x000c400, 0x000c416, 0x000c4c0,
+    0x000c4c6, 0x000c63c, 0x000c682, 0x000c700, 0x000c7c2, 0x000c800,
+    0x000d002, 0x0013700, 0x0013802, 0x0029234, 0x0029342, 0x00293f8,
+    0x0029402, 0x0029834, 0x0029842, 0x0029881, 0x00298aa, 0x00298b0,
+    0x0029902, 0x00299bd, 0x00299c0, 0x00299d1, 0x00299f8, 0x00299fe,
+    0x0029a79, 0x0029a82, 0x0029bc1, 0x0029bc8, 0x0029c5e, 0x0029c80,
+    0x0029c8a, 0x0029e24, 0x0029e2e, 0x0029f2c, 0x0029f42, 0x0029f48,
+    0x0029f4e, 0x0029f50, 0x0029f56, 0x0029f68, 0x0029fca, 0x002a009,
+    0x002a00e, 0x002a019, 0x002a01e, 0x002a02d, 0x002a032, 0x002a08d,
+    0x002a0a0, 0x002a0b1, 0x002a0b4, 0x002a102, 0x002a1d0, 0x002a201,
+    0x002a20a, 0x002a2d1, 0x002a318, 0x002a341, 0x002a368, 0x002a381,
+    0x002a3ca, 0x002a3e0, 0x002a3ee, 0x002a3f0, 0x002a3f6, 0x002a3fd,
+    0x002a42a, 0x002a499, 0x002a4b8, 0x002a4c2, 0x002a51d, 0x002a550,
+    0x002a582, 0x002a5f4, 0x002a601, 0x002a612, 0x002a6cd, 0x002a704,
+    0x002a73e, 0x002a741, 0x002a768, 0x002a782, 0x002a795, 0x002a79a,
+    0x002a7c1, 0x002a7ea, 0x002a7fc, 0x002a802, 0x002a8a5, 0x002a8dc,
+    0x002a902, 0x002a90d, 0x002a912, 0x002a931, 0x002a938, 0x002a941,
+    0x002a968, 0x002a982, 0x002a9dc, 0x002a9ea, 0x002a9ed, 0x002a9fa,
+    0x002aac1, 0x002aac6, 0x002aac9, 0x002aad6, 0x002aadd, 0x002aae6,
+    0x002aaf9, 0x002ab02, 0x002ab05, 0x002ab0a, 0x002ab0c, 0x002ab6e,
+    0x002ab78, 0x002ab82, 0x002abad, 0x002abc0, 0x002abca, 0x002abd5,
+    0x002abdc, 0x002ac06, 0x002ac1c, 0x002ac26, 0x002ac3c, 0x002ac46,
+    0x002ac5c, 0x002ac82, 0x002ac9c, 0x002aca2, 0x002acbc, 0x002acc2,
+    0x002ad6c, 0x002ad72, 0x002ada8, 0x002adc2, 0x002af8d, 0x002afac,
+    0x002afb1, 0x002afb8, 0x002afc1, 0x002afe8, 0x002b002, 0x0035e90,
+    0x0035ec2, 0x0035f1c, 0x0035f2e, 0x0035ff0, 0x003e402, 0x003e9b8,
+    0x003e9c2, 0x003eb68, 0x003ec02, 0x003ec1c, 0x003ec4e, 0x003ec60,
+    0x003ec76, 0x003ec79, 0x003ec7e, 0x003eca4, 0x003ecaa, 0x003ecdc,
+    0x003ece2, 0x003ecf4, 0x003ecfa, 0x003ecfc, 0x003ed02, 0x003ed08,
+    0x003ed0e, 0x003ed14, 0x003ed1a, 0x003eec8, 0x003ef4e, 0x003f4f8,
+    0x003f542, 0x003f640, 0x003f64a, 0x003f720, 0x003f7c2, 0x003f7f0,
+    0x003f801, 0x003f840, 0x003f881, 0x003f8c0, 0x003f8cd, 0x003f8d4,
+    0x003f935, 0x003f940, 0x003f9c2, 0x003f9d4, 0x003f9da, 0x003fbf4,
+    0x003fc41, 0x003fc68, 0x003fc86, 0x003fcec, 0x003fcfd, 0x003fd00,
+    0x003fd06, 0x003fd6c, 0x003fd9a, 0x003fefc, 0x003ff0a, 0x003ff20,
+    0x003ff2a, 0x003ff40, 0x003ff4a, 0x003ff60, 0x003ff6a, 0x003ff74,
+    0x0040002, 0x0040030, 0x0040036, 0x004009c, 0x00400a2, 0x00400ec,
+    0x00400f2, 0x00400f8, 0x00400fe, 0x0040138, 0x0040142, 0x0040178,
+    0x0040202, 0x00403ec, 0x0040502, 0x00405d4, 0x00407f5, 0x00407f8,
+    0x0040a02, 0x0040a74, 0x0040a82, 0x0040b44, 0x0040b81, 0x0040b84,
+    0x0040c02, 0x0040c80, 0x0040cb6, 0x0040d2c, 0x0040d42, 0x0040dd9,
+    0x0040dec, 0x0040e02, 0x0040e78, 0x0040e82, 0x0040f10, 0x0040f22,
+    0x0040f40, 0x0040f46, 0x0040f58, 0x0041002, 0x0041278, 0x0041281,
+    0x00412a8, 0x00412c2, 0x0041350, 0x0041362, 0x00413f0, 0x0041402,
+    0x00414a0, 0x00414c2, 0x0041590, 0x00415c2, 0x00415ec, 0x00415f2,
+    0x004162c, 0x0041632, 0x004164c, 0x0041652, 0x0041658, 0x004165e,
+    0x0041688, 0x004168e, 0x00416c8, 0x00416ce, 0x00416e8, 0x00416ee,
+    0x00416f4, 0x0041802, 0x0041cdc, 0x0041d02, 0x0041d58, 0x0041d82,
+    0x0041da0, 0x0041e02, 0x0041e18, 0x0041e1e, 0x0041ec4, 0x0041eca,
+    0x0041eec, 0x0042002, 0x0042018, 0x0042022, 0x0042024, 0x004202a,
+    0x00420d8, 0x00420de, 0x00420e4, 0x00420f2, 0x00420f4, 0x00420fe,
+    0x0042158, 0x0042182, 0x00421dc, 0x0042202, 0x004227c, 0x0042382,
+    0x00423cc, 0x00423d2, 0x00423d8, 0x0042402, 0x0042458, 0x0042482,
+    0x00424e8, 0x0042602, 0x00426e0, 0x00426fa, 0x0042700, 0x0042802,
+    0x0042805, 0x0042810, 0x0042815, 0x004281c, 0x0042831, 0x0042842,
+    0x0042850, 0x0042856, 0x0042860, 0x0042866, 0x00428d8, 0x00428e1,
+    0x00428ec, 0x00428fd, 0x0042900, 0x0042982, 0x00429f4, 0x0042a02,
+    0x0042a74, 0x0042b02, 0x0042b20, 0x0042b26, 0x0042b95, 0x0042b9c,
+    0x0042c02, 0x0042cd8, 0x0042d02, 0x0042d58, 0x0042d82, 0x0042dcc,
+    0x0042e02, 0x0042e48, 0x0043002, 0x0043124, 0x0043202, 0x00432cc,
+    0x0043302, 0x00433cc, 0x0043402, 0x0043491, 0x00434a0, 0x00434c1,
+    0x00434e8, 0x0043a02, 0x0043aa8, 0x0043aad, 0x0043ab4, 0x0043ac2,
+    0x0043ac8, 0x0043c02, 0x0043c74, 0x0043c9e, 0x0043ca0, 0x0043cc2,
+    0x0043d19, 0x0043d44, 0x0043dc2, 0x0043e09, 0x0043e18, 0x0043ec2,
+    0x0043f14, 0x0043f82, 0x0043fdc, 0x0044001, 0x004400e, 0x00440e1,
+    0x004411c, 0x0044199, 0x00441c6, 0x00441cd, 0x00441d6, 0x00441d8,
+    0x00441fd, 0x004420e, 0x00442c1, 0x00442ec, 0x0044309, 0x004430c,
+    0x0044342, 0x00443a4, 0x00443c1, 0x00443e8, 0x0044401, 0x004440e,
+    0x004449d, 0x00444d4, 0x00444d9, 0x0044500, 0x0044512, 0x0044515,
+    0x004451e, 0x0044520, 0x0044542, 0x00445cd, 0x00445d0, 0x00445da,
+    0x00445dc, 0x0044601, 0x004460e, 0x00446cd, 0x0044706, 0x0044714,
+    0x0044725, 0x0044734, 0x0044739, 0x004476a, 0x004476c, 0x0044772,
+    0x0044774, 0x0044802, 0x0044848, 0x004484e, 0x00448b1, 0x00448e0,
+    0x00448f9, 0x00448fc, 0x0044a02, 0x0044a1c, 0x0044a22, 0x0044a24,
+    0x0044a2a, 0x0044a38, 0x0044a3e, 0x0044a78, 0x0044a7e, 0x0044aa4,
+    0x0044ac2, 0x0044b7d, 0x0044bac, 0x0044bc1, 0x0044be8, 0x0044c01,
+    0x0044c10, 0x0044c16, 0x0044c34, 0x0044c3e, 0x0044c44, 0x0044c4e,
+    0x0044ca4, 0x0044caa, 0x0044cc4, 0x0044cca, 0x0044cd0, 0x0044cd6,
+    0x0044ce8, 0x0044ced, 0x0044cf6, 0x0044cf9, 0x0044d14, 0x0044d1d,
+    0x0044d24, 0x0044d2d, 0x0044d38, 0x0044d42, 0x0044d44, 0x0044d5d,
+    0x0044d60, 0x0044d76, 0x0044d89, 0x0044d90, 0x0044d99, 0x0044db4,
+    0x0044dc1, 0x0044dd4, 0x0045002, 0x00450d5, 0x004511e, 0x004512c,
+    0x0045141, 0x0045168, 0x0045179, 0x004517e, 0x0045188, 0x0045202,
+    0x00452c1, 0x0045312, 0x0045318, 0x004531e, 0x0045320, 0x0045341,
+    0x0045368, 0x0045602, 0x00456bd, 0x00456d8, 0x00456e1, 0x0045704,
+    0x0045762, 0x0045771, 0x0045778, 0x0045802, 0x00458c1, 0x0045904,
+    0x0045912, 0x0045914, 0x0045941, 0x0045968, 0x0045a02, 0x0045aad,
+    0x0045ae2, 0x0045ae4, 0x0045b01, 0x0045b28, 0x0045c02, 0x0045c6c,
+    0x0045c75, 0x0045cb0, 0x0045cc1, 0x0045ce8, 0x0045d02, 0x0045d1c,
+    0x0046002, 0x00460b1, 0x00460ec, 0x0046282, 0x0046381, 0x00463a8,
+    0x00463fe, 0x004641c, 0x0046426, 0x0046428, 0x0046432, 0x0046450,
+    0x0046456, 0x004645c, 0x0046462, 0x00464c1, 0x00464d8, 0x00464dd,
+    0x00464e4, 0x00464ed, 0x00464fe, 0x0046501, 0x0046506, 0x0046509,
+    0x0046510, 0x0046541, 0x0046568, 0x0046682, 0x00466a0, 0x00466aa,
+    0x0046745, 0x0046760, 0x0046769, 0x0046786, 0x0046788, 0x004678e,
+    0x0046791, 0x0046794, 0x0046802, 0x0046805, 0x004682e, 0x00468cd,
+    0x00468ea, 0x00468ed, 0x00468fc, 0x004691d, 0x0046920, 0x0046942,
+    0x0046945, 0x0046972, 0x0046a29, 0x0046a68, 0x0046a76, 0x0046a78,
+    0x0046ac2, 0x0046be4, 0x0047002, 0x0047024, 0x004702a, 0x00470bd,
+    0x00470dc, 0x00470e1, 0x0047102, 0x0047104, 0x0047141, 0x0047168,
+    0x00471ca, 0x0047240, 0x0047249, 0x00472a0, 0x00472a5, 0x00472dc,
+    0x0047402, 0x004741c, 0x0047422, 0x0047428, 0x004742e, 0x00474c5,
+    0x00474dc, 0x00474e9, 0x00474ec, 0x00474f1, 0x00474f8, 0x00474fd,
+    0x004751a, 0x004751d, 0x0047520, 0x0047541, 0x0047568, 0x0047582,
+    0x0047598, 0x004759e, 0x00475a4, 0x00475aa, 0x0047629, 0x004763c,
+    0x0047641, 0x0047648, 0x004764d, 0x0047662, 0x0047664, 0x0047681,
+    0x00476a8, 0x0047b82, 0x0047bcd, 0x0047bdc, 0x0047ec2, 0x0047ec4,
+    0x0048002, 0x0048e68, 0x0049002, 0x00491bc, 0x0049202, 0x0049510,
+    0x004be42, 0x004bfc4, 0x004c002, 0x004d0bc, 0x0051002, 0x005191c,
+    0x005a002, 0x005a8e4, 0x005a902, 0x005a97c, 0x005a981, 0x005a9a8,
+    0x005a9c2, 0x005aafc, 0x005ab01, 0x005ab28, 0x005ab42, 0x005abb8,
+    0x005abc1, 0x005abd4, 0x005ac02, 0x005acc1, 0x005acdc, 0x005ad02,
+    0x005ad10, 0x005ad41, 0x005ad68, 0x005ad8e, 0x005ade0, 0x005adf6,
+    0x005ae40, 0x005b902, 0x005ba00, 0x005bc02, 0x005bd2c, 0x005bd3d,
+    0x005bd42, 0x005bd45, 0x005be20, 0x005be3d, 0x005be4e, 0x005be80,
+    0x005bf82, 0x005bf88, 0x005bf8e, 0x005bf91, 0x005bf94, 0x005bfc1,
+    0x005bfc8, 0x005c002, 0x0061fe0, 0x0062002, 0x0063358, 0x0063402,
+    0x0063424, 0x006bfc2, 0x006bfd0, 0x006bfd6, 0x006bff0, 0x006bff6,
+    0x006bffc, 0x006c002, 0x006c48c, 0x006c542, 0x006c54c, 0x006c592,
+    0x006c5a0, 0x006c5c2, 0x006cbf0, 0x006f002, 0x006f1ac, 0x006f1c2,
+    0x006f1f4, 0x006f202, 0x006f224, 0x006f242, 0x006f268, 0x006f275,
+    0x006f27c, 0x0073c01, 0x0073cb8, 0x0073cc1, 0x0073d1c, 0x0074595,
+    0x00745a8, 0x00745b5, 0x00745cc, 0x00745ed, 0x007460c, 0x0074615,
+    0x0074630, 0x00746a9, 0x00746b8, 0x0074909, 0x0074914, 0x0075002,
+    0x0075154, 0x007515a, 0x0075274, 0x007527a, 0x0075280, 0x007528a,
+    0x007528c, 0x0075296, 0x007529c, 0x00752a6, 0x00752b4, 0x00752ba,
+    0x00752e8, 0x00752ee, 0x00752f0, 0x00752f6, 0x0075310, 0x0075316,
+    0x0075418, 0x007541e, 0x007542c, 0x0075436, 0x0075454, 0x007545a,
+    0x0075474, 0x007547a, 0x00754e8, 0x00754ee, 0x00754fc, 0x0075502,
+    0x0075514, 0x007551a, 0x007551c, 0x007552a, 0x0075544, 0x007554a,
+    0x0075a98, 0x0075aa2, 0x0075b04, 0x0075b0a, 0x0075b6c, 0x0075b72,
+    0x0075bec, 0x0075bf2, 0x0075c54, 0x0075c5a, 0x0075cd4, 0x0075cda,
+    0x0075d3c, 0x0075d42, 0x0075dbc, 0x0075dc2, 0x0075e24, 0x0075e2a,
+    0x0075ea4, 0x0075eaa, 0x0075f0c, 0x0075f12, 0x0075f30, 0x0075f39,
+    0x0076000, 0x0076801, 0x00768dc, 0x00768ed, 0x00769b4, 0x00769d5,
+    0x00769d8, 0x0076a11, 0x0076a14, 0x0076a6d, 0x0076a80, 0x0076a85,
+    0x0076ac0, 0x0077c02, 0x0077c7c, 0x0078001, 0x007801c, 0x0078021,
+    0x0078064, 0x007806d, 0x0078088, 0x007808d, 0x0078094, 0x0078099,
+    0x00780ac, 0x0078402, 0x00784b4, 0x00784c1, 0x00784de, 0x00784f8,
+    0x0078501, 0x0078528, 0x007853a, 0x007853c, 0x0078a42, 0x0078ab9,
+    0x0078abc, 0x0078b02, 0x0078bb1, 0x0078be8, 0x0079f82, 0x0079f9c,
+    0x0079fa2, 0x0079fb0, 0x0079fb6, 0x0079fbc, 0x0079fc2, 0x0079ffc,
+    0x007a002, 0x007a314, 0x007a341, 0x007a35c, 0x007a402, 0x007a511,
+    0x007a52e, 0x007a530, 0x007a541, 0x007a568, 0x007b802, 0x007b810,
+    0x007b816, 0x007b880, 0x007b886, 0x007b88c, 0x007b892, 0x007b894,
+    0x007b89e, 0x007b8a0, 0x007b8a6, 0x007b8cc, 0x007b8d2, 0x007b8e0,
+    0x007b8e6, 0x007b8e8, 0x007b8ee, 0x007b8f0, 0x007b90a, 0x007b90c,
+    0x007b91e, 0x007b920, 0x007b926, 0x007b928, 0x007b92e, 0x007b930,
+    0x007b936, 0x007b940, 0x007b946, 0x007b94c, 0x007b952, 0x007b954,
+    0x007b95e, 0x007b960, 0x007b966, 0x007b968, 0x007b96e, 0x007b970,
+    0x007b976, 0x007b978, 0x007b97e, 0x007b980, 0x007b986, 0x007b98c,
+    0x007b992, 0x007b994, 0x007b99e, 0x007b9ac, 0x007b9b2, 0x007b9cc,
+    0x007b9d2, 0x007b9e0, 0x007b9e6, 0x007b9f4, 0x007b9fa, 0x007b9fc,
+    0x007ba02, 0x007ba28, 0x007ba2e, 0x007ba70, 0x007ba86, 0x007ba90,
+    0x007ba96, 0x007baa8, 0x007baae, 0x007baf0, 0x007efc1, 0x007efe8,
+    0x0080002, 0x00a9b80, 0x00a9c02, 0x00adce4, 0x00add02, 0x00ae078,
+    0x00ae082, 0x00b3a88, 0x00b3ac2, 0x00baf84, 0x00be002, 0x00be878,
+    0x00c0002, 0x00c4d2c, 0x0380401, 0x03807c0,
+};
+
+const size_t unicode_identifier_run_count =
+    sizeof(unicode_identifier_runs) / sizeof(unicode_identifier_runs[0]);
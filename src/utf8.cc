@@ -0,0 +1,213 @@
+#include "utf8.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define UTF8_SSSE3
+#endif
+
+size_t utf8_error_offset_scalar(const char *data, size_t size) {
+  const unsigned char *s = reinterpret_cast<const unsigned char *>(data);
+  size_t i = 0;
+  while (i < size) {
+    if (i + 8 <= size) {
+      uint64_t word;
+      memcpy(&word, s + i, 8);
+      if ((word & 0x8080808080808080) == 0) {
+        i += 8;
+        continue;
+      }
+    }
+    unsigned char c = s[i];
+    if (c < 0x80) {
+      i++;
+      continue;
+    }
+    size_t length;
+    uint32_t cp, min;
+    if ((c & 0xE0) == 0xC0) {
+      length = 2, cp = c & 0x1F, min = 0x80;
+    } else if ((c & 0xF0) == 0xE0) {
+      length = 3, cp = c & 0x0F, min = 0x800;
+    } else if ((c & 0xF8) == 0xF0) {
+      length = 4, cp = c & 0x07, min = 0x10000;
+    } else {
+      return i;
+    }
+    if (size - i < length)
+      return i;
+    for (size_t k = 1; k < length; k++) {
+      if ((s[i + k] & 0xC0) != 0x80)
+        return i;
+      cp = cp << 6 | (s[i + k] & 0x3F);
+    }
+    if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+      return i;
+    i += length;
+  }
+  return size;
+}
+
+#ifdef UTF8_SSSE3
+namespace {
+
+// The errors a pair of adjacent bytes may show, one bit each. A pair is
+// invalid when the bits looked up for the high and low nibble of the first
+// byte and the high nibble of the second have one in common.
+enum : uint8_t {
+  TOO_SHORT = 1 << 0,  // A lead or ASCII byte after a lead byte.
+  TOO_LONG = 1 << 1,   // A continuation byte after an ASCII byte.
+  OVERLONG_3 = 1 << 2, // E0 80..9F
+  TOO_LARGE = 1 << 3,  // F4 90..BF, or F5..FF
+  SURROGATE = 1 << 4,  // ED A0..BF
+  OVERLONG_2 = 1 << 5, // C0..C1
+  TOO_LARGE_1000 = 1 << 6,
+  OVERLONG_4 = 1 << 6, // F0 80..8F
+  // A continuation byte after a continuation byte, valid only as the third
+  // or fourth byte of a sequence, which is checked separately.
+  TWO_CONTS = 1 << 7,
+  CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS,
+};
+
+alignas(16) const uint8_t first_high[16] = {
+    // 0___ ASCII.
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG,
+    // 10__ continuation.
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    // 1100, 1101 two byte leads.
+    TOO_SHORT | OVERLONG_2, TOO_SHORT,
+    // 1110 three byte lead.
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    // 1111 four byte lead.
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4};
+
+alignas(16) const uint8_t first_low[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000};
+
+alignas(16) const uint8_t second_high[16] = {
+    // 0___ ASCII.
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT,
+    // 1000 continuation.
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+        OVERLONG_4,
+    // 1001 continuation.
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    // 101_ continuation.
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    // 11__ lead.
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT};
+
+// The largest byte each of the last three positions of a block may hold
+// without starting a sequence that runs past the block.
+alignas(16) const uint8_t last_max[16] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF};
+
+struct State {
+  __m128i error;
+  __m128i previous;
+  // Nonzero while the previous block ends inside a sequence.
+  __m128i incomplete;
+};
+
+__attribute__((target("ssse3"))) inline __m128i
+lookup(const uint8_t *table, __m128i nibbles) {
+  return _mm_shuffle_epi8(
+      _mm_load_si128(reinterpret_cast<const __m128i *>(table)), nibbles);
+}
+
+__attribute__((target("ssse3"))) inline void check_block(State &state,
+                                                         __m128i input) {
+  if (_mm_movemask_epi8(input) == 0) {
+    // ASCII only: valid unless the previous block left a sequence open.
+    state.error = _mm_or_si128(state.error, state.incomplete);
+    state.previous = input;
+    return;
+  }
+  const __m128i low_nibble = _mm_set1_epi8(0x0F);
+  __m128i prev1 = _mm_alignr_epi8(input, state.previous, 15);
+  __m128i special = _mm_and_si128(
+      _mm_and_si128(
+          lookup(first_high,
+                 _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble)),
+          lookup(first_low, _mm_and_si128(prev1, low_nibble))),
+      lookup(second_high,
+             _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble)));
+  // Two continuations in a row are only right as the third byte after a
+  // three or four byte lead, or the fourth after a four byte lead.
+  __m128i prev2 = _mm_alignr_epi8(input, state.previous, 14);
+  __m128i prev3 = _mm_alignr_epi8(input, state.previous, 13);
+  __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80)));
+  __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80)));
+  __m128i must_continue = _mm_and_si128(_mm_or_si128(third, fourth),
+                                        _mm_set1_epi8(char(0x80)));
+  state.error =
+      _mm_or_si128(state.error, _mm_xor_si128(must_continue, special));
+  state.incomplete = _mm_subs_epu8(
+      input, _mm_load_si128(reinterpret_cast<const __m128i *>(last_max)));
+  state.previous = input;
+}
+
+__attribute__((target("ssse3"))) bool valid_ssse3(const char *data,
+                                                  size_t size) {
+  State state{_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    check_block(state, _mm_loadu_si128(
+                           reinterpret_cast<const __m128i *>(data + i)));
+  }
+  if (i < size) {
+    // The padding is ASCII, so a sequence cut off by the end shows up as
+    // one followed by ASCII.
+    alignas(16) char tail[16] = {};
+    memcpy(tail, data + i, size - i);
+    check_block(state, _mm_load_si128(reinterpret_cast<const __m128i *>(tail)));
+  }
+  state.error = _mm_or_si128(state.error, state.incomplete);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(state.error, _mm_setzero_si128())) ==
+         0xFFFF;
+}
+
+const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+
+} // namespace
+#endif
+
+size_t utf8_error_offset(const char *data, size_t size) {
+#ifdef UTF8_SSSE3
+  if (has_ssse3 && valid_ssse3(data, size))
+    return size;
+#endif
+  return utf8_error_offset_scalar(data, size);
+}
+
+IdentifierClass unicode_identifier_class(uint32_t cp) {
+  const uint32_t *end =
+      unicode_identifier_runs + unicode_identifier_run_count;
+  // The last run starting at or before cp.
+  const uint32_t *run =
+      std::upper_bound(unicode_identifier_runs, end, cp << 2 | 3);
+  if (run == unicode_identifier_runs)
+    return ID_NONE;
+  return IdentifierClass(run[-1] & 3);
+}
@@ -0,0 +1,52 @@
+#ifndef UTF8_H_
+#define UTF8_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Returns the offset of the first byte of data that does not start a valid
+// UTF-8 sequence, or size when all of it is valid UTF-8. Overlong forms,
+// surrogates and code points past U+10FFFF are invalid.
+//
+// Where the CPU has SSSE3, data is checked 16 bytes at a time with table
+// lookups on the high and low nibbles of each byte and its predecessors,
+// which validates every sequence in the block at once; blocks of ASCII only
+// take a single comparison. The byte-at-a-time check then only runs to find
+// the offset of an error.
+size_t utf8_error_offset(const char *data, size_t size);
+// The byte-at-a-time check, which skips runs of ASCII 8 bytes at a time.
+size_t utf8_error_offset_scalar(const char *data, size_t size);
+
+// Decodes the code point starting at s, which must be valid UTF-8, and sets
+// length to the bytes it takes.
+inline uint32_t utf8_decode(const char *s, int &length) {
+  const unsigned char *u = reinterpret_cast<const unsigned char *>(s);
+  if (u[0] < 0x80) {
+    length = 1;
+    return u[0];
+  }
+  if (u[0] < 0xE0) {
+    length = 2;
+    return (u[0] & 0x1F) << 6 | (u[1] & 0x3F);
+  }
+  if (u[0] < 0xF0) {
+    length = 3;
+    return (u[0] & 0x0F) << 12 | (u[1] & 0x3F) << 6 | (u[2] & 0x3F);
+  }
+  length = 4;
+  return (u[0] & 0x07) << 18 | (u[1] & 0x3F) << 12 | (u[2] & 0x3F) << 6 |
+         (u[3] & 0x3F);
+}
+
+// Whether a code point may start an identifier, only continue one, or
+// neither; see tool/generate_unicode.py.
+enum IdentifierClass { ID_NONE, ID_CONTINUE, ID_START };
+
+extern const uint32_t unicode_identifier_runs[];
+extern const size_t unicode_identifier_run_count;
+
+// The class of the non-ASCII code point cp, by a binary search of the runs
+// of code points sharing a class.
+IdentifierClass unicode_identifier_class(uint32_t cp);
+
+#endif // UTF8_H_
@@ -0,0 +1,347 @@
+#include "watch.h"
+#include "lox.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+
+bool starts_before(const TokenStart &start, int64_t offset) {
+  return start.offset < offset;
+}
+
+// Moves every token in stmt down by shift lines.
+void shift_lines(Stmt *root, int shift) {
+  std::vector<Stmt *> stmts{root};
+  std::vector<Expr *> exprs;
+  while (!stmts.empty()) {
+    Stmt *stmt = stmts.back();
+    stmts.pop_back();
+    if (Var *var = dynamic_cast<Var *>(stmt)) {
+      var->name.line += shift;
+      if (var->initializer != nullptr)
+        exprs.push_back(var->initializer);
+    } else if (Expression *expression = dynamic_cast<Expression *>(stmt)) {
+      exprs.push_back(expression->expression);
+    } else if (Print *print = dynamic_cast<Print *>(stmt)) {
+      exprs.push_back(print->expression);
+    } else if (Block *block = dynamic_cast<Block *>(stmt)) {
+      stmts.insert(stmts.end(), block->statements.begin(),
+                   block->statements.end());
+    } else if (If *branch = dynamic_cast<If *>(stmt)) {
+      branch->keyword.line += shift;
+      exprs.push_back(branch->condition);
+      for (Stmt *s : {branch->then_branch, branch->else_branch}) {
+        if (s != nullptr)
+          stmts.push_back(s);
+      }
+    } else if (While *loop = dynamic_cast<While *>(stmt)) {
+      loop->keyword.line += shift;
+      exprs.push_back(loop->condition);
+      if (loop->increment != nullptr)
+        exprs.push_back(loop->increment);
+      if (loop->body != nullptr)
+        stmts.push_back(loop->body);
+    } else if (Import *import = dynamic_cast<Import *>(stmt)) {
+      import->keyword.line += shift;
+    }
+  }
+
+  while (!exprs.empty()) {
+    Expr *expr = exprs.back();
+    exprs.pop_back();
+    switch (expr->get_type()) {
+    case ASSIGN:
+      static_cast<Assign *>(expr)->name.line += shift;
+      exprs.push_back(static_cast<Assign *>(expr)->value);
+      break;
+    case BINARY:
+      static_cast<Binary *>(expr)->op.line += shift;
+      exprs.push_back(static_cast<Binary *>(expr)->left);
+      exprs.push_back(static_cast<Binary *>(expr)->right);
+      break;
+    case UNARY:
+      static_cast<Unary *>(expr)->op.line += shift;
+      exprs.push_back(static_cast<Unary *>(expr)->right);
+      break;
+    case GROUPING:
+      exprs.push_back(static_cast<Grouping *>(expr)->expression);
+      break;
+    case VARIABLE:
+      static_cast<Variable *>(expr)->name.line += shift;
+      break;
+    case CALL: {
+      Call *call = static_cast<Call *>(expr);
+      call->name.line += shift;
+      exprs.insert(exprs.end(), call->arguments.begin(), call->arguments.end());
+      break;
+    }
+    default:
+      break;
+    }
+  }
+}
+
+std::string read_file(const char *path) {
+  std::ifstream fin(path);
+  std::stringstream buffer;
+  if (fin.good()) {
+    buffer << fin.rdbuf();
+  }
+  return buffer.str();
+}
+
+} // namespace
+
+Watcher::~Watcher() {
+  interpreter.release_code();
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+void Watcher::update(const std::string &next) {
+  Lox::had_error = false;
+  Lox::had_runtime_error = false;
+  stats = WatchStats();
+  stats.bytes = next.size();
+  // Compiled code is cached by statement, which may be freed or reused in
+  // another position now.
+  interpreter.release_code();
+
+  try {
+    scan(next);
+    parse();
+  } catch (RuntimeError e) {
+    Lox::runtime_error(e);
+    // Start over next time.
+    tokens = nullptr;
+    return;
+  }
+  run();
+}
+
+void Watcher::scan(const std::string &next) {
+  bool incremental = tokens != nullptr && !scan_errors;
+  restart = 0;
+  resync = -1;
+  shift = 0;
+  line_shift = 0;
+
+  if (!incremental) {
+    Scanner scanner(next);
+    tokens = scanner.scanTokens();
+    positions = scanner.line_index();
+    starts = scanner.token_starts();
+    scan_errors = scanner.error_count() > 0;
+    source = next;
+    stats.bytes_scanned = next.size();
+    stats.tokens = tokens->size();
+    return;
+  }
+
+  // The changed bytes are [prefix, size - suffix) in either version.
+  size_t limit = std::min(source.size(), next.size());
+  size_t prefix = 0;
+  while (prefix < limit && source[prefix] == next[prefix])
+    prefix++;
+  size_t suffix = 0;
+  while (suffix < limit - prefix &&
+         source[source.size() - 1 - suffix] == next[next.size() - 1 - suffix])
+    suffix++;
+  int64_t offset_shift = (int64_t)next.size() - (int64_t)source.size();
+  int64_t change_end = next.size() - suffix;
+
+  // Keep the tokens the change cannot extend and restart right after the
+  // last of them. The scanner looks one byte past a token, or two past a
+  // number for its fractional part.
+  auto first = starts.begin();
+  auto last = starts.end() - 1; // Without EOF.
+  auto token_end = [&](int i) {
+    return starts[i].offset + (int64_t)(*tokens)[i].lexeme.size();
+  };
+  restart =
+      std::lower_bound(first, last, (int64_t)prefix, starts_before) - first;
+  while (restart > 0 &&
+         token_end(restart - 1) + ((*tokens)[restart - 1].type == NUMBER) >=
+             (int64_t)prefix)
+    restart--;
+  TokenStart from{0};
+  if (restart > 0)
+    from = {token_end(restart - 1)};
+
+  Scanner scanner(next, from.offset);
+  TokenStart stop;
+  bool synced = scanner.scan_until(
+      [&](int64_t offset) {
+        if (offset < change_end)
+          return false;
+        auto old = std::lower_bound(first + restart, last,
+                                    offset - offset_shift, starts_before);
+        if (old == last || old->offset != offset - offset_shift)
+          return false;
+        resync = old - first;
+        return true;
+      },
+      stop);
+  if (!synced)
+    scanner.scanTokens();
+  scan_errors = scanner.error_count() > 0;
+
+  auto next_tokens = std::make_shared<std::vector<Token>>(
+      tokens->begin(), tokens->begin() + restart);
+  std::vector<TokenStart> next_starts(first, first + restart);
+  next_tokens->insert(next_tokens->end(), scanner.scanned_tokens().begin(),
+                      scanner.scanned_tokens().end());
+  next_starts.insert(next_starts.end(), scanner.token_starts().begin(),
+                     scanner.token_starts().end());
+
+  stats.bytes_scanned = (synced ? stop.offset : next.size()) - from.offset;
+  stats.tokens_reused = restart;
+  if (synced) {
+    shift = next_tokens->size() - resync;
+    line_shift = scanner.line_index()->line(stop.offset) -
+                 positions->line(starts[resync].offset);
+    for (size_t i = resync; i < tokens->size(); i++) {
+      Token token = (*tokens)[i];
+      token.line += line_shift;
+      token.offset += offset_shift;
+      next_tokens->push_back(token);
+      next_starts.push_back({starts[i].offset + offset_shift});
+    }
+    stats.tokens_reused += tokens->size() - resync;
+  }
+
+  tokens = next_tokens;
+  starts = std::move(next_starts);
+  positions = scanner.line_index();
+  source = next;
+  stats.tokens = tokens->size();
+}
+
+void Watcher::parse() {
+  std::vector<Stmt *> old_statements;
+  std::vector<int> old_ends;
+  old_statements.swap(statements);
+  old_ends.swap(ends);
+  bool reuse = !parse_errors;
+
+  // Statements made of the tokens before restart are unchanged.
+  size_t kept = 0;
+  int position = 0;
+  while (reuse && kept < old_statements.size() && old_ends[kept] <= restart) {
+    statements.push_back(old_statements[kept]);
+    ends.push_back(old_ends[kept]);
+    position = old_ends[kept];
+    kept++;
+  }
+
+  // Statements made of the tokens from resync on moved by shift tokens.
+  std::map<int, size_t> moved;
+  for (size_t i = kept; reuse && resync >= 0 && i < old_statements.size();
+       i++) {
+    int begin = i == 0 ? 0 : old_ends[i - 1];
+    if (begin >= resync)
+      moved[begin + shift] = i;
+  }
+
+  Parser parser(tokens);
+  size_t reused_from = old_statements.size();
+  Lox::source_positions = positions.get();
+  try {
+    while ((*tokens)[position].type != EOFL) {
+      if (auto found = moved.find(position); found != moved.end()) {
+        reused_from = found->second;
+        break;
+      }
+      statements.push_back(parser.parse_declaration(position));
+      ends.push_back(position);
+    }
+  } catch (...) {
+    for (size_t i = kept; i < statements.size(); i++)
+      delete statements[i];
+    statements.swap(old_statements);
+    ends.swap(old_ends);
+    parse_errors = true;
+    Lox::source_positions = nullptr;
+    throw;
+  }
+  Lox::source_positions = nullptr;
+
+  for (size_t i = reused_from; i < old_statements.size(); i++) {
+    if (line_shift != 0)
+      shift_lines(old_statements[i], line_shift);
+    statements.push_back(old_statements[i]);
+    ends.push_back(old_ends[i] + shift);
+  }
+  for (size_t i = kept; i < reused_from; i++)
+    delete old_statements[i];
+
+  parse_errors = parser.error_count() > 0;
+  stats.statements = statements.size();
+  stats.statements_reused = kept + (old_statements.size() - reused_from);
+}
+
+void Watcher::run() {
+  // Stop if there was a syntax error.
+  if (Lox::had_error)
+    return;
+
+  interpreter.reset_globals();
+  try {
+    interpreter.execute_statements(statements);
+  } catch (RuntimeError e) {
+    Lox::runtime_error(e);
+  }
+}
+
+void Watcher::watch(const char *path, std::ostream &err) {
+  // Editors often save by renaming a new file over the old one, so watch the
+  // directory for the name rather than the file itself.
+  std::string file(path);
+  size_t slash = file.rfind('/');
+  std::string dir = slash == std::string::npos ? "." : file.substr(0, slash + 1);
+  std::string name = file.substr(slash == std::string::npos ? 0 : slash + 1);
+
+  int fd = inotify_init1(IN_CLOEXEC);
+  if (fd < 0 ||
+      inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    err << "Could not watch '" << path << "'." << std::endl;
+    if (fd >= 0)
+      close(fd);
+    return;
+  }
+
+  while (true) {
+    update(read_file(path));
+    err << "[watch] scanned " << stats.bytes_scanned << " of " << stats.bytes
+        << " bytes, reused " << stats.tokens_reused << " of " << stats.tokens
+        << " tokens and " << stats.statements_reused << " of "
+        << stats.statements << " statements" << std::endl;
+
+    bool changed = false;
+    while (!changed) {
+      alignas(inotify_event) char buffer[4096];
+      ssize_t size = read(fd, buffer, sizeof(buffer));
+      if (size < 0 && errno == EINTR)
+        continue;
+      if (size <= 0) {
+        close(fd);
+        return;
+      }
+      for (char *p = buffer; p < buffer + size;) {
+        inotify_event *event = reinterpret_cast<inotify_event *>(p);
+        if (event->len > 0 && name == event->name)
+          changed = true;
+        p += sizeof(inotify_event) + event->len;
+      }
+    }
+  }
+}
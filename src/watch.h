@@ -0,0 +1,79 @@
+#ifndef WATCH_H_
+#define WATCH_H_
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+#include "line_index.h"
+#include "stmt.h"
+#include "token.h"
+
+// WatchStats counts the work one update did and the work it saved.
+struct WatchStats {
+  size_t bytes = 0;
+  size_t bytes_scanned = 0;
+  size_t tokens = 0;
+  size_t tokens_reused = 0;
+  size_t statements = 0;
+  size_t statements_reused = 0;
+};
+
+// Watcher re-runs a script every time it changes, keeping the tokens and the
+// top-level statements of the previous version.
+//
+// The new source is compared with the old one to find the changed bytes.
+// Scanning restarts after the last token that the change cannot extend and
+// stops at the first token past them that starts where an old token did: from there on the text is
+// the same, so the old tokens are reused with their offsets and lines
+// shifted. Top-level statements made only of reused tokens are reused the
+// same way, and only the statements in between are parsed again.
+//
+// After a version with syntax errors the next one is scanned and parsed in
+// full. Every run starts from empty globals.
+class Watcher {
+public:
+  Watcher(Interpreter &interpreter) : interpreter(interpreter) {}
+  ~Watcher();
+
+  // Scans, parses and runs source, reusing what it can.
+  void update(const std::string &source);
+  // Runs the file at path, then again whenever it is written, reporting the
+  // work saved to err. Returns only if inotify fails.
+  void watch(const char *path, std::ostream &err);
+
+  const WatchStats &last_update() { return stats; }
+  const std::vector<Stmt *> &program() { return statements; }
+  const std::vector<Token> &program_tokens() { return *tokens; }
+
+private:
+  void scan(const std::string &source);
+  void parse();
+  void run();
+
+  Interpreter &interpreter;
+  WatchStats stats;
+
+  std::string source;
+  std::shared_ptr<const LineIndex> positions;
+  std::shared_ptr<std::vector<Token>> tokens;
+  std::vector<TokenStart> starts;
+  bool scan_errors = false;
+
+  // Each top-level statement and the token index it ends before.
+  std::vector<Stmt *> statements;
+  std::vector<int> ends;
+  bool parse_errors = false;
+
+  // Set by scan(): old tokens [0, restart) are kept in place, and old tokens
+  // from resync on moved by shift tokens and line_shift lines. resync is -1
+  // when nothing after the change was reused.
+  int restart = 0;
+  int resync = -1;
+  int shift = 0;
+  int line_shift = 0;
+};
+
+#endif // WATCH_H_
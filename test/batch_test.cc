@@ -0,0 +1,110 @@
+#include "batch.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+// Parses source, a single expression statement, and returns its expression.
+Expr *parse_expression(const std::string &source, std::vector<Stmt *> &out) {
+  Scanner scanner(source);
+  auto tokens = scanner.scanTokens();
+  Parser parser(tokens);
+  out = parser.parse();
+  return dynamic_cast<Expression *>(out[0])->expression;
+}
+
+ExprValue number(double value) {
+  ExprValue val;
+  val.type = VALNUMBER;
+  val.number = value;
+  return val;
+}
+
+TEST(BatchTest, matches_interpreter) {
+  std::vector<double> x = {1, -2.5, 0, 3, 7, 11, 13, 0.5, -1, 4};
+  std::vector<double> y = {2, 4, -3, 3, 0.25, 1, -13, 8, 9, 2};
+  const char *sources[] = {
+      "x + y * 2 - (x - y) / 4;", "-x * -(y + 1);", "x < y;", "x >= y + 1;",
+      "x == y;",  "x != 3;",      "!(x > y);",      "x == nil;",
+      "!nil;",    "1 + 2 * 3;"};
+
+  for (const char *source : sources) {
+    std::vector<Stmt *> statements;
+    Expr *expr = parse_expression(source, statements);
+
+    Batch batch;
+    batch.bind("x", x.data());
+    batch.bind("y", y.data());
+    BatchResult result = batch.evaluate(expr, x.size());
+
+    for (size_t row = 0; row < x.size(); row++) {
+      Interpreter interpreter;
+      interpreter.set_global("x", number(x[row]));
+      interpreter.set_global("y", number(y[row]));
+      ExprValue expected = interpreter.evaluate(expr);
+
+      EXPECT_EQ(result.type, expected.type) << source;
+      EXPECT_EQ(result.errors[row], 0) << source;
+      if (expected.type == VALBOOL)
+        EXPECT_EQ(result.values[row], expected.boolean) << source;
+      else
+        EXPECT_DOUBLE_EQ(result.values[row], expected.number) << source;
+    }
+    delete statements[0];
+  }
+}
+
+TEST(BatchTest, divide_by_zero_marks_row) {
+  std::vector<double> x = {1, 2, 3, 4, 5, 6};
+  std::vector<double> y = {1, 0, 2, 0, 4, 5};
+  std::vector<Stmt *> statements;
+  Expr *expr = parse_expression("x / y + 1;", statements);
+
+  Batch batch;
+  batch.bind("x", x.data());
+  batch.bind("y", y.data());
+  BatchResult result = batch.evaluate(expr, x.size());
+
+  std::vector<uint8_t> expected = {0, 1, 0, 1, 0, 0};
+  EXPECT_EQ(result.errors, expected);
+  EXPECT_DOUBLE_EQ(result.values[2], 2.5);
+  delete statements[0];
+}
+
+TEST(BatchTest, type_error_marks_every_row) {
+  std::vector<double> x(3000, 1);
+  std::vector<Stmt *> statements;
+  Expr *expr = parse_expression("x + true;", statements);
+
+  Batch batch;
+  batch.bind("x", x.data());
+  BatchResult result = batch.evaluate(expr, x.size());
+
+  EXPECT_EQ(result.errors, std::vector<uint8_t>(x.size(), 1));
+  delete statements[0];
+}
+
+TEST(BatchTest, unsupported_expressions_throw) {
+  std::vector<Stmt *> statements;
+  Batch batch;
+  Expr *expr = parse_expression("z + 1;", statements);
+  EXPECT_THROW(batch.evaluate(expr, 4), RuntimeError);
+  delete statements[0];
+
+  // The error is on the line of the string.
+  expr = parse_expression("1 +\n\n\"a\";", statements);
+  try {
+    batch.evaluate(expr, 4);
+    ADD_FAILURE() << "Strings are evaluated.";
+  } catch (const RuntimeError &e) {
+    EXPECT_EQ(e.op.line, 3);
+    EXPECT_STREQ(e.what(), "Strings are not supported in batch evaluation.");
+  }
+  delete statements[0];
+}
+
+} // namespace
@@ -0,0 +1,43 @@
+# Runs every test/emit_cpp/*.lox case with the interpreter and as C++ emitted
+# by --emit-cpp, and fails unless stdout, stderr and exit codes all match.
+# The modules the cases import live in subdirectories, which are not cases.
+#
+# Expects CCLOX, CXX, RUNTIME_DIR, CASES_DIR and WORK_DIR to be defined.
+file(GLOB CASES ${CASES_DIR}/*.lox)
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+foreach(CASE ${CASES})
+  get_filename_component(NAME ${CASE} NAME_WE)
+
+  execute_process(COMMAND ${CCLOX} ${CASE}
+                  OUTPUT_VARIABLE EXPECTED_OUT ERROR_VARIABLE EXPECTED_ERR
+                  RESULT_VARIABLE EXPECTED_EXIT)
+
+  execute_process(COMMAND ${CCLOX} --emit-cpp ${CASE}
+                  OUTPUT_FILE ${WORK_DIR}/${NAME}.cc RESULT_VARIABLE EMIT_EXIT)
+  if(NOT EMIT_EXIT EQUAL 0)
+    message(FATAL_ERROR "${NAME}: --emit-cpp exited with ${EMIT_EXIT}")
+  endif()
+
+  execute_process(COMMAND ${CXX} -std=c++17 -O1 -I${RUNTIME_DIR}
+                          ${WORK_DIR}/${NAME}.cc -o ${WORK_DIR}/${NAME}
+                  ERROR_VARIABLE COMPILE_ERR RESULT_VARIABLE COMPILE_EXIT)
+  if(NOT COMPILE_EXIT EQUAL 0)
+    message(FATAL_ERROR "${NAME}: emitted C++ does not compile\n${COMPILE_ERR}")
+  endif()
+
+  execute_process(COMMAND ${WORK_DIR}/${NAME}
+                  OUTPUT_VARIABLE ACTUAL_OUT ERROR_VARIABLE ACTUAL_ERR
+                  RESULT_VARIABLE ACTUAL_EXIT)
+
+  if(NOT "${ACTUAL_OUT}" STREQUAL "${EXPECTED_OUT}")
+    message(FATAL_ERROR "${NAME}: stdout differs\nexpected:\n${EXPECTED_OUT}\nactual:\n${ACTUAL_OUT}")
+  endif()
+  if(NOT "${ACTUAL_ERR}" STREQUAL "${EXPECTED_ERR}")
+    message(FATAL_ERROR "${NAME}: stderr differs\nexpected:\n${EXPECTED_ERR}\nactual:\n${ACTUAL_ERR}")
+  endif()
+  if(NOT ACTUAL_EXIT EQUAL EXPECTED_EXIT)
+    message(FATAL_ERROR "${NAME}: exit code ${ACTUAL_EXIT}, expected ${EXPECTED_EXIT}")
+  endif()
+  message(STATUS "${NAME}: ok")
+endforeach()
@@ -1,9 +1,16 @@
 #include "expr.h"
+#include "heap.h"
 #include "interpreter.h"
+#include "lox.h"
 #include "parser.h"
+#include "runtime_error.h"
 #include "scanner.h"
 
+#include <sstream>
+#include <thread>
+
 #include "gtest/gtest.h"
+#include "test_helpers.h"
 
 namespace {
 
@@ -203,4 +210,373 @@ TEST(BooleanTest, str_not_equal) {
   EXPECT_TRUE(val.boolean);
 }
 
+TEST(HeapTest, concat_over_limit) {
+  Scanner scanner("\"foo\" + \"bar\";");
+  auto tokens = scanner.scanTokens();
+  Parser parser(tokens);
+  std::vector<Stmt *> statements = parser.parse();
+  Expression *expr = dynamic_cast<Expression *>(statements[0]);
+  Interpreter interpreter;
+
+  Heap::set_limit(Heap::total() + 5);
+  EXPECT_THROW(interpreter.evaluate(expr->expression), RuntimeError);
+  Heap::set_limit(0);
+  ExprValue val = interpreter.evaluate(expr->expression);
+  EXPECT_EQ(val.string, "foobar");
+}
+
+TEST(NumberTest, deep_chain) {
+  std::string source = "1";
+  for (int i = 0; i < 200000; i++)
+    source += " + 1";
+  Scanner scanner(source + ";");
+  auto tokens = scanner.scanTokens();
+  Parser parser(tokens);
+  std::vector<Stmt *> statements = parser.parse();
+  EXPECT_EQ(statements.size(), 1);
+  Expression *expr = dynamic_cast<Expression *>(statements[0]);
+  Interpreter interpreter;
+  ExprValue val = interpreter.evaluate(expr->expression);
+
+  EXPECT_EQ(val.type, VALNUMBER);
+  EXPECT_DOUBLE_EQ(val.number, 200001);
+  delete statements[0];
+}
+
+TEST(LazyBlockTest, parses_on_first_visit) {
+  Scanner scanner("var a = 1; { var b = a + 1; { a = b * 3; } }");
+  auto tokens = scanner.scanTokens();
+  Parser parser(tokens);
+  parser.lazy_blocks = true;
+  std::vector<Stmt *> statements = parser.parse();
+  Interpreter interpreter;
+  interpreter.execute_statements(statements);
+
+  Variable a(Token(IDENTIFIER, "a", nullptr, 1));
+  EXPECT_DOUBLE_EQ(interpreter.evaluate(&a).number, 6);
+  Block *block = dynamic_cast<Block *>(statements[1]);
+  EXPECT_EQ(block->statements.size(), 2);
+  EXPECT_EQ(block->body.tokens, nullptr);
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST(LazyBlockTest, syntax_error_on_visit) {
+  Scanner scanner("var a = 1;\n{ a = 2;\n print a }");
+  auto tokens = scanner.scanTokens();
+  Parser parser(tokens);
+  parser.lazy_blocks = true;
+  std::vector<Stmt *> statements = parser.parse();
+  Interpreter interpreter;
+
+  Lox::had_error = false;
+  try {
+    interpreter.execute_statements(statements);
+    FAIL();
+  } catch (RuntimeError e) {
+    EXPECT_EQ(e.op.line, 2);
+  }
+  EXPECT_TRUE(Lox::had_error);
+  Lox::had_error = false;
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+// Evaluates every expression statement of source both as a tree and in
+// flat form, expecting the same values, globals and errors.
+void expect_same_flat(const std::string &source) {
+  Scanner scanner(source);
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  FlatExpr flat;
+  std::vector<FlatRef> refs;
+  for (Stmt *stmt : statements)
+    refs.push_back(flat.add(dynamic_cast<Expression *>(stmt)->expression));
+
+  Interpreter tree, flat_interpreter;
+  tree.set_global("a", ExprValue());
+  flat_interpreter.set_global("a", ExprValue());
+  for (size_t i = 0; i < statements.size(); i++) {
+    ExprValue expected, actual;
+    int expected_line = 0, actual_line = 0;
+    try {
+      expected = tree.evaluate(
+          dynamic_cast<Expression *>(statements[i])->expression);
+    } catch (RuntimeError e) {
+      expected_line = e.op.line;
+    }
+    try {
+      actual = flat_interpreter.evaluate(flat, refs[i]);
+    } catch (RuntimeError e) {
+      actual_line = e.op.line;
+    }
+    EXPECT_TRUE(actual == expected) << i;
+    EXPECT_EQ(actual_line, expected_line) << i;
+  }
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST(FlatExprTest, evaluates_like_tree) {
+  expect_same_flat("1.2 + 3.4 * (2 - -1) / 4;\n"
+                   "\"foo\" + \"bar\" == \"foobar\";\n"
+                   "!(1 < 2) != (3 >= 3);\n"
+                   "a = 2;\n"
+                   "a = a * a + 1;\n"
+                   "nil == false;\n"
+                   "true;\n"
+                   "1 / 0;\n"
+                   "\"a\" - 1;\n"
+                   "-\"a\";\n"
+                   "b;\n"
+                   "b = 1;\n");
+}
+
+TEST(FlatExprTest, shares_names_and_strings) {
+  Scanner scanner("a + a * \"s\" + \"s\" + nil + nil;");
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  FlatExpr flat;
+  FlatRef ref =
+      flat.add(dynamic_cast<Expression *>(statements[0])->expression);
+
+  EXPECT_EQ(flat_type(ref), BINARY);
+  EXPECT_EQ(flat.strings.size(), 2);
+  EXPECT_EQ(flat.binary_nodes.size(), 5);
+  EXPECT_EQ(flat.variable_nodes.size(), 2);
+  EXPECT_EQ(flat.nodes(), 9);
+  EXPECT_EQ(flat.binary_nodes[flat_index(ref)].op, PLUS);
+  delete statements[0];
+}
+
+TEST(FlatExprTest, deep_chain) {
+  std::string source = "1";
+  for (int i = 0; i < 200000; i++)
+    source += " + 1";
+  Scanner scanner(source + ";");
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  FlatExpr flat;
+  FlatRef ref =
+      flat.add(dynamic_cast<Expression *>(statements[0])->expression);
+  delete statements[0];
+
+  Interpreter interpreter;
+  ExprValue val = interpreter.evaluate(flat, ref);
+  EXPECT_EQ(val.type, VALNUMBER);
+  EXPECT_DOUBLE_EQ(val.number, 200001);
+}
+
+TEST(ControlFlowTest, branches_and_loops) {
+  EXPECT_EQ(run("if (1 < 2) print \"a\"; else print \"b\";\n"
+                "if (nil) print \"c\"; else if (!true) print \"d\";\n"
+                "else print \"e\";"),
+            "a\ne\n");
+  EXPECT_EQ(run("var n = 0; while (n < 3) n = n + 1; print n;"), "3.000000\n");
+  EXPECT_EQ(run("var s = \"\"; for (var i = 0; i < 3; i = i + 1) s = s + \"x\";"
+                "print s;"),
+            "xxx\n");
+  // The loop variable is scoped to the loop.
+  EXPECT_EQ(run("for (var i = 0; i < 1; i = i + 1) {} print i;"),
+            "[line 1] Undefined variable 'i'.");
+  EXPECT_EQ(run("var i = 5;\nwhile (i) {\n  i = i - 1; i = i + \"\";\n}"),
+            "[line 3] Operands must be two numbers or two strings.");
+}
+
+TEST(ControlFlowTest, loop_body_starts_from_a_fresh_frame) {
+  // Environment::define keeps the first definition in a scope, so a frame
+  // kept across iterations unchanged would print 0 three times.
+  EXPECT_EQ(run("for (var i = 0; i < 3; i = i + 1) { var j = i; print j;"
+                " { var k = j * 2; print k; } }"),
+            "0.000000\n0.000000\n1.000000\n2.000000\n2.000000\n4.000000\n");
+  EXPECT_EQ(run("var i = 0; while (i < 2) { var t; print t; t = i; i = i + 1; }"),
+            "nil\nnil\n");
+  // Lazily parsed bodies are parsed once, on the first iteration.
+  EXPECT_EQ(run("var i = 0; while (i < 2) { var t = i; i = t + 1; print i; }",
+                true),
+            "1.000000\n2.000000\n");
+  EXPECT_EQ(run("var i = 0; while (i < 2) { i = i + 1; }", true), "");
+}
+
+// Runs source with budget and returns the error, or "" if it finished.
+std::string run_with_budget(Interpreter &interpreter, const std::string &source,
+                            Budget budget) {
+  Scanner scanner(source);
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  std::ostringstream out;
+  interpreter.set_output(out);
+  interpreter.set_budget(budget);
+  std::string error;
+  try {
+    interpreter.execute_statements(statements);
+  } catch (RuntimeError e) {
+    error = "[line " + std::to_string(e.op.line) + "] " + e.what();
+  }
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return error;
+}
+
+TEST(BudgetTest, stops_after_max_steps) {
+  // Each statement is a step, and so is each expression node.
+  const std::string source = "var a = 1;\nprint a + 2;\nprint a;";
+  Interpreter interpreter;
+  EXPECT_EQ(run_with_budget(interpreter, source, {8, 0}), "");
+  EXPECT_EQ(run_with_budget(interpreter, source, {6, 0}),
+            "[line 3] Execution exceeded the budget of 6 steps.");
+  // The literal 2 has no line of its own.
+  EXPECT_EQ(run_with_budget(interpreter, source, {5, 0}),
+            "[line 2] Execution exceeded the budget of 5 steps.");
+
+  // Past the check interval, and in a loop.
+  std::string loop = "var i = 0;\nwhile (i < 100000) {\n  i = i + 1;\n}";
+  EXPECT_EQ(run_with_budget(interpreter, loop, {100000, 0}),
+            "[line 3] Execution exceeded the budget of 100000 steps.");
+  EXPECT_EQ(run_with_budget(interpreter, loop, {1000000, 0}), "");
+  EXPECT_EQ(run_with_budget(interpreter, loop, {0, 0}), "");
+}
+
+TEST(BudgetTest, stays_exhausted_until_restarted) {
+  Interpreter interpreter;
+  EXPECT_NE(run_with_budget(interpreter, "print 1; print 2;", {3, 0}), "");
+  Scanner scanner("print 3;");
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  EXPECT_THROW(interpreter.execute_statements(statements), RuntimeError);
+  interpreter.restart_budget();
+  std::ostringstream out;
+  interpreter.set_output(out);
+  interpreter.execute_statements(statements);
+  EXPECT_EQ(out.str(), "3.000000\n");
+  delete statements[0];
+}
+
+TEST(BudgetTest, times_out) {
+  Interpreter interpreter;
+  auto start = std::chrono::steady_clock::now();
+  std::string error = run_with_budget(
+      interpreter, "var i = 0;\nwhile (true)\n  i = i + 1;", {0, 50});
+  // At the condition, or at the body.
+  EXPECT_TRUE(error == "[line 2] Execution exceeded the timeout of 50 ms." ||
+              error == "[line 3] Execution exceeded the timeout of 50 ms.")
+      << error;
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_GE(elapsed, std::chrono::milliseconds(50));
+  EXPECT_LT(elapsed, std::chrono::seconds(5));
+}
+
+// Runs source as a Task, slice turns at a time, and returns its output.
+std::string run_task(const std::string &source, uint64_t slice,
+                     bool lazy_blocks = false) {
+  Scanner scanner(source);
+  Parser parser(scanner.scanTokens());
+  parser.lazy_blocks = lazy_blocks;
+  std::vector<Stmt *> statements = parser.parse();
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  {
+    Task task(statements);
+    try {
+      while (!task.done())
+        interpreter.resume(task, slice);
+    } catch (RuntimeError e) {
+      out << "[line " << e.op.line << "] " << e.what();
+    }
+  }
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return out.str();
+}
+
+TEST(TaskTest, runs_like_a_straight_run_in_any_slices) {
+  const char *sources[] = {
+      "var a = 1; { var a = 2; { print a; } a = 3; print a; } print a;",
+      "for (var i = 0; i < 3; i = i + 1) { var j = i; print j;"
+      " { var k = j * 2; print k; } }",
+      "var i = 0; while (i < 2) { var t; print t; t = i; i = i + 1; }",
+      "var n = 0; while (n < 3) n = n + 1; print n;",
+      "if (1 < 2) { print \"a\"; } else print \"b\";\n"
+      "if (nil) print \"c\"; else if (!true) print \"d\"; else { print 1; }",
+      "var i = 5;\nwhile (i) {\n  i = i - 1; i = i + \"\";\n}",
+      "for (var i = 0; i < 1; i = i + 1) {} print i;"};
+  for (const char *source : sources) {
+    for (uint64_t slice : {1, 2, 3, 7, 1000}) {
+      EXPECT_EQ(run_task(source, slice), run(source))
+          << source << " in slices of " << slice;
+      EXPECT_EQ(run_task(source, slice, true), run(source, true))
+          << source << " lazily in slices of " << slice;
+    }
+  }
+}
+
+TEST(TaskTest, tasks_have_globals_of_their_own) {
+  Scanner scanner("var x = 1;\nx = x + 1;\nprint x;");
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  Task first(statements), second(statements);
+  // Interleaved a statement at a time.
+  while (!first.done() || !second.done()) {
+    interpreter.resume(first, 1);
+    interpreter.resume(second, 1);
+  }
+  EXPECT_EQ(out.str(), "2.000000\n2.000000\n");
+  EXPECT_EQ(first.global_environment().bindings().at("x").number, 2);
+  EXPECT_EQ(second.global_environment().bindings().at("x").number, 2);
+  EXPECT_EQ(interpreter.global_environment().bindings().size(), 0);
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST(TaskTest, suspends_in_endless_loops_and_resumes_on_another_thread) {
+  Scanner scanner("var i = 0;\nwhile (true) {\n  var j = i;\n  i = j + 1;\n"
+                  "  if (i == 1000) { print i; }\n}");
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  Task task(statements);
+  std::ostringstream out;
+  {
+    Interpreter interpreter;
+    interpreter.set_output(out);
+    interpreter.resume(task, 100);
+    EXPECT_FALSE(task.done());
+  }
+  std::thread worker([&]() {
+    Interpreter interpreter;
+    interpreter.set_output(out);
+    interpreter.resume(task, 10000);
+  });
+  worker.join();
+  EXPECT_FALSE(task.done());
+  EXPECT_EQ(out.str(), "1000.000000\n");
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST(TaskTest, an_error_ends_the_task) {
+  Scanner scanner("{ var a = 1;\n{ print a; print b; } }");
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  Task task(statements);
+  EXPECT_THROW(interpreter.resume(task, 100), RuntimeError);
+  EXPECT_TRUE(task.done());
+  EXPECT_EQ(out.str(), "1.000000\n");
+  // The interpreter is back in its own globals.
+  Scanner next("var c = 2;");
+  Parser next_parser(next.scanTokens());
+  std::vector<Stmt *> next_statements = next_parser.parse();
+  interpreter.execute_statements(next_statements);
+  EXPECT_EQ(interpreter.global_environment().bindings().count("c"), 1);
+  for (Stmt *stmt : statements)
+    delete stmt;
+  delete next_statements[0];
+}
+
 } // namespace
@@ -0,0 +1,65 @@
+#include "expr.h"
+#include "interpreter.h"
+#include "lox.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+
+#include "gtest/gtest.h"
+#include "test_helpers.h"
+
+namespace {
+
+ExprValue get(Interpreter &interpreter, const std::string &name) {
+  Variable var(Token(IDENTIFIER, name, nullptr, 1));
+  return interpreter.evaluate(&var);
+}
+
+TEST(JitTest, matches_interpreter) {
+  std::vector<Stmt *> statements =
+      parse("var a = 1.5; var b = 2; var c = a * b + 3;"
+            "var d = c / 2 - -a; a = d * d - c;"
+            "b = (a + b) * (c - d) / (1 + 2 * (3 - 4 * (5 + 6)));");
+  Interpreter plain;
+  plain.interpret(statements);
+  Interpreter jitted;
+  jitted.enable_jit();
+  jitted.interpret(statements);
+
+  for (const char *name : {"a", "b", "c", "d"}) {
+    ExprValue expected = get(plain, name);
+    ExprValue val = get(jitted, name);
+    EXPECT_EQ(val.type, VALNUMBER);
+    EXPECT_DOUBLE_EQ(val.number, expected.number);
+  }
+  jitted.release_code();
+}
+
+TEST(JitTest, divide_by_zero_falls_back) {
+  std::vector<Stmt *> statements =
+      parse("var a = 1; var b = 0; a = 2; var c = a / b; a = 3;");
+  Interpreter interpreter;
+  interpreter.enable_jit();
+  Lox::had_runtime_error = false;
+  interpreter.interpret(statements);
+
+  EXPECT_TRUE(Lox::had_runtime_error);
+  EXPECT_DOUBLE_EQ(get(interpreter, "a").number, 2);
+  EXPECT_THROW(get(interpreter, "c"), RuntimeError);
+  Lox::had_runtime_error = false;
+  interpreter.release_code();
+}
+
+TEST(JitTest, string_input_falls_back) {
+  std::vector<Stmt *> statements =
+      parse("var s = \"str\"; var n = 2; var m = n * 2; var t = s;");
+  Interpreter interpreter;
+  interpreter.enable_jit();
+  interpreter.interpret(statements);
+
+  EXPECT_EQ(get(interpreter, "t").string, "str");
+  EXPECT_DOUBLE_EQ(get(interpreter, "m").number, 4);
+  interpreter.release_code();
+}
+
+} // namespace
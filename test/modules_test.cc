@@ -0,0 +1,199 @@
+#include "interpreter.h"
+#include "lox.h"
+#include "modules.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "test_helpers.h"
+
+namespace {
+
+void free(std::vector<Stmt *> &statements) {
+  for (Stmt *stmt : statements)
+    delete stmt;
+  statements.clear();
+}
+
+// A temporary directory of module files.
+class ModuleDir {
+public:
+  ModuleDir() {
+    char path[] = "/tmp/modules_testXXXXXX";
+    root = mkdtemp(path);
+  }
+  ~ModuleDir() {
+    for (auto it = files.rbegin(); it != files.rend(); it++)
+      remove((root + "/" + *it).c_str());
+    rmdir(root.c_str());
+  }
+
+  // Writes contents to name, with a modification time of its own.
+  void write(const std::string &name, const std::string &contents) {
+    std::string path = root + "/" + name;
+    std::ofstream(path) << contents;
+    struct timespec times[2] = {{0, UTIME_OMIT}, {++mtime, 0}};
+    utimensat(AT_FDCWD, path.c_str(), times, 0);
+    files.push_back(name);
+  }
+  void mkdir(const std::string &name) {
+    ::mkdir((root + "/" + name).c_str(), 0700);
+    files.push_back(name);
+  }
+
+  std::string root;
+
+private:
+  std::vector<std::string> files;
+  time_t mtime = 1000000;
+};
+
+TEST(ModulesTest, runs_each_module_once) {
+  ModuleDir dir;
+  dir.write("a.lox", "import \"b.lox\";\nvar a = b + 1;\nprint \"a\";\n");
+  dir.write("b.lox", "var b = 1;\nprint \"b\";\n");
+  std::vector<Stmt *> statements = parse(
+      "import \"a.lox\";\nimport \"b.lox\";\n"
+      "{ var b = 10; import \"a.lox\"; print b; }\nprint a + b;");
+
+  ModuleCache cache;
+  ASSERT_TRUE(cache.load(statements, dir.root));
+  EXPECT_EQ(cache.imports, 3);
+  EXPECT_EQ(cache.reached, 2);
+  EXPECT_EQ(cache.parsed, 2);
+
+  Interpreter interpreter;
+  EXPECT_EQ(run(interpreter, statements), "b\na\n10.000000\n3.000000\n");
+  // Fresh globals run the modules again.
+  interpreter.reset_globals();
+  EXPECT_EQ(run(interpreter, statements), "b\na\n10.000000\n3.000000\n");
+  free(statements);
+}
+
+TEST(ModulesTest, parses_again_only_after_a_change) {
+  ModuleDir dir;
+  dir.write("a.lox", "import \"b.lox\";\nvar a = b + 1;\n");
+  dir.write("b.lox", "var b = 1;\n");
+  ModuleCache cache;
+  std::vector<Stmt *> statements = parse("import \"a.lox\";\nprint a;");
+  ASSERT_TRUE(cache.load(statements, dir.root));
+  EXPECT_EQ(cache.parsed, 2);
+  free(statements);
+
+  statements = parse("import \"a.lox\";\nprint a;");
+  ASSERT_TRUE(cache.load(statements, dir.root));
+  EXPECT_EQ(cache.parsed, 0);
+  EXPECT_EQ(cache.reused, 2);
+
+  dir.write("b.lox", "var b = 41;\n");
+  ASSERT_TRUE(cache.load(statements, dir.root));
+  EXPECT_EQ(cache.parsed, 1);
+  EXPECT_EQ(cache.reused, 1);
+  Interpreter interpreter;
+  EXPECT_EQ(run(interpreter, statements), "42.000000\n");
+  free(statements);
+}
+
+TEST(ModulesTest, resolves_paths_from_the_importing_module) {
+  ModuleDir dir;
+  dir.mkdir("lib");
+  // The two import each other, and both spellings of c.lox are one module.
+  dir.write("lib/c.lox", "import \"../d.lox\";\nvar c = \"c\";\n");
+  dir.write("d.lox", "import \"lib/c.lox\";\nimport \"./lib/../lib/c.lox\";\n"
+                     "var d = \"d\";\n");
+  std::vector<Stmt *> statements =
+      parse("import \"lib/c.lox\";\nprint c + d;");
+
+  ModuleCache cache;
+  ASSERT_TRUE(cache.load(statements, dir.root));
+  EXPECT_EQ(cache.reached, 2);
+  Interpreter interpreter;
+  EXPECT_EQ(run(interpreter, statements), "cd\n");
+  free(statements);
+}
+
+TEST(ModulesTest, loads_many_modules_on_many_threads) {
+  ModuleDir dir;
+  std::string source;
+  for (int m = 0; m < 40; m++) {
+    std::string name = "m" + std::to_string(m) + ".lox";
+    // Every module also imports the next, in a chain the workers follow.
+    std::string next = "m" + std::to_string(m + 1) + ".lox";
+    dir.write(name, (m + 1 < 40 ? "import \"" + next + "\";\n" : "") +
+                        "var v" + std::to_string(m) + " = " +
+                        std::to_string(m) + ";\n");
+    source += "import \"" + name + "\";\n";
+  }
+  source += "print v0 + v39;";
+  std::vector<Stmt *> statements = parse(source);
+
+  ModuleCache cache;
+  cache.threads = 4;
+  ASSERT_TRUE(cache.load(statements, dir.root));
+  EXPECT_EQ(cache.reached, 40);
+  EXPECT_EQ(cache.parsed, 40);
+  Interpreter interpreter;
+  EXPECT_EQ(run(interpreter, statements), "39.000000\n");
+  free(statements);
+}
+
+TEST(ModulesTest, reports_errors_in_import_order) {
+  ModuleDir dir;
+  dir.write("a.lox", "import \"bad.lox\";\nimport \"missing.lox\";\n");
+  dir.write("bad.lox", "var x = 1;\nprint x +;\n");
+  std::vector<Stmt *> statements = parse("var y;\nimport \"a.lox\";");
+
+  ModuleCache cache;
+  testing::internal::CaptureStdout();
+  EXPECT_FALSE(cache.load(statements, dir.root));
+  std::string output = testing::internal::GetCapturedStdout();
+  EXPECT_TRUE(Lox::had_error);
+  Lox::had_error = false;
+  EXPECT_EQ(output, "[line 2, column 10] Error in '" + dir.root +
+                        "/bad.lox' at ';': Expect expression.\n"
+                        "[line 2] Error at 'import': Could not read module '" +
+                        dir.root + "/missing.lox'.\n");
+  free(statements);
+}
+
+TEST(ModulesTest, imports_in_lazy_blocks_and_tasks) {
+  ModuleDir dir;
+  dir.write("b.lox", "var b = 1;\nb = b + 1;\n");
+  // A block importing a module is parsed up front, so the import is seen.
+  std::vector<Stmt *> statements =
+      parse("var a = 1;\n{ import \"b.lox\"; print a + b; }", true);
+  ModuleCache cache;
+  ASSERT_TRUE(cache.load(statements, dir.root));
+  EXPECT_EQ(cache.imports, 1);
+
+  // A task runs the module into its own globals.
+  Interpreter interpreter;
+  Task task(statements);
+  std::ostringstream out;
+  interpreter.set_output(out);
+  // One statement per slice, also inside the module: the var, the block,
+  // the import, the module's two and the print.
+  int slices = 0;
+  for (; !task.done(); slices++)
+    interpreter.resume(task, 1);
+  EXPECT_EQ(out.str(), "3.000000\n");
+  EXPECT_EQ(slices, 6);
+  EXPECT_EQ(task.global_environment().bindings().count("b"), 1);
+  EXPECT_EQ(interpreter.global_environment().bindings().count("b"), 0);
+
+  // Without a load, the import has no module to run.
+  std::vector<Stmt *> unloaded = parse("import \"b.lox\";");
+  EXPECT_EQ(run(interpreter, unloaded),
+            "[line 1] Module 'b.lox' is not loaded.");
+  free(unloaded);
+  free(statements);
+}
+
+} // namespace
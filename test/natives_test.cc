@@ -0,0 +1,158 @@
+#include "interpreter.h"
+#include "lox.h"
+#include "natives.h"
+#include "optimizer.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+#include "type_inference.h"
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "test_helpers.h"
+
+namespace {
+
+// Host functions of every kind of signature the binding supports.
+double hypot2(double x, double y) { return x * x + y * y; }
+bool is_empty(const std::string &s) { return s.empty(); }
+std::string repeat(std::string s, int times) {
+  std::string result;
+  for (int i = 0; i < times; i++)
+    result += s;
+  return result;
+}
+std::string type_name(const ExprValue &value) {
+  return value.type == VALNUMBER ? "number" : "other";
+}
+int calls = 0;
+void count() { calls++; }
+
+class NativesTest : public testing::Test {
+protected:
+  static void SetUpTestSuite() {
+    Natives::define("hypot2", hypot2);
+    Natives::define("is_empty", is_empty);
+    Natives::define("repeat", repeat);
+    Natives::define("type_name", type_name);
+    Natives::define("count", count);
+    Natives::define("twice", [](double x) { return 2 * x; });
+  }
+};
+
+TEST_F(NativesTest, binds_host_functions) {
+  EXPECT_EQ(run("print hypot2(3, 4);\n"
+                "print is_empty(\"\") == !is_empty(\"a\");\n"
+                "print repeat(\"ab\", 3);\n"
+                "print type_name(1) + type_name(nil);\n"
+                "print count();\n"
+                "print twice(twice(1.5));"),
+            "25.000000\n1\nababab\nnumberother\nnil\n6.000000\n");
+  EXPECT_EQ(calls, 1);
+  // Arguments are evaluated left to right, before the call.
+  EXPECT_EQ(run("var a = 1;\nprint hypot2(a = a + 1, a);"), "8.000000\n");
+  EXPECT_EQ(run("print sqrt(16) + abs(-2) + floor(2.5) + len(\"é\");"),
+            "10.000000\n");
+}
+
+TEST_F(NativesTest, keeps_bindings_once_calls_resolve_to_them) {
+  Natives::define("thrice", [](double x) { return -x; });
+  EXPECT_NE(Natives::define("thrice", [](double x) { return 3 * x; }),
+            nullptr);
+  EXPECT_EQ(run("print thrice(1);"), "3.000000\n");
+  // Calls to it may be running on other threads now.
+  EXPECT_EQ(Natives::define("thrice", [](double x) { return -x; }), nullptr);
+  EXPECT_EQ(run("print thrice(1);"), "3.000000\n");
+}
+
+TEST_F(NativesTest, checks_argument_types) {
+  EXPECT_EQ(run("print 1;\nprint hypot2(1, \"2\");"),
+            "1.000000\n[line 2] Argument 2 of 'hypot2' must be a number.");
+  EXPECT_EQ(run("print is_empty(nil);"),
+            "[line 1] Argument 1 of 'is_empty' must be a string.");
+  // An error in an argument stops the call before the native runs.
+  EXPECT_EQ(run("print twice(-\"a\");"), "[line 1] Operand must be a number.");
+}
+
+TEST_F(NativesTest, reports_calls_that_cannot_be_resolved) {
+  testing::internal::CaptureStdout();
+  std::vector<Stmt *> statements =
+      parse("print nope(1);\nprint hypot2(1);\nprint sqrt(1, 2,);\n"
+            "sqrt(4) = 2;\nprint twice(3);");
+  EXPECT_EQ(testing::internal::GetCapturedStdout(),
+            "[line 1] Error at 'nope': Undefined function 'nope'.\n"
+            "[line 2] Error at ')': Expected 2 arguments but got 1.\n"
+            "[line 3] Error at ')': Expect expression.\n"
+            "[line 4] Error at '=': Invalid assignment target\n");
+  EXPECT_TRUE(Lox::had_error);
+  Lox::had_error = false;
+  ASSERT_EQ(statements.size(), 5);
+  EXPECT_EQ(run({statements[4]}), "6.000000\n");
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST_F(NativesTest, nests_deeply) {
+  // Calls parse and evaluate without native recursion per level.
+  std::string source;
+  for (int i = 0; i < 100000; i++)
+    source += "abs(";
+  source += "1" + std::string(100000, ')');
+  EXPECT_EQ(run("print " + source + " + twice(" + source + ");"),
+            "3.000000\n");
+}
+
+TEST_F(NativesTest, evaluates_flat_calls) {
+  std::vector<Stmt *> statements =
+      parse("hypot2(1 + 2, twice(2));\nrepeat(\"x\", 2) + count();");
+  FlatExpr flat;
+  FlatRef first =
+      flat.add(dynamic_cast<Expression *>(statements[0])->expression);
+  FlatRef second =
+      flat.add(dynamic_cast<Expression *>(statements[1])->expression);
+  EXPECT_EQ(flat.call_nodes.size(), 4);
+  EXPECT_EQ(flat.lists.size(), 5);
+
+  Interpreter interpreter;
+  EXPECT_DOUBLE_EQ(interpreter.evaluate(flat, first).number, 25);
+  try {
+    interpreter.evaluate(flat, second);
+    FAIL();
+  } catch (RuntimeError e) {
+    EXPECT_STREQ(e.what(), "Operands must be two numbers or two strings.");
+  }
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST_F(NativesTest, passes_keep_calls) {
+  // The optimizer keeps calls for their effects, even when their result is
+  // unused, but may still fold constants into their arguments.
+  std::vector<Stmt *> statements =
+      parse("var a = 2; var b = twice(a); count(); print 1;");
+  Optimizer optimizer(true);
+  optimizer.optimize(statements);
+  ASSERT_EQ(statements.size(), 3);
+  Call *call = dynamic_cast<Call *>(
+      dynamic_cast<Expression *>(statements[0])->expression);
+  ASSERT_NE(call, nullptr);
+  EXPECT_EQ(call->name.lexeme, "twice");
+  EXPECT_NE(dynamic_cast<PrimitiveNumber *>(call->arguments[0]), nullptr);
+  EXPECT_EQ(run(statements), "1.000000\n");
+  for (Stmt *stmt : statements)
+    delete stmt;
+
+  // A native returning a double is a number to type inference.
+  statements = parse("var n = twice(1); var s = repeat(\"a\", 1);\n"
+                     "print n + 1; print type_name(n);");
+  TypeInference inference(true);
+  inference.infer(statements);
+  EXPECT_EQ(inference.number_variables, 1);
+  EXPECT_EQ(inference.string_variables, 1);
+  EXPECT_EQ(run(statements), "3.000000\nnumber\n");
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+} // namespace
@@ -0,0 +1,85 @@
+#include "interpreter.h"
+#include "optimizer.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "test_helpers.h"
+
+namespace {
+
+// Optimizes source, checks that it behaves as before and returns how many
+// top-level statements remain.
+size_t optimize(const std::string &source, bool closed_globals = true) {
+  std::vector<Stmt *> statements = parse(source);
+  std::string expected = run(statements);
+  Optimizer optimizer(closed_globals);
+  optimizer.optimize(statements);
+  EXPECT_EQ(run(statements), expected) << source;
+
+  size_t remaining = statements.size();
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return remaining;
+}
+
+TEST(OptimizerTest, dead_stores) {
+  EXPECT_EQ(optimize("var a = 1; a = 2; print a;"), 1);
+  EXPECT_EQ(optimize("var a = 1; var b = a + 1; b = a * 2; print b; b = 3;"),
+            3);
+}
+
+TEST(OptimizerTest, unused_variables) {
+  EXPECT_EQ(optimize("var a = 1; var b = \"s\"; b = b + \"t\"; print 5;"), 1);
+  // The value is still evaluated for the error it raises.
+  EXPECT_EQ(optimize("var a = 1; var b = a / 0; print a;"), 2);
+  EXPECT_EQ(optimize("var a = 1; var b = true + a; print a;"), 2);
+  EXPECT_EQ(optimize("var a = 1; var b = c; print a;"), 2);
+}
+
+TEST(OptimizerTest, copies) {
+  EXPECT_EQ(optimize("var a = 1 + 2; var b = a; var c = b; print c;"), 2);
+  // The copy is stale once its source is assigned.
+  EXPECT_EQ(optimize("var a = 1 + 2; var b = a; a = 5; print b; print a;"), 3);
+  // Inside the block, a names another variable.
+  EXPECT_EQ(optimize("var a = 1 + 2; var b = a; { var a = 4; print b; }"), 2);
+}
+
+TEST(OptimizerTest, blocks) {
+  EXPECT_EQ(optimize("{ var t = 3; var u = t; print u; } { var v = 1; }"), 1);
+  EXPECT_EQ(optimize("var a = 1; { var a = a; print a; } print a;"), 2);
+  EXPECT_EQ(optimize("{ var a = 1; var a = 2; print a; }"), 1);
+}
+
+TEST(OptimizerTest, open_globals_are_kept) {
+  EXPECT_EQ(optimize("var a = 1; a = 2;", false), 2);
+  EXPECT_EQ(optimize("var a = 1; { var t = a; print t; }", false), 2);
+}
+
+TEST(OptimizerTest, assignments_in_expressions) {
+  EXPECT_EQ(optimize("var a = 1; var b = 2; print (a = b) + a; print a;"), 3);
+  EXPECT_EQ(optimize("var a = 1; print a = 2; a = 3;"), 2);
+}
+
+TEST(OptimizerTest, control_flow) {
+  // A loop reads its variables again after the body.
+  EXPECT_EQ(optimize("var i = 0; while (i < 3) { print i; i = i + 1; }"), 2);
+  EXPECT_EQ(optimize("var a = 1; var b = a; while (b < 3) { b = b + 1; a = 5; }"
+                     "print b;"),
+            4);
+  // The store before a branch may be the one that is read.
+  EXPECT_EQ(optimize("var a = 1; if (false) a = 2; print a;"), 3);
+  EXPECT_EQ(optimize("var a = 1; if (a == 1) { a = 2; } else a = 3; print a;"),
+            3);
+  // Straight-line code inside a body is still optimized.
+  EXPECT_EQ(optimize("for (var i = 0; i < 2; i = i + 1) {"
+                     " var t = 1; t = i; print t; }"),
+            1);
+  EXPECT_EQ(optimize("var n = 0; while (n < 2) { n = n + 1; { var u = 1; } }"),
+            2);
+}
+
+} // namespace
@@ -1,4 +1,5 @@
 #include "expr.h"
+#include "lox.h"
 #include "parser.h"
 #include "scanner.h"
 #include "stmt.h"
@@ -53,4 +54,182 @@ TEST(GroupingTest, group_expr) {
   EXPECT_DOUBLE_EQ(n->value, 1.0);
 }
 
-} // namespace
\ No newline at end of file
+TEST(GroupingTest, deep_nesting) {
+  const int depth = 100000;
+  Scanner scanner(std::string(depth, '(') + "1.0" + std::string(depth, ')') +
+                  ";");
+  auto tokens = scanner.scanTokens();
+
+  Parser parser(tokens);
+  std::vector<Stmt *> statements = parser.parse();
+  EXPECT_EQ(statements.size(), 1);
+  Expression *expr = dynamic_cast<Expression *>(statements[0]);
+  Expr *e = expr->expression;
+  for (int i = 0; i < depth; i++) {
+    ASSERT_EQ(e->get_type(), GROUPING);
+    e = dynamic_cast<Grouping *>(e)->expression;
+  }
+  EXPECT_EQ(e->get_type(), PRIMITIVENUMBER);
+  delete statements[0];
+}
+
+TEST(AssignTest, right_associative) {
+  Scanner scanner("a = b = 1 + 2;");
+  auto tokens = scanner.scanTokens();
+
+  Parser parser(tokens);
+  std::vector<Stmt *> statements = parser.parse();
+  EXPECT_EQ(statements.size(), 1);
+  Expression *expr = dynamic_cast<Expression *>(statements[0]);
+  Assign *a = dynamic_cast<Assign *>(expr->expression);
+  Assign *b = dynamic_cast<Assign *>(a->value);
+
+  EXPECT_EQ(a->name.lexeme, "a");
+  EXPECT_EQ(b->name.lexeme, "b");
+  EXPECT_EQ(b->value->get_type(), BINARY);
+}
+
+TEST(LazyBlockTest, records_body) {
+  Scanner scanner("{ var a = 1; { print a; } } {}");
+  auto tokens = scanner.scanTokens();
+
+  Parser parser(tokens);
+  parser.lazy_blocks = true;
+  std::vector<Stmt *> statements = parser.parse();
+  EXPECT_EQ(statements.size(), 2);
+  Block *outer = dynamic_cast<Block *>(statements[0]);
+  EXPECT_TRUE(outer->statements.empty());
+  EXPECT_EQ(outer->body.end - outer->body.begin, 10);
+  Block *empty = dynamic_cast<Block *>(statements[1]);
+  EXPECT_EQ(empty->body.tokens, nullptr);
+
+  std::vector<Stmt *> body;
+  EXPECT_TRUE(Parser::parse_body(outer->body, body));
+  EXPECT_EQ(body.size(), 2);
+  Block *inner = dynamic_cast<Block *>(body[1]);
+  EXPECT_TRUE(inner->statements.empty());
+  EXPECT_NE(inner->body.tokens, nullptr);
+  for (Stmt *stmt : body)
+    delete stmt;
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST(LazyBlockTest, strict_reports_errors) {
+  Scanner scanner("{ { print 1 } }");
+  auto tokens = scanner.scanTokens();
+
+  Lox::had_error = false;
+  Parser lazy(tokens);
+  lazy.lazy_blocks = true;
+  std::vector<Stmt *> statements = lazy.parse();
+  EXPECT_FALSE(Lox::had_error);
+  delete statements[0];
+
+  Parser strict(tokens);
+  strict.lazy_blocks = true;
+  strict.strict_blocks = true;
+  statements = strict.parse();
+  EXPECT_TRUE(Lox::had_error);
+  delete statements[0];
+  Lox::had_error = false;
+}
+
+TEST(ControlFlowTest, for_becomes_while) {
+  Scanner scanner("for (var i = 0; i < 3; i = i + 1) print i;\n"
+                  "for (;;) {}\n"
+                  "if (true) print 1; else if (false) print 2;");
+  auto tokens = scanner.scanTokens();
+
+  Parser parser(tokens);
+  std::vector<Stmt *> statements = parser.parse();
+  ASSERT_EQ(statements.size(), 3);
+  // The initializer is scoped by a block around the loop.
+  Block *scope = dynamic_cast<Block *>(statements[0]);
+  ASSERT_NE(scope, nullptr);
+  ASSERT_EQ(scope->statements.size(), 2);
+  EXPECT_NE(dynamic_cast<Var *>(scope->statements[0]), nullptr);
+  While *loop = dynamic_cast<While *>(scope->statements[1]);
+  ASSERT_NE(loop, nullptr);
+  EXPECT_EQ(loop->condition->get_type(), BINARY);
+  EXPECT_EQ(loop->increment->get_type(), ASSIGN);
+  EXPECT_NE(dynamic_cast<Print *>(loop->body), nullptr);
+
+  While *forever = dynamic_cast<While *>(statements[1]);
+  ASSERT_NE(forever, nullptr);
+  EXPECT_TRUE(dynamic_cast<PrimitiveBool *>(forever->condition)->value);
+  EXPECT_EQ(forever->increment, nullptr);
+
+  If *branch = dynamic_cast<If *>(statements[2]);
+  ASSERT_NE(branch, nullptr);
+  EXPECT_NE(dynamic_cast<If *>(branch->else_branch), nullptr);
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST(ControlFlowTest, reports_errors) {
+  const char *sources[] = {"if true print 1;", "while (1 print 1;",
+                           "for (var i = 0 i < 1;) print i;",
+                           "for (;; print 1;", "if (1) var a = 1;"};
+  for (const char *source : sources) {
+    Scanner scanner(source);
+    Lox::had_error = false;
+    Parser parser(scanner.scanTokens());
+    for (Stmt *stmt : parser.parse())
+      delete stmt;
+    EXPECT_TRUE(Lox::had_error) << source;
+  }
+  Lox::had_error = false;
+}
+
+Expr *printed(Stmt *stmt) { return dynamic_cast<Print *>(stmt)->expression; }
+
+TEST(ShareExprsTest, shares_equal_subtrees) {
+  Scanner scanner("print 1 + 2 * 3;\n"
+                  "print 1 + 2 * 3;\n"
+                  "print a * a;\n"
+                  "print a - 1;\n"
+                  "print a - 1;\n"
+                  "a = 2 * 3;\n"
+                  "a = 2 * 3;\n");
+  std::vector<Stmt *> statements;
+  {
+    Parser parser(scanner.scanTokens());
+    parser.share_exprs = true;
+    statements = parser.parse();
+    ASSERT_EQ(statements.size(), 7);
+    EXPECT_EQ(printed(statements[0]), printed(statements[1]));
+    Binary *square = dynamic_cast<Binary *>(printed(statements[2]));
+    EXPECT_EQ(square->left, square->right);
+    // a may be undefined, and the error must report the right line.
+    EXPECT_NE(printed(statements[3]), printed(statements[4]));
+    EXPECT_EQ(dynamic_cast<Binary *>(printed(statements[3]))->right,
+              dynamic_cast<Binary *>(printed(statements[4]))->right);
+    // Assignments are never shared, the values they assign are.
+    Assign *first = dynamic_cast<Assign *>(
+        dynamic_cast<Expression *>(statements[5])->expression);
+    Assign *second = dynamic_cast<Assign *>(
+        dynamic_cast<Expression *>(statements[6])->expression);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first->value,
+              dynamic_cast<Binary *>(printed(statements[0]))->right);
+    EXPECT_EQ(first->value, second->value);
+    EXPECT_EQ(parser.shared_count(), 14);
+    EXPECT_GT(parser.shared_bytes(), 0);
+  }
+  // The shared nodes outlive the parser, and go with their last parent.
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST(ShareExprsTest, off_by_default) {
+  Scanner scanner("print 1;\nprint 1;");
+  Parser parser(scanner.scanTokens());
+  std::vector<Stmt *> statements = parser.parse();
+  EXPECT_NE(printed(statements[0]), printed(statements[1]));
+  EXPECT_EQ(parser.shared_count(), 0);
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+} // namespace
@@ -0,0 +1,46 @@
+#include "perf_counters.h"
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(PerfCountersTest, sums_and_prints_samples) {
+  PerfSample a, b;
+  for (int e = 0; e < PERF_EVENTS; e++) {
+    a.counts[e] = 100 * (e + 1);
+    b.counts[e] = e + 1;
+  }
+  b.counts[PERF_LLC_MISSES] = -1;
+  a += b;
+  EXPECT_EQ(a.counts[PERF_CYCLES], 101);
+  EXPECT_EQ(a.counts[PERF_INSTRUCTIONS], 202);
+  // An event missing from either sample is missing from the sum.
+  EXPECT_EQ(a.counts[PERF_LLC_MISSES], -1);
+
+  std::ostringstream out;
+  a.print(out, 101);
+  EXPECT_EQ(out.str(), "cycles=101, instructions=202, branch misses=303, "
+                       "L1D misses=404, LLC misses=n/a, IPC=2, "
+                       "branch misses/node=3, L1D misses/node=4");
+}
+
+TEST(PerfCountersTest, counts_or_explains_why_not) {
+  PerfCounters counters;
+  counters.start();
+  volatile double x = 0;
+  for (int i = 0; i < 100000; i++)
+    x = x + i;
+  PerfSample sample = counters.stop();
+  if (!counters.available()) {
+    EXPECT_FALSE(counters.error().empty());
+    for (int e = 0; e < PERF_EVENTS; e++)
+      EXPECT_EQ(sample.counts[e], -1);
+    return;
+  }
+  for (int e = 0; e < PERF_EVENTS; e++)
+    EXPECT_GE(sample.counts[e], -1);
+}
+
+} // namespace
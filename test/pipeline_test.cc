@@ -0,0 +1,102 @@
+#include "lox.h"
+#include "parser.h"
+#include "scanner.h"
+#include "scanner_thread.h"
+#include "spsc_ring.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST(SpscRingTest, keeps_order_across_threads) {
+  SpscRing<std::string, 8> ring;
+  const int count = 100000;
+  std::thread producer([&]() {
+    for (int i = 0; i < count; i++)
+      ring.push(std::to_string(i));
+  });
+  for (int i = 0; i < count; i++)
+    ASSERT_EQ(ring.pop(), std::to_string(i));
+  producer.join();
+  EXPECT_FALSE(ring.try_pop());
+}
+
+// Parses source scanning first, or pipelined, and returns what was printed
+// and a line per token. With strict, block bodies are parsed lazily, but
+// checked up front.
+std::string parse(const std::string &source, bool pipelined,
+                  bool strict = false) {
+  std::shared_ptr<std::vector<Token>> tokens;
+  std::unique_ptr<ScannerThread> scanner_thread;
+  testing::internal::CaptureStdout();
+  if (pipelined) {
+    scanner_thread = std::make_unique<ScannerThread>(source);
+    tokens = std::make_shared<std::vector<Token>>();
+  } else {
+    Scanner scanner(source);
+    tokens = scanner.scanTokens();
+  }
+  Parser parser(tokens);
+  parser.lazy_blocks = parser.strict_blocks = strict;
+  if (pipelined)
+    parser.stream = &scanner_thread->tokens();
+  std::vector<Stmt *> statements = parser.parse();
+  if (pipelined)
+    scanner_thread->join();
+  std::string result = testing::internal::GetCapturedStdout();
+
+  result += std::to_string(statements.size()) + " statements\n";
+  for (Token &token : *tokens)
+    result += token.to_string() + " " + std::to_string(token.line) + "\n";
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return result;
+}
+
+TEST(PipelineTest, parses_like_scanning_first) {
+  std::string source;
+  for (int i = 0; i < 5000; i++)
+    source += "var v" + std::to_string(i) + " = \"s\" + " + std::to_string(i) +
+              " * (1 - v);\n{ print v" + std::to_string(i) + "; }\n";
+  EXPECT_EQ(parse(source, true), parse(source, false));
+}
+
+TEST(PipelineTest, reports_errors_in_the_same_order) {
+  // A syntax error near the start, then scanner errors further on.
+  std::string source = "print 1 +;\n";
+  for (int i = 0; i < 3000; i++)
+    source += "print " + std::to_string(i) + ";\n";
+  source += "print @;\nvar = 2;\nprint \"open;\n";
+
+  Lox::had_error = false;
+  std::string pipelined = parse(source, true);
+  EXPECT_TRUE(Lox::had_error);
+  Lox::had_error = false;
+  EXPECT_EQ(pipelined, parse(source, false));
+  EXPECT_NE(pipelined.find("Unexpected character"), std::string::npos);
+  Lox::had_error = false;
+
+  // Errors in the bodies of strict blocks are held back as well.
+  source = "{ print ; }\n" + source;
+  pipelined = parse(source, true, true);
+  Lox::had_error = false;
+  EXPECT_EQ(pipelined, parse(source, false, true));
+  EXPECT_LT(pipelined.find("Unexpected character"),
+            pipelined.find("Expect expression"));
+  Lox::had_error = false;
+}
+
+TEST(PipelineTest, stops_early_without_blocking) {
+  std::string source;
+  for (int i = 0; i < 20000; i++)
+    source += "print " + std::to_string(i) + ";\n";
+  // The scanner blocks on the full ring until the consumer drains it.
+  ScannerThread scanner_thread(source);
+  EXPECT_EQ(scanner_thread.tokens().pop().type, PRINT);
+}
+
+} // namespace
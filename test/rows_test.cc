@@ -0,0 +1,75 @@
+#include "parser.h"
+#include "rows.h"
+#include "scanner.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "test_helpers.h"
+
+namespace {
+
+// Writes contents to a temporary file and returns its path.
+std::string write_rows(const std::string &contents) {
+  char path[] = "/tmp/rows_testXXXXXX";
+  int fd = mkstemp(path);
+  close(fd);
+  std::ofstream(path) << contents;
+  return path;
+}
+
+TEST(RowsTest, defines_columns_as_globals) {
+  std::string path = write_rows("a,b,name\n1,2,x\n3.5,-4,\"y, z\"\r\n\n5,,w\n");
+  std::vector<Stmt *> statements = parse("print a; print b == nil; print name;");
+
+  RowRunner runner(statements);
+  std::ostringstream out, err;
+  EXPECT_TRUE(runner.run(path.c_str(), out, err));
+
+  EXPECT_EQ(runner.rows, 3);
+  EXPECT_EQ(out.str(), "1.000000\n0\nx\n"
+                       "3.500000\n0\ny, z\n"
+                       "5.000000\n1\nw\n");
+  EXPECT_EQ(err.str(), "");
+  remove(path.c_str());
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST(RowsTest, threads_keep_row_order) {
+  std::string contents = "x,y\n";
+  for (int i = 0; i < 5000; i++)
+    contents += std::to_string(i) + "," + std::to_string(i % 7) + "\n";
+  std::string path = write_rows(contents);
+  std::vector<Stmt *> statements = parse("var z = x / y; print z * y;");
+
+  RowRunner serial(statements);
+  std::ostringstream serial_out, serial_err;
+  serial.run(path.c_str(), serial_out, serial_err);
+
+  RowRunner parallel(statements);
+  parallel.threads = 4;
+  std::ostringstream parallel_out, parallel_err;
+  parallel.run(path.c_str(), parallel_out, parallel_err);
+
+  EXPECT_EQ(parallel_out.str(), serial_out.str());
+  EXPECT_EQ(parallel_err.str(), serial_err.str());
+  // Every seventh row divides by zero, without affecting the others.
+  EXPECT_EQ(parallel.failed_rows, 715);
+  EXPECT_EQ(serial_err.str().substr(0, 54),
+            "[row 1] [line 1] RuntimeError: Attempt to divide by ze");
+  remove(path.c_str());
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST(RowsTest, missing_file) {
+  std::vector<Stmt *> statements;
+  RowRunner runner(statements);
+  std::ostringstream out, err;
+  EXPECT_FALSE(runner.run("/nonexistent/rows.csv", out, err));
+}
+
+} // namespace
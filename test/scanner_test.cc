@@ -1,7 +1,9 @@
 #include "scanner.h"
+#include "utf8.h"
 
 #include "gtest/gtest.h"
 #include <iostream>
+#include <random>
 
 namespace {
 
@@ -89,4 +91,141 @@ TEST(ScannerTest, expression) {
   EXPECT_EQ((*tokens)[10].type, STRING);
 }
 
+TEST(ScannerTest, unicode_identifier) {
+  // Letters may start an identifier, combining marks and digits only
+  // continue one; strings hold any UTF-8.
+  Scanner scanner("var \u00e9t\u00e9_2 = \"\u65e5\u672c\"; \u0394x\u0301\u0663;"
+                  " \u2603;");
+  auto tokens = scanner.scanTokens();
+
+  EXPECT_EQ(scanner.error_count(), 1);
+  ASSERT_EQ(tokens->size(), 9);
+  EXPECT_EQ((*tokens)[1].type, IDENTIFIER);
+  EXPECT_EQ((*tokens)[1].lexeme, "\u00e9t\u00e9_2");
+  EXPECT_EQ((*tokens)[3].type, STRING);
+  EXPECT_EQ(std::dynamic_pointer_cast<LiteralString>((*tokens)[3].literal)->value,
+            "\u65e5\u672c");
+  EXPECT_EQ((*tokens)[5].type, IDENTIFIER);
+  EXPECT_EQ((*tokens)[5].lexeme, "\u0394x\u0301\u0663");
+  // The snowman is skipped as one unexpected character.
+  EXPECT_EQ((*tokens)[7].type, SEMICOLON);
+}
+
+TEST(ScannerTest, invalid_utf8) {
+  // A truncated sequence in a string, followed by valid code.
+  Scanner scanner("var a = 1;\nprint \"x\xe2\x82\"; var b = 2;");
+  testing::internal::CaptureStdout();
+  auto tokens = scanner.scanTokens();
+  EXPECT_EQ(testing::internal::GetCapturedStdout(),
+            "[line 2, column 9] Error: Invalid UTF-8.\n");
+
+  // The sequence is reported once and the code after it is scanned.
+  EXPECT_EQ(scanner.error_count(), 1);
+  ASSERT_EQ(tokens->size(), 14);
+  EXPECT_EQ((*tokens)[6].type, STRING);
+  EXPECT_EQ(std::dynamic_pointer_cast<LiteralString>((*tokens)[6].literal)->value,
+            "x\ufffd");
+  EXPECT_EQ((*tokens)[9].lexeme, "b");
+  EXPECT_EQ((*tokens)[9].line, 2);
+
+  // Outside strings, each bad sequence is skipped with one error and ends an
+  // identifier it follows.
+  Scanner outside("a\xff\xff b \x80\x80 c\xc3");
+  testing::internal::CaptureStdout();
+  tokens = outside.scanTokens();
+  testing::internal::GetCapturedStdout();
+  EXPECT_EQ(outside.error_count(), 4);
+  ASSERT_EQ(tokens->size(), 4);
+  EXPECT_EQ((*tokens)[0].lexeme, "a");
+  EXPECT_EQ((*tokens)[1].lexeme, "b");
+  EXPECT_EQ((*tokens)[2].lexeme, "c");
+}
+
+TEST(ScannerTest, token_positions) {
+  Scanner scanner("var a =\n  \"two\nlines\" +\n\n   b @;");
+  testing::internal::CaptureStdout();
+  auto tokens = scanner.scanTokens();
+  EXPECT_EQ(testing::internal::GetCapturedStdout(),
+            "[line 5, column 6] Error: Unexpected character.\n");
+
+  ASSERT_EQ(tokens->size(), 8);
+  EXPECT_EQ((*tokens)[2].offset, 6);
+  EXPECT_EQ((*tokens)[2].line, 1);
+  // A string spanning lines is on the line it ends on.
+  EXPECT_EQ((*tokens)[3].offset, 10);
+  EXPECT_EQ((*tokens)[3].line, 3);
+  EXPECT_EQ(scanner.line_index()->line(scanner.token_starts()[3].offset), 2);
+  EXPECT_EQ((*tokens)[4].line, 3);
+  EXPECT_EQ((*tokens)[5].offset, 28);
+  EXPECT_EQ((*tokens)[5].line, 5);
+  EXPECT_EQ((*tokens)[7].type, EOFL);
+  EXPECT_EQ((*tokens)[7].line, 5);
+}
+
+TEST(ScannerTest, line_index) {
+  // Newlines at every offset of a few 16 byte blocks, with the lines and
+  // columns counted one byte at a time.
+  std::mt19937 random(48);
+  for (int round = 0; round < 200; round++) {
+    std::string source;
+    size_t size = random() % 80;
+    for (size_t i = 0; i < size; i++)
+      source += random() % 4 == 0 ? '\n' : 'x';
+    LineIndex index(source);
+    int line = 1, column = 1;
+    size_t hint = 0;
+    for (size_t i = 0; i <= size; i++) {
+      EXPECT_EQ(index.line(i), line) << source << " " << i;
+      EXPECT_EQ(index.line(i, hint), line);
+      EXPECT_EQ(index.column(i), column);
+      if (i < size && source[i] == '\n')
+        line++, column = 1;
+      else
+        column++;
+    }
+    // The hint still works when offsets go back.
+    EXPECT_EQ(index.line(0, hint), 1);
+  }
+
+  // Offsets past 2 GiB, as in a script that large, do not wrap around.
+  LineIndex index("a\nb");
+  int64_t far = int64_t(3) << 30;
+  EXPECT_EQ(index.line(far), 2);
+  EXPECT_EQ(index.column(far), far - 1);
+}
+
+TEST(ScannerTest, utf8_validation) {
+  const std::vector<std::string> cases = {
+      "", "plain ascii", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+      "\xf4\x8f\xbf\xbf",
+      // Truncated, overlong, surrogate, too large, stray continuation.
+      "\xc3", "\xe2\x82", "\xc0\xaf", "\xe0\x80\xaf", "\xed\xa0\x80",
+      "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\x80", "a\xbf"};
+  // Every case at every offset of a 48 byte block, so that sequences
+  // straddle the 16 byte blocks of the SIMD check.
+  for (const std::string &c : cases) {
+    for (size_t pad = 0; pad < 48; pad++) {
+      std::string data = std::string(pad, 'x') + c + std::string(pad % 5, 'y');
+      EXPECT_EQ(utf8_error_offset(data.data(), data.size()),
+                utf8_error_offset_scalar(data.data(), data.size()))
+          << pad;
+    }
+  }
+  EXPECT_EQ(utf8_error_offset_scalar("ab\xc3", 3), 2);
+
+  // Random mixes of valid sequences with some bytes flipped.
+  std::mt19937 random(47);
+  const std::vector<std::string> pieces = {"a", "\n", "\xc3\xa9", "\xe6\x97\xa5",
+                                           "\xf0\x9f\x98\x80"};
+  for (int round = 0; round < 2000; round++) {
+    std::string data;
+    while (data.size() < 100)
+      data += pieces[random() % pieces.size()];
+    if (round % 2)
+      data[random() % data.size()] = char(random());
+    EXPECT_EQ(utf8_error_offset(data.data(), data.size()),
+              utf8_error_offset_scalar(data.data(), data.size()));
+  }
+}
+
 } // namespace
@@ -0,0 +1,109 @@
+#include "heap.h"
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+#include "snapshot.h"
+
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "test_helpers.h"
+
+namespace {
+
+std::string temp_path() {
+  char path[] = "/tmp/snapshot_testXXXXXX";
+  close(mkstemp(path));
+  return path;
+}
+
+TEST(SnapshotTest, restores_every_kind_of_value) {
+  std::string path = temp_path(), error;
+  {
+    Interpreter prelude;
+    run(prelude, "var n = 1.5; var s = \"multi\nline\"; var t = true;\n"
+                 "var f = false; var z = nil; var e = \"\";\n"
+                 "{ var local = 1; n = n * 2; }\n");
+    ASSERT_TRUE(Snapshot::save(prelude, path, error)) << error;
+  }
+
+  Interpreter job;
+  run(job, "var n = 7; var other = 1;");
+  ASSERT_TRUE(Snapshot::load(job, path, error)) << error;
+  // Saved globals overwrite, the others stay.
+  EXPECT_EQ(run(job, "print n; print s; print t; print f; print z;"
+                     "print e == \"\"; print other;"),
+            "3.000000\nmulti\nline\n1\n0\nnil\n1\n1.000000\n");
+  EXPECT_EQ(job.global_environment().bindings().count("local"), 0);
+  unlink(path.c_str());
+}
+
+TEST(SnapshotTest, rejects_damaged_files) {
+  std::string path = temp_path(), error;
+  Interpreter prelude;
+  run(prelude, "var a = \"abc\"; var b = 2;");
+  ASSERT_TRUE(Snapshot::save(prelude, path, error)) << error;
+  std::string bytes;
+  {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    bytes = buffer.str();
+  }
+  auto load = [&](const std::string &contents) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+    Interpreter job;
+    bool loaded = Snapshot::load(job, path, error);
+    // Nothing is defined from a damaged file.
+    EXPECT_TRUE(loaded || job.global_environment().bindings().empty());
+    return loaded;
+  };
+
+  EXPECT_TRUE(load(bytes));
+  EXPECT_FALSE(load(bytes.substr(0, bytes.size() - 1)));
+  EXPECT_EQ(error, "the snapshot is truncated");
+  EXPECT_FALSE(load("print 1;\n" + bytes));
+  EXPECT_EQ(error, "not a snapshot");
+
+  // Point the string of the first entry past the end.
+  std::string corrupt = bytes;
+  Snapshot::Entry entry;
+  memcpy(&entry, &corrupt[sizeof(Snapshot::Header)], sizeof(entry));
+  entry.string_length = bytes.size();
+  memcpy(&corrupt[sizeof(Snapshot::Header)], &entry, sizeof(entry));
+  EXPECT_FALSE(load(corrupt));
+  EXPECT_EQ(error, "entry 0 of the snapshot is corrupt");
+
+  unlink(path.c_str());
+  EXPECT_FALSE(Snapshot::load(prelude, path, error));
+}
+
+TEST(SnapshotTest, stays_within_the_heap_limit) {
+  std::string path = temp_path(), error;
+  Interpreter prelude;
+  run(prelude, "var a = 1; var b = \"" + std::string(1000, 'b') +
+                   "\"; var c = 3;");
+  ASSERT_TRUE(Snapshot::save(prelude, path, error)) << error;
+
+  // Loaded one by one, a would be overwritten before b exceeded the limit.
+  Interpreter job;
+  run(job, "var a = 7;");
+  size_t used = Heap::total();
+  Heap::set_limit(used + 500);
+  EXPECT_FALSE(Snapshot::load(job, path, error));
+  EXPECT_EQ(error, "its globals take more than the heap limit of " +
+                       std::to_string(used + 500) + " bytes");
+  EXPECT_EQ(Heap::total(), used);
+  EXPECT_EQ(run(job, "print a;"), "7.000000\n");
+  EXPECT_EQ(job.global_environment().bindings().size(), 1);
+
+  Heap::set_limit(used + 5000);
+  EXPECT_TRUE(Snapshot::load(job, path, error)) << error;
+  EXPECT_EQ(run(job, "print a; print c;"), "1.000000\n3.000000\n");
+  Heap::set_limit(0);
+  unlink(path.c_str());
+}
+
+} // namespace
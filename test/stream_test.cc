@@ -0,0 +1,137 @@
+#include "heap.h"
+#include "interpreter.h"
+#include "lox.h"
+#include "parser.h"
+#include "scanner.h"
+#include "stream.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "test_helpers.h"
+
+namespace {
+
+struct Streamed {
+  // What was printed, then the syntax errors and runtime errors.
+  std::string output;
+  size_t declarations;
+  size_t statements_run;
+  size_t max_ast_bytes;
+};
+
+Streamed stream(const std::string &source) {
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  StreamRunner runner(interpreter);
+  testing::internal::CaptureStdout();
+  testing::internal::CaptureStderr();
+  runner.run(source);
+  std::string errors = testing::internal::GetCapturedStdout();
+  errors += testing::internal::GetCapturedStderr();
+  return {out.str() + errors, runner.declarations, runner.statements_run,
+          runner.max_ast_bytes};
+}
+
+TEST(StreamTest, runs_like_a_full_parse) {
+  std::string source = "var sum = 0;\nvar s = \"\";\n";
+  for (int i = 0; i < 2000; i++) {
+    std::string n = std::to_string(i);
+    source += "sum = sum + " + n + " * 0.5;\n{ var x = sum; s = \"v" + n +
+              "\"; }\nif (sum > " + n + ") print s; else print sqrt(sum);\n";
+  }
+  source += "var i = 0;\nwhile (i < 3) { print i; i = i + 1; }\nprint sum;\n";
+  Streamed streamed = stream(source);
+  // What source prints when it is parsed whole first.
+  EXPECT_EQ(streamed.output, run(source));
+  Heap::clear(HEAP_AST);
+  Heap::clear(HEAP_TOKENS);
+  EXPECT_EQ(streamed.declarations, 6005);
+  EXPECT_EQ(streamed.statements_run, 6005);
+}
+
+TEST(StreamTest, holds_one_declaration_at_a_time) {
+  std::string statement = "print (1 + 2) * 3 - \"a\" == \"b\" or 4 / 5;\n";
+  std::string source;
+  for (int i = 0; i < 50000; i++)
+    source += statement;
+  // A large statement in the middle.
+  std::string large = "print 0";
+  for (int i = 0; i < 1000; i++)
+    large += " + " + std::to_string(i);
+  source += large + ";\n" + source;
+
+  Heap::reset_peak();
+  Streamed streamed = stream(source);
+  // The tokens of all of source take megabytes, the ring of tokens
+  // scanned ahead and the largest statement some hundred kilobytes.
+  EXPECT_LT(Heap::peak(), 400000);
+  EXPECT_EQ(streamed.declarations, 100001);
+
+  Scanner scanner(large + ";");
+  Parser parser(scanner.scanTokens());
+  int position = 0;
+  size_t charged = Heap::used(HEAP_AST);
+  delete parser.parse_declaration(position);
+  EXPECT_EQ(streamed.max_ast_bytes, Heap::used(HEAP_AST) - charged);
+  Heap::clear(HEAP_AST);
+  Heap::clear(HEAP_TOKENS);
+}
+
+TEST(StreamTest, runs_up_to_the_first_syntax_error) {
+  // Every syntax error is still reported.
+  Lox::had_error = false;
+  EXPECT_EQ(stream("print 1;\nprint 2 +;\nprint 3;\nvar = 4;\n").output,
+            "1.000000\n"
+            "[line 2, column 10] Error at ';': Expect expression.\n"
+            "[line 4, column 5] Error at '=': Expect variable name\n");
+  EXPECT_TRUE(Lox::had_error);
+
+  // Scanner errors stop the statement they are in, not those before it.
+  Lox::had_error = false;
+  EXPECT_EQ(stream("print 1;\nprint 2;\nprint 3 @;\nprint 4;\n").output,
+            "1.000000\n2.000000\n"
+            "[line 3, column 9] Error: Unexpected character.\n");
+  EXPECT_TRUE(Lox::had_error);
+  Lox::had_error = false;
+}
+
+TEST(StreamTest, prints_errors_in_order_with_the_output) {
+  // The scanner runs ahead, but its errors come when parsing reaches them.
+  std::string source;
+  for (int i = 0; i < 1000; i++)
+    source += "print " + std::to_string(i % 10) + ";\n";
+  source += "print 1 @;\nprint 2 +;\n$ print 3;\n";
+  std::string expected;
+  for (int i = 0; i < 1000; i++)
+    expected += std::to_string(i % 10) + ".000000\n";
+  expected += "[line 1001, column 9] Error: Unexpected character.\n"
+              "[line 1002, column 10] Error at ';': Expect expression.\n"
+              "[line 1003, column 1] Error: Unexpected character.\n";
+
+  for (int i = 0; i < 10; i++) {
+    Interpreter interpreter;
+    interpreter.set_output(std::cout);
+    StreamRunner runner(interpreter);
+    testing::internal::CaptureStdout();
+    runner.run(source);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), expected);
+  }
+  Lox::had_error = false;
+}
+
+TEST(StreamTest, stops_at_a_runtime_error) {
+  Lox::had_runtime_error = false;
+  Streamed streamed = stream("print 1;\nprint -\"a\";\nprint 2;\nprint 3;\n");
+  EXPECT_EQ(streamed.output,
+            "1.000000\n[line 2] RuntimeError: Operand must be a number.\n");
+  EXPECT_TRUE(Lox::had_runtime_error);
+  EXPECT_EQ(streamed.statements_run, 1);
+  Lox::had_runtime_error = false;
+}
+
+} // namespace
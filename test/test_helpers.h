@@ -0,0 +1,56 @@
+#ifndef TEST_HELPERS_H_
+#define TEST_HELPERS_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+
+// Parses source, with lazy, leaving block bodies for when they first run.
+inline std::vector<Stmt *> parse(const std::string &source,
+                                 bool lazy = false) {
+  Scanner scanner(source);
+  Parser parser(scanner.scanTokens());
+  parser.lazy_blocks = lazy;
+  return parser.parse();
+}
+
+// Returns the output of statements run by interpreter, followed by the
+// runtime error, if any.
+inline std::string run(Interpreter &interpreter,
+                       const std::vector<Stmt *> &statements) {
+  std::ostringstream out;
+  interpreter.set_output(out);
+  try {
+    interpreter.execute_statements(statements);
+  } catch (RuntimeError e) {
+    out << "[line " << e.op.line << "] " << e.what();
+  }
+  return out.str();
+}
+
+inline std::string run(const std::vector<Stmt *> &statements) {
+  Interpreter interpreter;
+  return run(interpreter, statements);
+}
+
+// Parses and runs source like the above, then frees its statements.
+inline std::string run(Interpreter &interpreter, const std::string &source,
+                       bool lazy = false) {
+  std::vector<Stmt *> statements = parse(source, lazy);
+  std::string output = run(interpreter, statements);
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return output;
+}
+
+inline std::string run(const std::string &source, bool lazy = false) {
+  Interpreter interpreter;
+  return run(interpreter, source, lazy);
+}
+
+#endif // TEST_HELPERS_H_
@@ -0,0 +1,59 @@
+#include "interpreter.h"
+#include "parser.h"
+#include "scanner.h"
+#include "trace.h"
+
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::string read(const std::string &path) {
+  std::ifstream in(path);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  return buffer.str();
+}
+
+TEST(TraceTest, records_spans_with_counters) {
+  char path[] = "/tmp/trace_testXXXXXX";
+  close(mkstemp(path));
+  ASSERT_TRUE(Trace::start(path));
+
+  Scanner scanner("var a = 1;\nprint a;\n{ a = 2; }\n");
+  std::vector<Stmt *> statements;
+  {
+    TraceSpan span("parse");
+    Parser parser(scanner.scanTokens());
+    statements = parser.parse();
+    span.count("nodes", parser.node_count());
+  }
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  interpreter.interpret(statements);
+  Trace::write();
+
+  std::string trace = read(path);
+  EXPECT_EQ(trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["), 0);
+  EXPECT_NE(trace.find("{\"name\":\"parse\",\"cat\":\"phase\",\"ph\":\"X\""),
+            std::string::npos);
+  EXPECT_NE(trace.find("\"args\":{\"nodes\":"), std::string::npos);
+  EXPECT_NE(trace.find("{\"name\":\"parse nodes\",\"ph\":\"C\""),
+            std::string::npos);
+  EXPECT_NE(trace.find("{\"name\":\"peak_rss_kib\",\"ph\":\"C\""),
+            std::string::npos);
+  EXPECT_NE(trace.find("{\"name\":\"var a\",\"cat\":\"statement\""),
+            std::string::npos);
+  EXPECT_NE(trace.find("\"args\":{\"index\":2,"), std::string::npos);
+  EXPECT_NE(trace.find("{\"name\":\"block\""), std::string::npos);
+  EXPECT_EQ(trace.substr(trace.size() - 4), "\n]}\n");
+  for (Stmt *stmt : statements)
+    delete stmt;
+  unlink(path);
+}
+
+} // namespace
@@ -0,0 +1,121 @@
+#include "interpreter.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+#include "type_inference.h"
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "test_helpers.h"
+
+namespace {
+
+// Infers the types of source, checks that it behaves as before and returns
+// the report.
+std::string infer(const std::string &source, bool closed_globals = true,
+                  bool lazy = false) {
+  std::vector<Stmt *> statements = parse(source, lazy);
+  std::string expected = run(statements);
+  TypeInference inference(closed_globals);
+  inference.infer(statements);
+  EXPECT_EQ(run(statements), expected) << source;
+
+  std::ostringstream report;
+  inference.report(report);
+  for (Stmt *stmt : statements)
+    delete stmt;
+  return report.str();
+}
+
+Expr *printed(Stmt *stmt) { return dynamic_cast<Print *>(stmt)->expression; }
+
+TEST(TypeInferenceTest, proves_numbers_and_strings) {
+  std::vector<Stmt *> statements =
+      parse("var i = 0; var s = \"a\"; var b = i < 1;\n"
+            "while (i < 10) { var j = i * 2; i = j - i + 1; s = s + \"b\"; }\n"
+            "print i; print s; print b; print -i;");
+  TypeInference inference(true);
+  inference.infer(statements);
+  EXPECT_EQ(printed(statements[4])->static_type, VALNUMBER);
+  EXPECT_EQ(printed(statements[5])->static_type, VALSTRING);
+  EXPECT_EQ(printed(statements[6])->static_type, VALBOOL);
+  EXPECT_EQ(printed(statements[7])->static_type, VALNUMBER);
+  EXPECT_EQ(inference.variables, 4);
+  EXPECT_EQ(inference.number_variables, 2);
+  EXPECT_EQ(inference.string_variables, 1);
+  // i < 1, i < 10, i * 2, j - i, ... + 1 and -i, but not s + "b".
+  EXPECT_EQ(inference.operations, 7);
+  EXPECT_EQ(inference.specialized, 6);
+  EXPECT_EQ(run(statements), "10.000000\nabbbbbbbbbb\n1\n-10.000000\n");
+  for (Stmt *stmt : statements)
+    delete stmt;
+}
+
+TEST(TypeInferenceTest, falls_back_to_dynamic_types) {
+  // Mixed stores, a later store in a loop, an uninitialized variable.
+  EXPECT_EQ(infer("var a = 1; a = \"s\"; print a + a;"),
+            "types: 0 of 1 variables are numbers, 0 strings; 0 of 1 "
+            "operations specialized\n");
+  EXPECT_EQ(infer("var a = 1; var b = 2;\nwhile (a < 3) { a = a + 1; b = \"x\"; "
+                  "}\nprint b - 1;"),
+            "types: 1 of 2 variables are numbers, 0 strings; 2 of 3 "
+            "operations specialized\n");
+  EXPECT_EQ(infer("var a; a = 1; print a * 2;"),
+            "types: 0 of 1 variables are numbers, 0 strings; 0 of 1 "
+            "operations specialized\n");
+  // A redeclaration keeps the first value, whichever it is.
+  EXPECT_EQ(infer("var a = 1; var a = \"s\"; print a;"),
+            "types: 0 of 1 variables are numbers, 0 strings; 0 of 0 "
+            "operations specialized\n");
+  // Reads before a declaration see the enclosing variable.
+  EXPECT_EQ(infer("var a = \"s\"; { print a + \"t\"; var a = 1; print -a; }"),
+            "types: 1 of 2 variables are numbers, 1 strings; 1 of 2 "
+            "operations specialized\n");
+}
+
+TEST(TypeInferenceTest, open_globals_and_lazy_blocks) {
+  // In the REPL, globals may hold anything from earlier lines.
+  EXPECT_EQ(infer("var a = 1; print a * 2; { var b = 2; print b * 2; }",
+                  false),
+            "types: 1 of 2 variables are numbers, 0 strings; 1 of 2 "
+            "operations specialized\n");
+  // An unparsed block may store anything to the variables in scope.
+  EXPECT_EQ(infer("var a = 1; { a = \"s\"; } print a;", true, true),
+            "types: 0 of 1 variables are numbers, 0 strings; 0 of 0 "
+            "operations specialized\n");
+}
+
+TEST(TypeInferenceTest, errors_stay_the_same) {
+  infer("var a = 1;\nprint a / (a - 1);");
+  infer("var a = 1;\nprint a + b;");
+  infer("var a = 1;\n{ var c = a; }\nprint c * 2;");
+  infer("var a = 1;\nwhile (a < 10) {\n  a = a * 2;\n  print a / (a - 8);\n}");
+}
+
+TEST(TypeInferenceTest, counts_the_same_steps) {
+  const std::string source =
+      "var i = 0;\nwhile (i < 1000) {\n  i = i + (2 * 3 - 5);\n}";
+  for (uint64_t max_steps : {1000, 5000, 6000, 7000}) {
+    std::string errors[2];
+    for (int inferred = 0; inferred < 2; inferred++) {
+      std::vector<Stmt *> statements = parse(source);
+      if (inferred) {
+        TypeInference inference(true);
+        inference.infer(statements);
+      }
+      Interpreter interpreter;
+      interpreter.set_budget({max_steps, 0});
+      try {
+        interpreter.execute_statements(statements);
+      } catch (RuntimeError e) {
+        errors[inferred] = e.what();
+      }
+      for (Stmt *stmt : statements)
+        delete stmt;
+    }
+    EXPECT_EQ(errors[0], errors[1]) << max_steps;
+  }
+}
+
+} // namespace
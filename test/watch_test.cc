@@ -0,0 +1,143 @@
+#include "interpreter.h"
+#include "lox.h"
+#include "parser.h"
+#include "runtime_error.h"
+#include "scanner.h"
+#include "watch.h"
+
+#include <random>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "test_helpers.h"
+
+namespace {
+
+// Updates watcher to source and checks that it ends up with the tokens and,
+// without syntax errors, the output of a full scan and parse.
+void update(Watcher &watcher, std::ostringstream &out,
+            const std::string &source) {
+  out.str("");
+  watcher.update(source);
+  bool failed = Lox::had_error;
+
+  Scanner scanner(source);
+  auto tokens = scanner.scanTokens();
+  const std::vector<Token> &reused = watcher.program_tokens();
+  ASSERT_EQ(reused.size(), tokens->size());
+  for (size_t i = 0; i < tokens->size(); i++) {
+    EXPECT_EQ(reused[i].type, (*tokens)[i].type) << i;
+    EXPECT_EQ(reused[i].lexeme, (*tokens)[i].lexeme) << i;
+    EXPECT_EQ(reused[i].line, (*tokens)[i].line) << i;
+    EXPECT_EQ(reused[i].offset, (*tokens)[i].offset) << i;
+  }
+  if (!failed) {
+    // The watcher reports runtime errors to stderr, not with the output.
+    std::string expected = run(source);
+    EXPECT_EQ(out.str(), expected.substr(0, expected.find("[line ")));
+  }
+  Lox::had_error = failed;
+}
+
+TEST(WatchTest, reuses_unchanged_statements) {
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  Watcher watcher(interpreter);
+
+  update(watcher, out, "var a = 1;\nvar b = 2;\nprint a + b;\nprint b;\n");
+  EXPECT_EQ(watcher.last_update().tokens_reused, 0);
+  EXPECT_EQ(watcher.last_update().statements, 4);
+
+  // A change in the middle of a line rescans the statement around it.
+  update(watcher, out, "var a = 1;\nvar b = 20;\nprint a + b;\nprint b;\n");
+  EXPECT_EQ(watcher.last_update().bytes_scanned, 3);
+  EXPECT_EQ(watcher.last_update().tokens_reused, 18);
+  EXPECT_EQ(watcher.last_update().statements_reused, 3);
+
+  // Lines added on top shift every later statement.
+  update(watcher, out,
+         "print 0;\n\n\nvar a = 1;\nvar b = 20;\nprint a + b;\nprint b;\n");
+  EXPECT_EQ(watcher.last_update().statements, 5);
+  EXPECT_EQ(watcher.last_update().statements_reused, 4);
+  out.str("");
+  watcher.update("print 0;\n\n\nvar a = 1;\nvar b = 20;\nprint a + c;\n");
+  EXPECT_TRUE(Lox::had_runtime_error);
+  Lox::had_runtime_error = false;
+}
+
+TEST(WatchTest, rescans_strings_and_comments) {
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  Watcher watcher(interpreter);
+
+  update(watcher, out, "var s = \"a\nb\";\n// print 1;\nprint s;\nprint 2;\n");
+  update(watcher, out, "var s = \"a\n\nb\";\n// print 1;\nprint s;\nprint 2;\n");
+  EXPECT_EQ(watcher.last_update().statements_reused, 2);
+
+  // Uncommenting a statement scans it for the first time.
+  update(watcher, out, "var s = \"a\n\nb\";\nprint 1;\nprint s;\nprint 2;\n");
+  EXPECT_EQ(watcher.last_update().statements, 4);
+  EXPECT_EQ(watcher.last_update().statements_reused, 3);
+
+  // An opened string swallows the rest of the program.
+  update(watcher, out, "var s = \"a\n\nb\";\nprint \"1;\nprint s;\nprint 2;\n");
+  EXPECT_TRUE(Lox::had_error);
+  update(watcher, out, "var s = \"a\n\nb\";\nprint \"1\";\nprint s;\nprint 2;\n");
+  EXPECT_FALSE(Lox::had_error);
+}
+
+TEST(WatchTest, recovers_from_syntax_errors) {
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  Watcher watcher(interpreter);
+
+  update(watcher, out, "{ var a = 1; print a; }\nprint 2;\n");
+  update(watcher, out, "{ var a = 1; print a }\nprint 2;\n");
+  EXPECT_TRUE(Lox::had_error);
+  update(watcher, out, "{ var a = 1; print a; }\nprint 3;\n");
+  EXPECT_FALSE(Lox::had_error);
+  EXPECT_EQ(watcher.last_update().statements_reused, 0);
+  update(watcher, out, "{ var a = 1; print a; }\nprint 4;\n");
+  EXPECT_EQ(watcher.last_update().statements_reused, 1);
+  update(watcher, out, "");
+  EXPECT_EQ(watcher.last_update().statements, 0);
+}
+
+TEST(WatchTest, matches_full_scan_after_random_edits) {
+  Interpreter interpreter;
+  std::ostringstream out;
+  interpreter.set_output(out);
+  Watcher watcher(interpreter);
+
+  // Lines inserted at line starts keep the program valid; the other pieces
+  // are inserted anywhere and taken out again right away.
+  const char *lines[] = {"\n", "  ", "print a;\n", "// x\n", "var c = a;\n",
+                         "{ var d = 2.5; print d * a; }\n"};
+  const char *pieces[] = {"\"", "//", "{", "}", ";", "=", "a", ".", "7", "!"};
+  std::mt19937 random(42);
+  std::string source = "var a = 1;\nvar b = a;\nprint a + b;\n";
+  update(watcher, out, source);
+  for (int i = 0; i < 200; i++) {
+    std::string next = source;
+    size_t at = random() % (next.size() + 1);
+    if (i % 4 != 0) {
+      while (at > 0 && next[at - 1] != '\n')
+        at--;
+      next.insert(at, lines[random() % (sizeof(lines) / sizeof(*lines))]);
+      source = next;
+    } else if (random() % 2 == 0 && at < next.size()) {
+      next.erase(at, 1);
+    } else {
+      next.insert(at, pieces[random() % (sizeof(pieces) / sizeof(*pieces))]);
+    }
+    update(watcher, out, next);
+    update(watcher, out, source);
+    ASSERT_FALSE(Lox::had_error) << source;
+  }
+  Lox::had_runtime_error = false;
+}
+
+} // namespace
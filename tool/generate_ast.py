@@ -16,9 +16,16 @@ def define_ast(output_dir, base_name, types):
         file_h.write("#define %s_H_\n\n" % base_name.upper())
         file_h.write("// Auto generated code, don't modify manually.\n")
         if base_name == "Expr":
-            file_h.write('#include <string>\n#include "token.h"\n\n')
+            file_h.write(
+                '#include <cstddef>\n#include <string>\n#include <vector>\n'
+                '#include "token.h"\n\n'
+            )
+            # Call refers to, but does not own, a native; see Natives.
+            file_h.write("struct NativeFunction;\n\n")
         else:
             file_h.write('#include <vector>\n#include "expr.h"\n\n')
+            # Import refers to, but does not own, a module; see ModuleCache.
+            file_h.write("struct Module;\n\n")
 
         if base_name == "Expr":
             define_auxiliary(file_h, type_names)
@@ -37,6 +44,9 @@ def define_ast(output_dir, base_name, types):
     with open(path_cc, "w") as file_cc:
         file_cc.write('#include <iostream>\n\n#include "%s.h"\n\n' % base_name.lower())
 
+        if base_name == "Expr":
+            file_cc.write(expr_destroy)
+
         for type_name in type_names:
             impl_type(file_cc, base_name, type_name)
 
@@ -48,7 +58,7 @@ struct ExprValue {
   double number;
   bool boolean;
   std::string string;
-  nullptr_t nil;
+  std::nullptr_t nil;
   ValueType type;
   ExprValue()
       : number(0), boolean(false), string(""), nil(nullptr), type(VALNIL) {}
@@ -77,11 +87,50 @@ def define_auxiliary(f, type_names):
     f.write(aux_class)
 
 
+# Expressions can nest hundreds of thousands of levels deep, so they are torn
+# down with an explicit stack: a node hands its children over to destroy()
+# instead of deleting them recursively. A node shared by several parents is
+# only deleted with the last of them.
+expr_destroy = """void Expr::destroy(std::vector<Expr*> &pending) {
+  while (!pending.empty()) {
+    Expr* expr = pending.back();
+    pending.pop_back();
+    if (expr->extra_owners > 0) {
+      expr->extra_owners--;
+      continue;
+    }
+    expr->release_children(pending);
+    delete expr;
+  }
+};
+
+void Expr::destroy(Expr* expr) {
+  if (expr == nullptr)
+    return;
+  std::vector<Expr*> pending{expr};
+  destroy(pending);
+};
+
+"""
+
+
 def define_base_class(f, base_name):
     f.write("class %s {\npublic:\n" % base_name)
     f.write("  virtual ~%s() {};\n" % base_name)
     if base_name == "Expr":
         f.write("  virtual ExprType get_type() = 0;\n")
+        f.write("  // Moves the child nodes into out, leaving this node without children.\n")
+        f.write("  virtual void release_children(std::vector<Expr*> &out) {};\n")
+        f.write("  // Deletes the pending nodes and all their descendants.\n")
+        f.write("  static void destroy(std::vector<Expr*> &pending);\n")
+        f.write("  // Deletes expr, which may be null, and all its descendants.\n")
+        f.write("  static void destroy(Expr* expr);\n")
+        f.write("  // Parents beyond the first sharing this node, see Parser::share_exprs.\n")
+        f.write("  // Whichever parent goes last deletes it.\n")
+        f.write("  int extra_owners = 0;\n")
+        f.write("  // The ValueType every evaluation of this node yields, or -1 when not\n")
+        f.write("  // known; see TypeInference.\n")
+        f.write("  int static_type = -1;\n")
     f.write(
         "  virtual %s accept(%sVisitor* visitor) = 0;\n};\n\n"
         % (visitor_return_type(base_name), base_name)
@@ -98,12 +147,20 @@ def define_visitor(f, base_name, type_names):
                 type_name,
                 base_name,
                 type_name,
-                type_name.lower(),
+                parameter_name(type_name),
             )
         )
     f.write("};\n\n")
 
 
+def parameter_name(type_name):
+    name = type_name.lower()
+    # Node types named after statements, e.g. If, clash with C++ keywords.
+    if name in ["if", "while", "for"]:
+        name += "_stmt"
+    return name
+
+
 def define_type(f, base_name, type_name, field_list):
     fields = field_list.split(", ")
     field_types = list(map(lambda fd: fd.split(" ")[0], fields))
@@ -127,13 +184,32 @@ def define_type(f, base_name, type_name, field_list):
             f.write(", %s(%s)" % (fn, fn))
     f.write(" {};\n\n")
 
-    # deconstructor
-    if type_name in ["Binary", "Grouping", "Unary"]:
+    # deconstructor, a node owns its child nodes.
+    children = [(ft, fn) for ft, fn in zip(field_types, field_names) if is_node(ft)]
+    if children and base_name == "Expr":
         f.write("  virtual ~%s() {\n" % type_name)
-        for ft, fn in zip(field_types, field_names):
-            if ft == "Token":
+        f.write("    std::vector<Expr*> children;\n")
+        f.write("    release_children(children);\n")
+        f.write("    destroy(children);\n")
+        f.write("  };\n")
+        f.write("  virtual void release_children(std::vector<Expr*> &out) {\n")
+        for ft, fn in children:
+            if ft.startswith("std::vector"):
+                f.write("    out.insert(out.end(), %s.begin(), %s.end());\n" % (fn, fn))
+                f.write("    %s.clear();\n" % fn)
                 continue
-            f.write("    delete %s;\n" % fn)
+            f.write("    if (%s)\n      out.push_back(%s);\n" % (fn, fn))
+            f.write("    %s = nullptr;\n" % fn)
+        f.write("  };\n")
+    elif children:
+        f.write("  virtual ~%s() {\n" % type_name)
+        for ft, fn in children:
+            if ft.startswith("std::vector"):
+                f.write("    for (auto child : %s)\n      delete child;\n" % fn)
+            elif ft == "Expr*":
+                f.write("    Expr::destroy(%s);\n" % fn)
+            else:
+                f.write("    delete %s;\n" % fn)
         f.write("  };\n")
 
     # define methods
@@ -148,6 +224,10 @@ def define_type(f, base_name, type_name, field_list):
     f.write("};\n\n")
 
 
+def is_node(field_type):
+    return field_type in ["Expr*", "Stmt*", "std::vector<Expr*>", "std::vector<Stmt*>"]
+
+
 def impl_type(f, base_name, type_name):
 
     f.write(
@@ -172,36 +252,232 @@ def visitor_return_type(base_name):
         return "void"
 
 
+# The flat form of the expressions: one array per node type, 32-bit
+# references between nodes, and no Token objects, only what evaluating a node
+# needs. The tree classes above stay for the tools that walk them.
+def flat_fields(field):
+    field_type, field_name = field.split(" ")
+    if field_type == "Expr*":
+        return [("FlatRef", field_name)]
+    if field_type == "std::vector<Expr*>":
+        # The first of the references in FlatExpr::lists, and their count.
+        return [("uint32_t", field_name), ("uint32_t", field_name + "_count")]
+    if field_type == "Token" and field_name == "op":
+        return [("TokenType", field_name), ("int", field_name + "_line")]
+    if field_type == "Token":
+        # An index into FlatExpr::strings.
+        return [("uint32_t", field_name), ("int", field_name + "_line")]
+    if field_type == "std::string":
+        return [("uint32_t", field_name)]
+    if field_type == "std::nullptr_t":
+        return []
+    return [(field_type, field_name)]
+
+
+def flat_array(type_name):
+    snake = "".join("_" + c.lower() if c.isupper() else c for c in type_name)
+    return snake[1:] + "_nodes"
+
+
+flat_ref = """// FlatRef names a node of a FlatExpr: its ExprType in the top 4 bits and its
+// index in the array of that type in the other 28.
+typedef uint32_t FlatRef;
+
+const uint32_t FLAT_INDEX_MASK = 0x0fffffff;
+
+inline FlatRef flat_ref(ExprType type, uint32_t index) {
+  return (uint32_t)type << 28 | index;
+}
+inline ExprType flat_type(FlatRef ref) { return (ExprType)(ref >> 28); }
+inline uint32_t flat_index(FlatRef ref) { return ref & FLAT_INDEX_MASK; }
+
+"""
+
+flat_class_begin = """// FlatExpr holds expressions as contiguous arrays of plain structs, one
+// array per node type, instead of individually allocated nodes. Names and
+// string literals are interned in strings.
+class FlatExpr {
+public:
+  // Appends a copy of expr and its descendants and returns the reference to
+  // the copy of expr.
+  FlatRef add(Expr *expr);
+  // The number of nodes and the bytes of their arrays and strings.
+  size_t nodes() const;
+  size_t bytes() const;
+
+"""
+
+flat_class_end = """  // The references of nodes with a list of operands, such as the arguments
+  // of a call, each list in one run.
+  std::vector<FlatRef> lists;
+  std::vector<std::string> strings;
+
+private:
+  uint32_t intern(const std::string &string);
+
+  std::map<std::string, uint32_t> interned;
+};
+
+"""
+
+flat_intern = """uint32_t FlatExpr::intern(const std::string &string) {
+  auto found = interned.find(string);
+  if (found != interned.end())
+    return found->second;
+  strings.push_back(string);
+  return interned[string] = strings.size() - 1;
+}
+
+"""
+
+
+def define_flat(output_dir, types):
+    path_h = output_dir + "/flat_expr.h"
+    path_cc = output_dir + "/flat_expr.cc"
+
+    type_names = list(map(lambda x: x.split(":=")[0].strip(), types))
+    fields = list(map(lambda x: x.split(":=")[1].strip().split(", "), types))
+    if len(type_names) > 16:
+        raise ValueError("FlatRef has room for 16 node types")
+    # Types without flat fields, such as nil, need no array.
+    stored = [(tn, fs) for tn, fs in zip(type_names, fields)
+              if sum(map(flat_fields, fs), [])]
+
+    with open(path_h, "w") as f:
+        f.write("#ifndef FLAT_EXPR_H_\n#define FLAT_EXPR_H_\n\n")
+        f.write("// Auto generated code, don't modify manually.\n")
+        f.write('#include <cstdint>\n#include <map>\n#include <string>\n'
+                '#include <vector>\n#include "expr.h"\n\n')
+        f.write(flat_ref)
+        for type_name, field_list in stored:
+            f.write("struct Flat%s {\n" % type_name)
+            for field in field_list:
+                for ft, fn in flat_fields(field):
+                    f.write("  %s %s;\n" % (ft, fn))
+            f.write("};\n\n")
+        f.write(flat_class_begin)
+        for type_name, _ in stored:
+            f.write("  std::vector<Flat%s> %s;\n" % (type_name, flat_array(type_name)))
+        f.write(flat_class_end)
+        f.write("#endif // FLAT_EXPR_H_")
+
+    with open(path_cc, "w") as f:
+        f.write('#include <stdexcept>\n\n#include "flat_expr.h"\n\n')
+        f.write(flat_intern)
+
+        f.write("size_t FlatExpr::nodes() const {\n  size_t nodes = 0;\n")
+        for type_name, _ in stored:
+            f.write("  nodes += %s.size();\n" % flat_array(type_name))
+        f.write("  return nodes;\n}\n\n")
+        f.write("size_t FlatExpr::bytes() const {\n  size_t bytes = 0;\n")
+        for type_name, _ in stored:
+            f.write("  bytes += %s.capacity() * sizeof(Flat%s);\n"
+                    % (flat_array(type_name), type_name))
+        f.write("  bytes += lists.capacity() * sizeof(FlatRef);\n")
+        f.write("  for (const std::string &string : strings)\n")
+        f.write("    bytes += sizeof(string) + string.capacity();\n")
+        f.write("  return bytes;\n}\n\n")
+
+        # Copies the tree in post-order with an explicit stack, so the
+        # references to the children are known when a node is stored.
+        f.write("FlatRef FlatExpr::add(Expr *root) {\n")
+        f.write("  struct Work {\n    Expr *expr;\n    bool children_done;\n  };\n")
+        f.write("  std::vector<Work> work{{root, false}};\n")
+        f.write("  std::vector<FlatRef> refs;\n\n")
+        f.write("  while (!work.empty()) {\n")
+        f.write("    Work w = work.back();\n    work.pop_back();\n\n")
+        f.write("    switch (w.expr->get_type()) {\n")
+        for type_name, field_list in zip(type_names, fields):
+            children = [fd.split(" ")[1] for fd in field_list
+                        if fd.split(" ")[0] in ["Expr*", "std::vector<Expr*>"]]
+            lists = [fd.split(" ")[1] for fd in field_list
+                     if fd.split(" ")[0] == "std::vector<Expr*>"]
+            f.write("    case %s: {\n" % type_name.upper())
+            if not sum(map(flat_fields, field_list), []):
+                f.write("      refs.push_back(flat_ref(%s, 0));\n" % type_name.upper())
+                f.write("      break;\n    }\n")
+                continue
+            f.write("      %s *node = static_cast<%s *>(w.expr);\n"
+                    % (type_name, type_name))
+            if children:
+                f.write("      if (!w.children_done) {\n")
+                f.write("        work.push_back({node, true});\n")
+                for child in reversed(children):
+                    if child in lists:
+                        f.write("        for (auto it = node->%s.rbegin(); it != node->%s.rend(); ++it)\n"
+                                % (child, child))
+                        f.write("          work.push_back({*it, false});\n")
+                    else:
+                        f.write("        work.push_back({node->%s, false});\n" % child)
+                f.write("        break;\n      }\n")
+            f.write("      Flat%s flat;\n" % type_name)
+            for child in reversed(children):
+                if child in lists:
+                    f.write("      flat.%s_count = node->%s.size();\n" % (child, child))
+                    f.write("      flat.%s = lists.size();\n" % child)
+                    f.write("      lists.insert(lists.end(), refs.end() - flat.%s_count, refs.end());\n"
+                            % child)
+                    f.write("      refs.resize(refs.size() - flat.%s_count);\n" % child)
+                    continue
+                f.write("      flat.%s = refs.back();\n" % child)
+                f.write("      refs.pop_back();\n")
+            for field in field_list:
+                ft, fn = field.split(" ")
+                if ft in ["Expr*", "std::vector<Expr*>"]:
+                    continue
+                elif ft == "Token" and fn == "op":
+                    f.write("      flat.%s = node->%s.type;\n" % (fn, fn))
+                    f.write("      flat.%s_line = node->%s.line;\n" % (fn, fn))
+                elif ft == "Token":
+                    f.write("      flat.%s = intern(node->%s.lexeme);\n" % (fn, fn))
+                    f.write("      flat.%s_line = node->%s.line;\n" % (fn, fn))
+                elif ft == "std::string":
+                    f.write("      flat.%s = intern(node->%s);\n" % (fn, fn))
+                else:
+                    f.write("      flat.%s = node->%s;\n" % (fn, fn))
+            array = flat_array(type_name)
+            f.write("      if (%s.size() > FLAT_INDEX_MASK)\n" % array)
+            f.write('        throw std::length_error("Too many %s nodes.");\n'
+                    % type_name)
+            f.write("      refs.push_back(flat_ref(%s, %s.size()));\n"
+                    % (type_name.upper(), array))
+            f.write("      %s.push_back(flat);\n" % array)
+            f.write("      break;\n    }\n")
+        f.write("    }\n  }\n\n  return refs.back();\n}\n")
+
+
 def main():
     if len(sys.argv) != 2:
         print("Usage: python generate_ast.py <output directory>")
         sys.exit(64)
     output_dir = sys.argv[1]
 
-    define_ast(
-        output_dir,
-        "Expr",
-        [
-            "Assign := Token name, Expr* value",
-            "Binary := Expr* left, Token op, Expr* right",
-            "Grouping := Expr* expression",
-            "Unary := Token op, Expr* right",
-            "PrimitiveString := std::string value",
-            "PrimitiveNumber := double value",
-            "PrimitiveBool := bool value",
-            "PrimitiveNil := std::nullptr_t value",
-            "Variable := Token name",
-        ],
-    )
+    expr_types = [
+        "Assign := Token name, Expr* value",
+        "Binary := Expr* left, Token op, Expr* right",
+        "Grouping := Expr* expression",
+        "Unary := Token op, Expr* right",
+        "PrimitiveString := std::string value, int line",
+        "PrimitiveNumber := double value",
+        "PrimitiveBool := bool value",
+        "PrimitiveNil := std::nullptr_t value",
+        "Variable := Token name",
+        "Call := Token name, std::vector<Expr*> arguments, NativeFunction* native",
+    ]
+    define_ast(output_dir, "Expr", expr_types)
+    define_flat(output_dir, expr_types)
 
     define_ast(
         output_dir,
         "Stmt",
         [
-            "Block := std::vector<Stmt*> statements",
+            "Block := std::vector<Stmt*> statements, TokenRange body",
             "Expression := Expr* expression",
+            "If := Token keyword, Expr* condition, Stmt* then_branch, Stmt* else_branch",
+            "Import := Token keyword, std::string path, Module* module",
             "Print := Expr* expression",
             "Var := Token name, Expr* initializer",
+            "While := Token keyword, Expr* condition, Stmt* body, Expr* increment",
         ],
     )
 
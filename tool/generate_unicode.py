@@ -0,0 +1,53 @@
+# Writes src/unicode_table.cc, the table behind unicode_identifier_class(),
+# from the Unicode database of the running Python. Run it again after a
+# Python upgrade to follow a new Unicode version:
+#   python3 tool/generate_unicode.py src/unicode_table.cc
+import sys
+import unicodedata
+
+# Letters and letter numbers start identifiers; marks, digits and connector
+# punctuation may also continue them, as in Unicode's ID_Start and
+# ID_Continue, without their few backwards-compatibility additions.
+START = {"Lu", "Ll", "Lt", "Lm", "Lo", "Nl"}
+CONTINUE = START | {"Mn", "Mc", "Nd", "Pc"}
+
+# Kept in sync with IdentifierClass in utf8.h.
+ID_NONE, ID_CONTINUE, ID_START = 0, 1, 2
+
+
+def identifier_class(cp):
+    category = unicodedata.category(chr(cp))
+    if category in START:
+        return ID_START
+    if category in CONTINUE:
+        return ID_CONTINUE
+    return ID_NONE
+
+
+def main():
+    # Each run of code points of one class, from 0x80 on, is one entry.
+    runs = []
+    for cp in range(0x80, 0x110000):
+        cls = identifier_class(cp)
+        if not runs or runs[-1][1] != cls:
+            runs.append((cp, cls))
+
+    with open(sys.argv[1], "w") as f:
+        f.write("// Auto generated by tool/generate_unicode.py from Unicode %s, "
+                "don't\n// modify manually.\n" % unicodedata.unidata_version)
+        f.write('#include "utf8.h"\n\n')
+        f.write("// Each entry (first << 2) | class starts a run of code "
+                "points of one\n// IdentifierClass, which lasts up to the next "
+                "entry.\n")
+        f.write("const uint32_t unicode_identifier_runs[] = {\n")
+        for i in range(0, len(runs), 6):
+            row = ", ".join("0x%07x" % (cp << 2 | cls) for cp, cls in runs[i:i + 6])
+            f.write("    %s,\n" % row)
+        f.write("};\n\n")
+        f.write("const size_t unicode_identifier_run_count =\n"
+                "    sizeof(unicode_identifier_runs) / "
+                "sizeof(unicode_identifier_runs[0]);\n")
+
+
+if __name__ == "__main__":
+    main()